@@ -1,6 +1,9 @@
 #include "debug.h"
 #include "utilities.h"
 
+#include <iostream>
+#include <stdexcept>
+
 #ifndef NDEBUG
 
 VKAPI_ATTR VkBool32 VKAPI_CALL vulkanDebugPrintCallback(
@@ -57,14 +60,14 @@ void destroyVulkanDebugReportCallbackEXT(
 
 void setupVulkanDebugCallbacks(Context::Vulkan &context)
 {
-  utilities::log("TRACE", "Setup Vulkan debug callbacks");
+  utilities::trace("Setup Vulkan debug callbacks");
 
   VkDebugReportCallbackCreateInfoEXT create_info = {};
   create_info.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
   create_info.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
   create_info.pfnCallback = vulkanDebugPrintCallback;
 
-  utilities::log("TRACE", "Vulkan debug create info set");
+  utilities::trace("Vulkan debug create info set");
 
   VkDebugReportCallbackEXT print_callback;
   VkResult result = createVulkanDebugReportCallbackEXT(
@@ -77,12 +80,12 @@ void setupVulkanDebugCallbacks(Context::Vulkan &context)
     throw std::runtime_error("ERROR: Failed to set up debug callbacks");
   }
 
-  utilities::log("TRACE", "Setup Vulkan create debug report callbacks success");
+  utilities::trace("Setup Vulkan create debug report callbacks success");
 }
 
 void destroyVulkanDebugCallbacks(Context::Vulkan &context)
 {
-  utilities::log("TRACE", "Destroy Vulkan debug callbacks");
+  utilities::trace("Destroy Vulkan debug callbacks");
 
   for (VkDebugReportCallbackEXT &callback : context.debug_report_callbacks)
   {
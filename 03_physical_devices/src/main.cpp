@@ -7,6 +7,7 @@
 #include <glm/mat4x4.hpp>
 
 #include <iostream>
+#include <cstring>
 #include <string>
 #include <map>
 #include <set>
@@ -40,7 +41,9 @@ bool verifyVulkanExtensionList(
   char const * const * const extenions, 
   std::uint32_t extension_count
 );
-inline bool checkValidationLayerSupport(Context::Vulkan const &context, std::string &message);
+#ifndef NDEBUG
+  inline bool checkValidationLayerSupport(Context::Vulkan const &context, std::string &message);
+#endif
 
 // Runtime
 void run(Context &context);
@@ -82,7 +85,7 @@ int main()
 
 void init(Context &context)
 {
-  utilities::log("TRACE", "Init");
+  utilities::trace("Init");
 
   initWindow(context.glfw);
   initVulkan(context.vulkan);
@@ -90,7 +93,7 @@ void init(Context &context)
 
 void initWindow(Context::GLFW &context)
 {
-  utilities::log("TRACE", "Init window");
+  utilities::trace("Init window");
 
   glfwInit();
 
@@ -99,16 +102,16 @@ void initWindow(Context::GLFW &context)
   // For now, we disable window resizing since it will become complicated
   glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
-  utilities::log("TRACE", "Window hints set");
+  utilities::trace("Window hints set");
 
   context.window = glfwCreateWindow(WIDTH, HEIGHT, "Physical Device", nullptr, nullptr);
 
-  utilities::log("TRACE", "Window created");
+  utilities::trace("Window created");
 }
 
 std::vector<char const *> getRequiredExtensions(Context::Vulkan const &context)
 {
-  utilities::log("TRACE", "Get required extensions");
+  utilities::trace("Get required extensions");
 
   uint32_t glfw_extension_count = 0;
   char const * const *glfw_extensions;
@@ -122,14 +125,14 @@ std::vector<char const *> getRequiredExtensions(Context::Vulkan const &context)
     extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
   #endif
 
-  utilities::log("TRACE", "Extension count: " + std::to_string(extensions.size()));
+  utilities::trace("Extension count: {}", extensions.size());
 
   return extensions;
 }
 
 void initVulkan(Context::Vulkan &context)
 {
-  utilities::log("TRACE", "Init Vulkan");
+  utilities::trace("Init Vulkan");
 
   createVulkanInstance(context);
   #ifndef NDEBUG
@@ -140,16 +143,16 @@ void initVulkan(Context::Vulkan &context)
 
 void createVulkanInstance(Context::Vulkan &context)
 {
-  utilities::log("TRACE", "Create Vulkan instance");
+  utilities::trace("Create Vulkan instance");
 
-  std::string error_message;
   #ifndef NDEBUG
+    std::string error_message;
     if (!checkValidationLayerSupport(context, error_message))
     {
       throw std::runtime_error("ERROR: " + error_message);
     }
 
-    utilities::log("TRACE", "All requested validation layers available");
+    utilities::trace("All requested validation layers available");
   #endif
 
   VkApplicationInfo app_info;
@@ -160,7 +163,7 @@ void createVulkanInstance(Context::Vulkan &context)
   app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
   app_info.apiVersion = VK_API_VERSION_1_0;
 
-  utilities::log("TRACE", "Vulkan instance app info set");
+  utilities::trace("Vulkan instance app info set");
 
   VkInstanceCreateInfo create_info = {};
   create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -170,7 +173,7 @@ void createVulkanInstance(Context::Vulkan &context)
   retrieveVulkanExtensionList(context);
   if (verifyVulkanExtensionList(context, extensions.data(), extension_count))
   {
-    utilities::log("TRACE", "All glfw extensions are supported by Vulkan");
+    utilities::trace("All glfw extensions are supported by Vulkan");
   }
   create_info.enabledExtensionCount = extension_count;
   create_info.ppEnabledExtensionNames = extensions.data();
@@ -181,7 +184,7 @@ void createVulkanInstance(Context::Vulkan &context)
     create_info.enabledLayerCount = 0;
   #endif
 
-  utilities::log("TRACE", "Vulkan instance create info set");
+  utilities::trace("Vulkan instance create info set");
 
   VkResult result = vkCreateInstance(&create_info, nullptr, &(context.instance));
 
@@ -190,12 +193,12 @@ void createVulkanInstance(Context::Vulkan &context)
     throw std::runtime_error("ERROR: Failed to create Vulkan instance!");
   }
 
-  utilities::log("TRACE", "Create Vulkan instance success");
+  utilities::trace("Create Vulkan instance success");
 }
 
 inline void retrieveVulkanExtensionList(Context::Vulkan &context)
 {
-  utilities::log("TRACE", "Retrieving Vulkan extension list");
+  utilities::trace("Retrieving Vulkan extension list");
   std::uint32_t extension_count = 0;
   vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
 
@@ -203,14 +206,14 @@ inline void retrieveVulkanExtensionList(Context::Vulkan &context)
   extensions.resize(extension_count);
   vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions.data());
 
-  utilities::log("TRACE", "Available extensions:");
+  utilities::trace("Available extensions:");
   for (VkExtensionProperties const &extension : extensions)
   {
-    utilities::log(std::string("  ") + extension.extensionName);
+    utilities::trace("  {}", extension.extensionName);
   }
   if (extensions.size() == 0)
   {
-    utilities::log();
+    utilities::trace("  None");
   }
 }
 
@@ -247,7 +250,7 @@ inline bool verifyVulkanExtensionList(
 
     if (!found)
     {
-      utilities::log("TRACE", "Extension '" + std::string(extensions[i]) + "' not supported!");
+      utilities::warning("Extension '{}' not supported!", extensions[i]);
       all_extensions_supported = false;
     }
   }
@@ -255,6 +258,7 @@ inline bool verifyVulkanExtensionList(
   return all_extensions_supported;
 }
 
+#ifndef NDEBUG
 inline bool checkValidationLayerSupport(Context::Vulkan const &context, std::string &message)
 {
   std::uint32_t available_layer_count;
@@ -293,10 +297,11 @@ inline bool checkValidationLayerSupport(Context::Vulkan const &context, std::str
 
   return true;
 }
+#endif
 
 void pickVulkanPhysicalDevice(Context::Vulkan &context)
 {
-  utilities::log("TRACE", "Picking a physical device for Vulkan");
+  utilities::trace("Picking a physical device for Vulkan");
 
   uint32_t device_count = 0;
   vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
@@ -327,12 +332,12 @@ void pickVulkanPhysicalDevice(Context::Vulkan &context)
     throw std::runtime_error("Failed to find a suitable GPU for Vulkan");
   }
   
-  utilities::log("TRACE", "Physical device found");
+  utilities::trace("Physical device found");
 }
 
 int rateVulkanDeviceSuitability(VkPhysicalDevice device)
 {
-  utilities::log("TRACE", "Rating vulkan device suitability");
+  utilities::trace("Rating vulkan device suitability");
   VkPhysicalDeviceProperties device_properties;
   vkGetPhysicalDeviceProperties(device, &device_properties);
 
@@ -342,14 +347,14 @@ int rateVulkanDeviceSuitability(VkPhysicalDevice device)
   // Application can't function without geometry shaders
   if (!device_features.geometryShader)
   {
-    utilities::log("TRACE", "Device has no geometry shader");
+    utilities::trace("Device has no geometry shader");
     return 0;
   }
 
   QueueFamilyIndices indices = findQueueFamilies(device);
   if (!indices.isComplete())
   {
-    utilities::log("TRACE", "Device has no graphics queues");
+    utilities::trace("Device has no graphics queues");
     return 0;
   }
 
@@ -364,25 +369,25 @@ int rateVulkanDeviceSuitability(VkPhysicalDevice device)
   // Maximum possible size of textures affects graphics quality
   score += device_properties.limits.maxImageDimension2D;
 
-  utilities::log("TRACE", "Device given a score of " + std::to_string(score));
+  utilities::trace("Device given a score of {}", score);
   return score;
 }
 
 void run(Context &context)
 {
-  utilities::log("TRACE", "Run");
+  utilities::trace("Run");
 
   while (!glfwWindowShouldClose(context.glfw.window))
   {
     glfwPollEvents();
   }
 
-  utilities::log("TRACE", "Run loop end");
+  utilities::trace("Run loop end");
 }
 
 void cleanup(Context &context)
 {
-  utilities::log("TRACE", "Cleanup");
+  utilities::trace("Cleanup");
 
   cleanupVulkan(context.vulkan);
   cleanupWindow(context.glfw);
@@ -390,7 +395,7 @@ void cleanup(Context &context)
 
 void cleanupVulkan(Context::Vulkan &context)
 {
-  utilities::log("TRACE", "Cleanup Vulkan");
+  utilities::trace("Cleanup Vulkan");
 
   #ifndef NDEBUG
     destroyVulkanDebugCallbacks(context);
@@ -402,7 +407,7 @@ void cleanupVulkan(Context::Vulkan &context)
 
 void cleanupWindow(Context::GLFW &context)
 {
-  utilities::log("TRACE", "Cleanup window");
+  utilities::trace("Cleanup window");
 
   glfwDestroyWindow(context.window);
   glfwTerminate();
@@ -1,30 +1,213 @@
 #ifndef UTILITIES_H
 #define UTILITIES_H
 
-#include <iostream>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <string>
+#include <type_traits>
 
 namespace utilities
 {
-  inline void log()
+  enum class LogLevel
   {
-    #ifndef NDEBUG
-      std::cout << '\n';
-    #endif
+    trace,
+    info,
+    warning,
+    error,
+    off
+  };
+
+  // Anything below MIN_LEVEL compiles to nothing, arguments included.
+  // Override with -DUTILITIES_LOG_LEVEL=<0 (Trace) .. 4 (Off)>
+  #if defined(UTILITIES_LOG_LEVEL)
+    LogLevel constexpr MIN_LEVEL = static_cast<LogLevel>(UTILITIES_LOG_LEVEL);
+  #elif defined(NDEBUG)
+    LogLevel constexpr MIN_LEVEL = LogLevel::off;
+  #else
+    LogLevel constexpr MIN_LEVEL = LogLevel::trace;
+  #endif
+
+  template <LogLevel level>
+  bool constexpr isEnabled()
+  {
+    return level != LogLevel::off && level >= MIN_LEVEL;
+  }
+
+  namespace detail
+  {
+    // A formatted line is built on the stack and written with a single call, so logging never allocates.
+    // Lines longer than the buffer are truncated.
+    struct LineBuffer
+    {
+      static size_t constexpr CAPACITY = 1024;
+
+      char data[CAPACITY];
+      size_t size = 0;
+
+      void append(char const *text, size_t length)
+      {
+        size_t space = CAPACITY - size;
+        length = length < space ? length : space;
+        std::memcpy(data + size, text, length);
+        size += length;
+      }
+
+      void append(char const *text)
+      {
+        append(text, std::strlen(text));
+      }
+
+      template <typename... Args>
+      void appendPrintf(char const *format, Args... args)
+      {
+        // snprintf needs room for its terminator, which isn't counted in size
+        if (size + 1 >= CAPACITY)
+        {
+          return;
+        }
+
+        int written = std::snprintf(data + size, CAPACITY - size, format, args...);
+        if (written > 0)
+        {
+          size_t space = CAPACITY - size - 1;
+          size += static_cast<size_t>(written) < space ? static_cast<size_t>(written) : space;
+        }
+      }
+    };
+
+    inline char const *levelName(LogLevel level)
+    {
+      switch (level)
+      {
+        case LogLevel::trace: return "TRACE";
+        case LogLevel::info: return "INFO";
+        case LogLevel::warning: return "WARNING";
+        case LogLevel::error: return "ERROR";
+        default: return "";
+      }
+    }
+
+    inline void appendArg(LineBuffer &buffer, char const *value)
+    {
+      buffer.append(value != nullptr ? value : "(null)");
+    }
+
+    inline void appendArg(LineBuffer &buffer, std::string const &value)
+    {
+      buffer.append(value.data(), value.size());
+    }
+
+    inline void appendArg(LineBuffer &buffer, bool value)
+    {
+      buffer.append(value ? "true" : "false");
+    }
+
+    inline void appendArg(LineBuffer &buffer, char value)
+    {
+      buffer.append(&value, 1);
+    }
+
+    inline void appendArg(LineBuffer &buffer, void const *value)
+    {
+      buffer.appendPrintf("%p", value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    appendArg(LineBuffer &buffer, T value)
+    {
+      buffer.appendPrintf("%lld", static_cast<long long>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    appendArg(LineBuffer &buffer, T value)
+    {
+      buffer.appendPrintf("%llu", static_cast<unsigned long long>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    appendArg(LineBuffer &buffer, T value)
+    {
+      buffer.appendPrintf("%g", static_cast<double>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type
+    appendArg(LineBuffer &buffer, T value)
+    {
+      appendArg(buffer, static_cast<typename std::underlying_type<T>::type>(value));
+    }
+
+    inline void format(LineBuffer &buffer, char const *format)
+    {
+      buffer.append(format);
+    }
+
+    // Each "{}" in the format string is replaced by the next argument
+    template <typename T, typename... Args>
+    void format(LineBuffer &buffer, char const *format, T const &arg, Args const &... args)
+    {
+      char const *placeholder = std::strstr(format, "{}");
+      if (placeholder == nullptr)
+      {
+        buffer.append(format);
+        return;
+      }
+
+      buffer.append(format, static_cast<size_t>(placeholder - format));
+      appendArg(buffer, arg);
+      detail::format(buffer, placeholder + 2, args...);
+    }
+
+    inline void write(LineBuffer const &buffer)
+    {
+      std::fwrite(buffer.data, 1, buffer.size, stdout);
+    }
+  }
+
+  template <LogLevel level, typename... Args>
+  inline void log([[maybe_unused]] char const *format, [[maybe_unused]] Args const &... args)
+  {
+    if constexpr (isEnabled<level>())
+    {
+      detail::LineBuffer buffer;
+      buffer.append(detail::levelName(level));
+      buffer.append(": ", 2);
+      detail::format(buffer, format, args...);
+      if (buffer.size == detail::LineBuffer::CAPACITY)
+      {
+        --buffer.size;
+      }
+      buffer.append("\n", 1);
+      detail::write(buffer);
+    }
+  }
+
+  template <typename... Args>
+  inline void trace(char const *format, Args const &... args)
+  {
+    log<LogLevel::trace>(format, args...);
+  }
+
+  template <typename... Args>
+  inline void info(char const *format, Args const &... args)
+  {
+    log<LogLevel::info>(format, args...);
   }
 
-  inline void log(std::string const &message)
+  template <typename... Args>
+  inline void warning(char const *format, Args const &... args)
   {
-    #ifndef NDEBUG
-      std::cout << message << '\n';
-    #endif
+    log<LogLevel::warning>(format, args...);
   }
 
-  inline void log(std::string const &level, std::string const &message)
+  template <typename... Args>
+  inline void error(char const *format, Args const &... args)
   {
-    #ifndef NDEBUG
-      std::cout << level << ": " << message << '\n';
-    #endif 
+    log<LogLevel::error>(format, args...);
   }
 }
 
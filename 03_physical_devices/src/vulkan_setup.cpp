@@ -10,7 +10,7 @@ bool QueueFamilyIndices::isComplete()
 
 QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device)
 {
-  utilities::log("TRACE", "Finding vulkan queue families from device");
+  utilities::trace("Finding vulkan queue families from device");
   QueueFamilyIndices indices;
 
   uint32_t queue_family_count = 0;
@@ -33,7 +33,7 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device)
     }
   }
 
-  utilities::log("TRACE", "Found vulkan queue families");
+  utilities::trace("Found vulkan queue families");
   return indices;
 }
 
@@ -0,0 +1,200 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <thread>
+
+namespace Bench
+{
+  static void writeEscaped(std::FILE *file, std::string const &text)
+  {
+    for (char c : text)
+    {
+      if (c == '"' || c == '\\')
+      {
+        std::fprintf(file, "\\%c", c);
+      }
+      else if (static_cast<unsigned char>(c) < 0x20)
+      {
+        std::fprintf(file, "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+      }
+      else
+      {
+        std::fputc(c, file);
+      }
+    }
+  }
+
+  // How long run took, between set_up and tear_down. tear_down runs even when run throws, so nothing set_up
+  // created is left behind for the benchmarks after this one.
+  static std::chrono::steady_clock::duration timeIteration(
+    std::function<void()> const &set_up,
+    std::function<void()> const &run,
+    std::function<void()> const &tear_down)
+  {
+    using Clock = std::chrono::steady_clock;
+
+    set_up();
+    Clock::time_point start = Clock::now();
+    try
+    {
+      run();
+    }
+    catch (...)
+    {
+      tear_down();
+      throw;
+    }
+    Clock::duration elapsed = Clock::now() - start;
+    tear_down();
+
+    return elapsed;
+  }
+
+  Result measure(
+    std::string const &name,
+    Options const &options,
+    std::function<void()> const &set_up,
+    std::function<void()> const &run,
+    std::function<void()> const &tear_down)
+  {
+    using Clock = std::chrono::steady_clock;
+
+    Result result;
+    result.name = name;
+
+    std::vector<double> samples_us;
+    try
+    {
+      timeIteration(set_up, run, tear_down);
+
+      Clock::duration spent = Clock::duration::zero();
+      Clock::duration const min_time = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.min_time)
+      );
+      while (samples_us.size() < options.max_iterations &&
+        (spent < min_time || samples_us.size() < options.min_iterations))
+      {
+        Clock::duration elapsed = timeIteration(set_up, run, tear_down);
+        spent += elapsed;
+        samples_us.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+      }
+    }
+    catch (std::exception const &e)
+    {
+      result.error = e.what();
+      return result;
+    }
+
+    std::sort(samples_us.begin(), samples_us.end());
+    size_t count = samples_us.size();
+    double total = 0.0;
+    for (double sample : samples_us)
+    {
+      total += sample;
+    }
+
+    result.iterations = count;
+    result.mean_us = total / count;
+    result.median_us = count % 2 == 1
+      ? samples_us[count / 2]
+      : (samples_us[count / 2 - 1] + samples_us[count / 2]) / 2.0;
+    result.min_us = samples_us.front();
+    result.max_us = samples_us.back();
+
+    double variance = 0.0;
+    for (double sample : samples_us)
+    {
+      variance += (sample - result.mean_us) * (sample - result.mean_us);
+    }
+    result.stddev_us = count > 1 ? std::sqrt(variance / (count - 1)) : 0.0;
+
+    return result;
+  }
+
+  void printResult(Result const &result)
+  {
+    if (!result.error.empty())
+    {
+      std::printf("%-40s ERROR: %s\n", result.name.c_str(), result.error.c_str());
+      return;
+    }
+
+    std::printf(
+      "%-40s %10.2f us mean %10.2f us median %10.2f us min %10.2f us max %8llu iterations\n",
+      result.name.c_str(), result.mean_us, result.median_us, result.min_us, result.max_us,
+      static_cast<unsigned long long>(result.iterations)
+    );
+  }
+
+  bool writeJson(
+    std::string const &path,
+    std::vector<Result> const &results,
+    std::vector<std::pair<std::string, std::string>> const &context)
+  {
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+      return false;
+    }
+
+    char date[64] = {};
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    std::fprintf(file, "{\n  \"context\": {\n    \"date\": \"%s\",\n", date);
+    std::fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    #ifdef NDEBUG
+      std::fputs("    \"library_build_type\": \"release\"", file);
+    #else
+      std::fputs("    \"library_build_type\": \"debug\"", file);
+    #endif
+    for (std::pair<std::string, std::string> const &entry : context)
+    {
+      std::fputs(",\n    \"", file);
+      writeEscaped(file, entry.first);
+      std::fputs("\": \"", file);
+      writeEscaped(file, entry.second);
+      std::fputs("\"", file);
+    }
+    std::fputs("\n  },\n  \"benchmarks\": [", file);
+
+    for (size_t i=0; i<results.size(); ++i)
+    {
+      Result const &result = results[i];
+      std::fputs(i == 0 ? "\n    {\n      \"name\": \"" : ",\n    {\n      \"name\": \"", file);
+      writeEscaped(file, result.name);
+      std::fputs("\",\n      \"run_type\": \"iteration\",\n", file);
+      if (!result.error.empty())
+      {
+        std::fputs("      \"error_occurred\": true,\n      \"error_message\": \"", file);
+        writeEscaped(file, result.error);
+        std::fputs("\"\n    }", file);
+        continue;
+      }
+
+      // Only wall clock time is measured, so it stands in for CPU time too
+      std::fprintf(
+        file,
+        "      \"iterations\": %llu,\n"
+        "      \"real_time\": %.3f,\n"
+        "      \"cpu_time\": %.3f,\n"
+        "      \"time_unit\": \"us\",\n"
+        "      \"median\": %.3f,\n"
+        "      \"min\": %.3f,\n"
+        "      \"max\": %.3f,\n"
+        "      \"stddev\": %.3f\n"
+        "    }",
+        static_cast<unsigned long long>(result.iterations),
+        result.mean_us, result.mean_us, result.median_us, result.min_us, result.max_us, result.stddev_us
+      );
+    }
+    std::fputs("\n  ]\n}\n", file);
+
+    return std::fclose(file) == 0;
+  }
+}
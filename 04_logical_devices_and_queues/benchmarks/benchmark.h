@@ -0,0 +1,87 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+  // A timed step with an untimed fixture around it. State is made fresh for every iteration, so steps that
+  // create something, such as an instance, can be measured over and over.
+  template <typename State>
+  struct Fixture
+  {
+    std::string name;
+    std::function<void(State &)> set_up;    // Before every iteration, untimed
+    std::function<void(State &)> run;       // Timed
+    std::function<void(State &)> tear_down; // After every iteration, untimed
+  };
+
+  struct Options
+  {
+    double min_time = 0.5;  // Seconds spent per benchmark, at the least
+    std::uint64_t min_iterations = 5;
+    std::uint64_t max_iterations = 100000;
+    std::string filter;     // Only benchmarks whose name contains this run
+    std::string json_path;  // Results are also written here when set
+  };
+
+  struct Result
+  {
+    std::string name;
+    std::uint64_t iterations = 0;
+    double mean_us = 0.0;
+    double median_us = 0.0;
+    double min_us = 0.0;
+    double max_us = 0.0;
+    double stddev_us = 0.0;
+    std::string error;      // Set when the benchmark threw; the timings are then meaningless
+  };
+
+  // Runs timed until both options.min_time and options.min_iterations are reached, after one untimed warm up
+  // run that also catches errors before any timing starts
+  Result measure(
+    std::string const &name,
+    Options const &options,
+    std::function<void()> const &set_up,
+    std::function<void()> const &run,
+    std::function<void()> const &tear_down
+  );
+
+  template <typename State>
+  Result measure(Fixture<State> const &fixture, Options const &options)
+  {
+    std::unique_ptr<State> state;
+    auto fresh = [&state, &fixture]()
+    {
+      state.reset(new State());
+      if (fixture.set_up)
+      {
+        fixture.set_up(*state);
+      }
+    };
+    auto done = [&state, &fixture]()
+    {
+      if (fixture.tear_down)
+      {
+        fixture.tear_down(*state);
+      }
+      state.reset();
+    };
+    return measure(fixture.name, options, fresh, [&state, &fixture]() { fixture.run(*state); }, done);
+  }
+
+  void printResult(Result const &result);
+  // In the shape Google Benchmark writes, so its compare.py can diff two runs.
+  // context is extra key/value pairs for the "context" object.
+  bool writeJson(
+    std::string const &path,
+    std::vector<Result> const &results,
+    std::vector<std::pair<std::string, std::string>> const &context
+  );
+}
+
+#endif // BENCHMARK_H
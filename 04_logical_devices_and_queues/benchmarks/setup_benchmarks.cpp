@@ -0,0 +1,226 @@
+#include "benchmark.h"
+
+#include "context.h"
+#include "graphics_setup.h"
+#include "queue_families.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Times chapter 04's instance and device setup, the cost every new process pays before its first frame.
+//
+//   04_logical_devices_and_queues_benchmarks [--icd <icd.json>] [--json <results.json>]
+//                                            [--filter <substring>] [--min-time <seconds>]
+//
+// --icd points the Vulkan loader at one driver manifest, such as lavapipe's lvp_icd.json, SwiftShader's
+// vk_swiftshader_icd.json or the Vulkan-Tools mock ICD, so results don't depend on the machine's GPU.
+
+using GraphicsContext = Context::Graphics;
+namespace Vulkan = ::Graphics::Vulkan;
+
+namespace
+{
+  char const *const DEVICE_CACHE_PATH = "benchmark_device_selection.cache";
+
+  void setEnvironment(char const *name, std::string const &value)
+  {
+    #ifdef _WIN32
+      _putenv_s(name, value.c_str());
+    #else
+      setenv(name, value.c_str(), 1);
+    #endif
+  }
+
+  void loadInstanceLevel(GraphicsContext &context)
+  {
+    Vulkan::initLoader(context);
+    Vulkan::retrieveExtensionList(context);
+    #ifndef NDEBUG
+      Vulkan::verifyValidationLayers(context);
+    #endif
+  }
+
+  void createInstance(GraphicsContext &context)
+  {
+    loadInstanceLevel(context);
+    Vulkan::createInstance(context);
+  }
+
+  void destroyInstance(GraphicsContext &context)
+  {
+    if (context.instance != VK_NULL_HANDLE)
+    {
+      context.instance_functions.vkDestroyInstance(context.instance, context.host_allocator.callbacks());
+      context.instance = VK_NULL_HANDLE;
+    }
+  }
+
+  std::vector<Bench::Fixture<GraphicsContext>> setupBenchmarks()
+  {
+    std::vector<Bench::Fixture<GraphicsContext>> fixtures;
+
+    fixtures.push_back({ "initLoader", nullptr, Vulkan::initLoader, nullptr });
+    fixtures.push_back({
+      "retrieveExtensionList", Vulkan::initLoader, Vulkan::retrieveExtensionList, nullptr
+    });
+    fixtures.push_back({
+      "verifyExtensionList",
+      loadInstanceLevel,
+      [](GraphicsContext &context)
+      {
+        std::vector<char const *> extensions = ::Graphics::getRequiredExtensions(context);
+        Vulkan::verifyExtensionList(context, static_cast<std::uint32_t>(extensions.size()), extensions.data());
+      },
+      nullptr
+    });
+    // Release builds request no layers, so this only measures anything in debug builds
+    fixtures.push_back({
+      "checkValidationLayerSupport",
+      Vulkan::initLoader,
+      [](GraphicsContext &context)
+      {
+        std::string message;
+        Vulkan::checkValidationLayerSupport(context, message);
+      },
+      nullptr
+    });
+    fixtures.push_back({ "createInstance", loadInstanceLevel, Vulkan::createInstance, destroyInstance });
+    fixtures.push_back({
+      "pickPhysicalDevice/uncached",
+      [](GraphicsContext &context)
+      {
+        context.device_cache_path.clear();
+        createInstance(context);
+      },
+      Vulkan::pickPhysicalDevice,
+      destroyInstance
+    });
+    // The warm up run writes the cache that the timed runs then read
+    fixtures.push_back({
+      "pickPhysicalDevice/cached",
+      [](GraphicsContext &context)
+      {
+        context.device_cache_path = DEVICE_CACHE_PATH;
+        createInstance(context);
+      },
+      Vulkan::pickPhysicalDevice,
+      destroyInstance
+    });
+    fixtures.push_back({
+      "findQueueFamilies",
+      [](GraphicsContext &context)
+      {
+        context.device_cache_path.clear();
+        createInstance(context);
+        Vulkan::pickPhysicalDevice(context);
+      },
+      [](GraphicsContext &context)
+      {
+        Vulkan::findQueueFamilies(context.instance_functions, context.instance, context.physical_device);
+      },
+      destroyInstance
+    });
+    fixtures.push_back({
+      "instanceToPhysicalDevice",
+      [](GraphicsContext &context) { context.device_cache_path.clear(); },
+      [](GraphicsContext &context)
+      {
+        createInstance(context);
+        Vulkan::pickPhysicalDevice(context);
+      },
+      destroyInstance
+    });
+
+    return fixtures;
+  }
+
+  bool parseArguments(int argc, char **argv, Bench::Options &options, std::string &icd)
+  {
+    for (int i=1; i<argc; ++i)
+    {
+      std::string argument = argv[i];
+      bool has_value = i + 1 < argc;
+      if (argument == "--icd" && has_value)
+      {
+        icd = argv[++i];
+      }
+      else if (argument == "--json" && has_value)
+      {
+        options.json_path = argv[++i];
+      }
+      else if (argument == "--filter" && has_value)
+      {
+        options.filter = argv[++i];
+      }
+      else if (argument == "--min-time" && has_value)
+      {
+        options.min_time = std::atof(argv[++i]);
+      }
+      else
+      {
+        std::fprintf(
+          stderr,
+          "Usage: %s [--icd <icd.json>] [--json <results.json>] [--filter <substring>] [--min-time <seconds>]\n",
+          argv[0]
+        );
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Bench::Options options;
+  std::string icd;
+  if (!parseArguments(argc, argv, options, icd))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Before anything calls into the loader, which reads these once when it first looks for drivers.
+  // VK_DRIVER_FILES is the newer loaders' name for VK_ICD_FILENAMES.
+  if (!icd.empty())
+  {
+    setEnvironment("VK_ICD_FILENAMES", icd);
+    setEnvironment("VK_DRIVER_FILES", icd);
+  }
+
+  #ifndef NDEBUG
+    std::printf("Debug build: timings include logging and validation layers\n");
+  #endif
+
+  std::vector<Bench::Result> results;
+  bool failed = false;
+  for (Bench::Fixture<GraphicsContext> const &fixture : setupBenchmarks())
+  {
+    if (!options.filter.empty() && fixture.name.find(options.filter) == std::string::npos)
+    {
+      continue;
+    }
+
+    results.push_back(Bench::measure(fixture, options));
+    Bench::printResult(results.back());
+    failed = failed || !results.back().error.empty();
+  }
+  std::remove(DEVICE_CACHE_PATH);
+
+  if (!options.json_path.empty())
+  {
+    std::vector<std::pair<std::string, std::string>> context = {
+      { "executable", argv[0] },
+      { "icd", icd.empty() ? "system" : icd }
+    };
+    if (!Bench::writeJson(options.json_path, results, context))
+    {
+      std::fprintf(stderr, "Could not write %s\n", options.json_path.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,224 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace Assets
+{
+  bool Pack::open(std::string const &path, char const *&why)
+  {
+    close();
+
+    if (!file.open(path))
+    {
+      why = "missing or can't be mapped";
+      return false;
+    }
+
+    std::uint8_t const *base = static_cast<std::uint8_t const *>(file.data());
+    std::uint64_t const size = file.size();
+    PackHeader const *candidate = reinterpret_cast<PackHeader const *>(base);
+    if (size < sizeof(PackHeader) ||
+        std::memcmp(candidate->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 ||
+        candidate->version != PACK_VERSION)
+    {
+      why = "not a pack of this version";
+      close();
+      return false;
+    }
+    if (candidate->file_size != size)
+    {
+      why = "truncated";
+      close();
+      return false;
+    }
+
+    // The table of contents follows the header, and names follow the table. Each range is checked against
+    // what is left of the file rather than by adding up header fields, so a corrupt pack can't wrap the sum.
+    std::uint64_t const entries_size = std::uint64_t(candidate->entry_count) * sizeof(PackEntry);
+    std::uint64_t const mips_offset = sizeof(PackHeader) + entries_size;
+    std::uint64_t const mips_size = std::uint64_t(candidate->mip_count) * sizeof(PackMip);
+    if (entries_size > size - sizeof(PackHeader) ||
+        mips_size > size - mips_offset ||
+        candidate->names_offset < mips_offset + mips_size ||
+        candidate->names_offset > size ||
+        candidate->names_size > size - candidate->names_offset)
+    {
+      why = "table of contents out of range";
+      close();
+      return false;
+    }
+
+    PackEntry const *candidate_entries = reinterpret_cast<PackEntry const *>(base + sizeof(PackHeader));
+    PackMip const *candidate_mips = reinterpret_cast<PackMip const *>(candidate_entries + candidate->entry_count);
+    for (std::uint32_t i=0; i<candidate->entry_count; ++i)
+    {
+      PackEntry const &entry = candidate_entries[i];
+      bool valid = entry.mip_count > 0 &&
+        entry.first_mip <= candidate->mip_count &&
+        entry.mip_count <= candidate->mip_count - entry.first_mip &&
+        std::uint64_t(entry.name_offset) + entry.name_size <= candidate->names_size &&
+        (i == 0 || candidate_entries[i - 1].name_hash <= entry.name_hash);
+      for (std::uint32_t level=0; valid && level<entry.mip_count; ++level)
+      {
+        PackMip const &mip = candidate_mips[entry.first_mip + level];
+        valid = mip.offset % PACK_ALIGNMENT == 0 && mip.offset <= size && mip.size <= size - mip.offset;
+      }
+      if (!valid)
+      {
+        why = "corrupted table of contents";
+        close();
+        return false;
+      }
+    }
+
+    file_path = path;
+    header = candidate;
+    entries = candidate_entries;
+    mips = candidate_mips;
+    names = reinterpret_cast<char const *>(base + candidate->names_offset);
+    return true;
+  }
+
+  void Pack::close()
+  {
+    file.close();
+    file_path.clear();
+    header = nullptr;
+    entries = nullptr;
+    mips = nullptr;
+    names = nullptr;
+  }
+
+  PackEntry const *Pack::find(std::string const &name) const
+  {
+    if (header == nullptr)
+    {
+      return nullptr;
+    }
+
+    std::uint64_t const hash = hashName(name.data(), name.size());
+    PackEntry const *end = entries + header->entry_count;
+    PackEntry const *found = std::lower_bound(entries, end, hash, [](PackEntry const &entry, std::uint64_t value)
+    {
+      return entry.name_hash < value;
+    });
+    // Names colliding on a hash sit next to each other
+    for (; found != end && found->name_hash == hash; ++found)
+    {
+      if (found->name_size == name.size() && std::memcmp(names + found->name_offset, name.data(), name.size()) == 0)
+      {
+        return found;
+      }
+    }
+    return nullptr;
+  }
+
+  std::string Pack::name(PackEntry const &entry) const
+  {
+    return std::string(names + entry.name_offset, entry.name_size);
+  }
+}
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    VkImageCreateInfo packImageInfo(Assets::PackEntry const &entry, VkImageUsageFlags usage)
+    {
+      VkImageCreateInfo image_info = {};
+      image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+      image_info.imageType = VK_IMAGE_TYPE_2D;
+      image_info.format = static_cast<VkFormat>(entry.format);
+      image_info.extent = { entry.width, entry.height, 1 };
+      image_info.mipLevels = entry.mip_count;
+      image_info.arrayLayers = 1;
+      image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+      image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+      image_info.usage = usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+      image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      return image_info;
+    }
+
+    static ImageUpload mipUpload(Assets::PackMip const &mip, VkImage image, std::uint32_t level)
+    {
+      ImageUpload upload;
+      upload.image = image;
+      upload.subresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+      upload.extent = { mip.width, mip.height, 1 };
+      upload.size = mip.size;
+      return upload;
+    }
+
+    BufferUpload packBufferUpload(Assets::Pack const &pack, Assets::PackEntry const &entry, VkBuffer buffer)
+    {
+      Assets::PackMip const &data = pack.mip(entry, 0);
+      BufferUpload upload;
+      upload.buffer = buffer;
+      upload.data = pack.data(data);
+      upload.size = data.size;
+      return upload;
+    }
+
+    std::vector<ImageUpload> packImageUploads(
+      Assets::Pack const &pack,
+      Assets::PackEntry const &entry,
+      VkImage image)
+    {
+      std::vector<ImageUpload> uploads;
+      uploads.reserve(entry.mip_count);
+      for (std::uint32_t level=0; level<entry.mip_count; ++level)
+      {
+        Assets::PackMip const &mip = pack.mip(entry, level);
+        uploads.push_back(mipUpload(mip, image, level));
+        uploads.back().data = pack.data(mip);
+      }
+      return uploads;
+    }
+
+    StreamRequest packBufferRequest(
+      Assets::Pack const &pack,
+      Assets::PackEntry const &entry,
+      VkBuffer buffer,
+      float priority)
+    {
+      Assets::PackMip const &data = pack.mip(entry, 0);
+      StreamRequest request;
+      request.path = pack.path();
+      request.offset = data.offset;
+      request.size = data.size;
+      request.buffer.buffer = buffer;
+      request.priority = priority;
+      return request;
+    }
+
+    std::vector<StreamRequest> packImageRequests(
+      Assets::Pack const &pack,
+      Assets::PackEntry const &entry,
+      VkImage image,
+      float priority)
+    {
+      std::vector<StreamRequest> requests;
+      requests.reserve(entry.mip_count);
+      for (std::uint32_t level=0; level<entry.mip_count; ++level)
+      {
+        Assets::PackMip const &mip = pack.mip(entry, level);
+        StreamRequest request;
+        request.path = pack.path();
+        request.offset = mip.offset;
+        request.size = mip.size;
+        request.is_image = true;
+        request.image = mipUpload(mip, image, level);
+        request.priority = priority;
+        requests.push_back(std::move(request));
+      }
+      return requests;
+    }
+  }
+#endif
+
+}
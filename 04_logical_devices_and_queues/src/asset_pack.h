@@ -0,0 +1,155 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include "init.h"
+#include "asset_streamer.h"
+#include "file_io.h"
+#include "transfer_engine.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A pack file holds a scene's assets already laid out the way the GPU consumes them, so loading one is
+// mapping the file and copying slices of it into staging memory:
+//
+//   PackHeader | PackEntry[entry_count] sorted by name hash | PackMip[mip_count] | names | data
+//
+// Every data range starts on a PACK_ALIGNMENT boundary, which satisfies optimalBufferCopyOffsetAlignment
+// and texel block alignment for buffer to image copies. Packs are written by asset_packer and are little
+// endian, with every field naturally aligned.
+namespace Assets
+{
+  std::uint32_t constexpr PACK_VERSION = 1;
+  std::uint64_t constexpr PACK_ALIGNMENT = 256;
+  char const PACK_MAGIC[8] = { 'v', 't', 'i', 'p', 'a', 'c', 'k', '\0' };
+
+  enum class EntryKind : std::uint32_t
+  {
+    Buffer,
+    VertexBuffer,
+    IndexBuffer,
+    Texture
+  };
+
+  struct PackHeader
+  {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entry_count;
+    std::uint32_t mip_count;
+    std::uint32_t names_size;
+    std::uint64_t names_offset;
+    std::uint64_t file_size;
+  };
+
+  struct PackEntry
+  {
+    std::uint64_t name_hash;
+    std::uint32_t name_offset; // Into the names, which aren't null terminated
+    std::uint32_t name_size;
+    EntryKind kind;
+    // VkFormat of textures; VkIndexType of index buffers
+    std::uint32_t format;
+    // Vertex stride for vertex buffers; zero otherwise
+    std::uint32_t stride;
+    // Texels for textures, elements for vertex and index buffers, bytes for plain buffers
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t mip_count;
+    std::uint32_t first_mip;   // Into the mips. Buffers have one, holding their data.
+    std::uint32_t reserved;
+  };
+
+  struct PackMip
+  {
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint32_t width;
+    std::uint32_t height;
+  };
+
+  static_assert(sizeof(PackHeader) == 40, "PackHeader layout is part of the file format");
+  static_assert(sizeof(PackEntry) == 48, "PackEntry layout is part of the file format");
+  static_assert(sizeof(PackMip) == 24, "PackMip layout is part of the file format");
+
+  // FNV-1a, which entries are sorted and looked up by
+  inline std::uint64_t hashName(char const *name, size_t size)
+  {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (size_t i=0; i<size; ++i)
+    {
+      hash = (hash ^ static_cast<std::uint8_t>(name[i])) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+  // A pack mapped into memory. Opening checks that the header and table of contents are consistent with
+  // the file; entries and data are then used where they lie in the mapping, without being read or copied.
+  class Pack
+  {
+  public:
+    // False with the reason in why if the file is missing or isn't a valid pack of this version
+    bool open(std::string const &path, char const *&why);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    std::string const &path() const { return file_path; }
+    // nullptr when the pack has no entry with the name
+    PackEntry const *find(std::string const &name) const;
+    std::uint32_t entryCount() const { return header != nullptr ? header->entry_count : 0; }
+    PackEntry const &entry(std::uint32_t index) const { return entries[index]; }
+    std::string name(PackEntry const &entry) const;
+
+    PackMip const &mip(PackEntry const &entry, std::uint32_t level) const { return mips[entry.first_mip + level]; }
+    void const *data(PackMip const &mip) const { return static_cast<std::uint8_t const *>(file.data()) + mip.offset; }
+
+  private:
+    File::MappedFile file;
+    std::string file_path;
+    PackHeader const *header = nullptr;
+    PackEntry const *entries = nullptr;
+    PackMip const *mips = nullptr;
+    char const *names = nullptr;
+  };
+}
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // For an image that takes every mip level of a texture entry. Usage includes TRANSFER_DST.
+    VkImageCreateInfo packImageInfo(Assets::PackEntry const &entry, VkImageUsageFlags usage);
+
+    // Upload the slices of an entry where they lie in the pack's mapping, with nothing for the CPU to do
+    // but copy them into staging memory. The pack must stay open until the uploads are recorded.
+    BufferUpload packBufferUpload(Assets::Pack const &pack, Assets::PackEntry const &entry, VkBuffer buffer);
+    // One upload per mip level, moving the image from UNDEFINED to SHADER_READ_ONLY_OPTIMAL
+    std::vector<ImageUpload> packImageUploads(
+      Assets::Pack const &pack,
+      Assets::PackEntry const &entry,
+      VkImage image
+    );
+
+    // The same slices as requests for an AssetStreamer, which maps the pack file itself and reads them on
+    // its workers
+    StreamRequest packBufferRequest(
+      Assets::Pack const &pack,
+      Assets::PackEntry const &entry,
+      VkBuffer buffer,
+      float priority = 0.0f
+    );
+    std::vector<StreamRequest> packImageRequests(
+      Assets::Pack const &pack,
+      Assets::PackEntry const &entry,
+      VkImage image,
+      float priority = 0.0f
+    );
+  }
+#endif
+
+}
+
+#endif // ASSET_PACK_H
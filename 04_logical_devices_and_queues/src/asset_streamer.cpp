@@ -0,0 +1,486 @@
+#include "asset_streamer.h"
+#include "profiler.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    void AssetStreamer::init(
+      DeviceDispatch const &vk,
+      VkDevice device,
+      VkAllocationCallbacks const *allocator,
+      DeviceMemoryAllocator &memory_allocator,
+      TransferEngine &transfer_engine,
+      Jobs::JobPool &job_pool,
+      VkDeviceSize memory_budget,
+      std::uint32_t max_decodes)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->allocator = allocator;
+      this->memory_allocator = &memory_allocator;
+      this->transfer_engine = &transfer_engine;
+      this->job_pool = &job_pool;
+      this->max_decodes = std::max<std::uint32_t>(max_decodes, 1);
+      totals = Stats();
+      totals.memory_budget = memory_budget;
+    }
+
+    void AssetStreamer::destroy()
+    {
+      if (vk == nullptr)
+      {
+        return;
+      }
+
+      std::vector<Jobs::Handle> jobs;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::pair<float, StreamId> const &queued : queue)
+        {
+          Entry &entry = entries.at(queued.second);
+          releaseFileLocked(entry.request.path);
+          finishLocked(entry, StreamState::Cancelled);
+        }
+        queue.clear();
+        for (std::pair<StreamId const, Entry> &entry : entries)
+        {
+          if (entry.second.state == StreamState::Decoding)
+          {
+            entry.second.cancel_requested = true;
+          }
+        }
+        jobs = std::move(decode_jobs);
+        decode_jobs.clear();
+      }
+      // Outside the lock, which the decodes take to finish
+      job_pool->waitAll(jobs);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      for (StreamId id : uploading)
+      {
+        Entry &entry = entries.at(id);
+        transfer_engine->wait(entry.ticket);
+        destroyStaging(entry.staging);
+        finishLocked(entry, StreamState::Ready);
+      }
+      uploading.clear();
+      entries.clear();
+      mapped_files.clear();
+
+      vk = nullptr;
+      device = VK_NULL_HANDLE;
+    }
+
+    StreamId AssetStreamer::request(StreamRequest request)
+    {
+      if (request.path.empty())
+      {
+        throw std::runtime_error("ERROR: Asset stream requested without a file");
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      StreamId const id = next_id++;
+      Entry &entry = entries[id];
+      entry.request = std::move(request);
+      entry.staging_size = entry.request.decoded_size != 0 ? entry.request.decoded_size : entry.request.size;
+      ++mapped_files[entry.request.path].requests;
+      queue.insert({ entry.request.priority, id });
+      dispatchLocked();
+      return id;
+    }
+
+    bool AssetStreamer::setPriority(StreamId id, float priority)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto found = entries.find(id);
+      if (found == entries.end() || found->second.state != StreamState::Queued)
+      {
+        return false;
+      }
+
+      queue.erase({ found->second.request.priority, id });
+      found->second.request.priority = priority;
+      queue.insert({ priority, id });
+      return true;
+    }
+
+    bool AssetStreamer::cancel(StreamId id)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto found = entries.find(id);
+      if (found == entries.end())
+      {
+        return false;
+      }
+
+      Entry &entry = found->second;
+      switch (entry.state)
+      {
+        case StreamState::Queued:
+          queue.erase({ entry.request.priority, id });
+          releaseFileLocked(entry.request.path);
+          finishLocked(entry, StreamState::Cancelled);
+          return true;
+        case StreamState::Decoding:
+          entry.cancel_requested = true;
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    void AssetStreamer::release(StreamId id)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto found = entries.find(id);
+      if (found == entries.end())
+      {
+        return;
+      }
+
+      StreamState const state = found->second.state;
+      if (state == StreamState::Ready || state == StreamState::Cancelled || state == StreamState::Failed)
+      {
+        entries.erase(found);
+      }
+    }
+
+    StreamState AssetStreamer::state(StreamId id) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto found = entries.find(id);
+      return found != entries.end() ? found->second.state : StreamState::Unknown;
+    }
+
+    UploadTicket AssetStreamer::ticket(StreamId id) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto found = entries.find(id);
+      return found != entries.end() ? found->second.ticket : UploadTicket();
+    }
+
+    void AssetStreamer::update()
+    {
+      PROFILE_ZONE("Update asset streaming");
+
+      std::lock_guard<std::mutex> lock(mutex);
+      auto retired = std::remove_if(uploading.begin(), uploading.end(), [this](StreamId id)
+      {
+        Entry &entry = entries.at(id);
+        if (!transfer_engine->isComplete(entry.ticket))
+        {
+          return false;
+        }
+
+        destroyStaging(entry.staging);
+        totals.bytes_streamed += entry.staging_size;
+        finishLocked(entry, StreamState::Ready);
+        return true;
+      });
+      uploading.erase(retired, uploading.end());
+
+      decode_jobs.erase(
+        std::remove_if(decode_jobs.begin(), decode_jobs.end(), [this](Jobs::Handle const &job)
+        {
+          return job_pool->isComplete(job);
+        }),
+        decode_jobs.end()
+      );
+
+      dispatchLocked();
+    }
+
+    void AssetStreamer::setMemoryBudget(VkDeviceSize bytes)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      totals.memory_budget = bytes;
+      dispatchLocked();
+    }
+
+    AssetStreamer::Stats AssetStreamer::stats() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      Stats stats = totals;
+      stats.queued = static_cast<std::uint32_t>(queue.size());
+      stats.uploading = static_cast<std::uint32_t>(uploading.size());
+      return stats;
+    }
+
+    void AssetStreamer::logStats() const
+    {
+      Stats const stats = this->stats();
+      if (stats.completed + stats.cancelled + stats.failed == 0)
+      {
+        return;
+      }
+
+      Debug::Info(
+        "Asset streaming: {} assets ready, {} cancelled, {} failed, {} bytes read and {} uploaded, "
+        "staging peaked at {} of a {} byte budget",
+        stats.completed,
+        stats.cancelled,
+        stats.failed,
+        stats.bytes_read,
+        stats.bytes_streamed,
+        stats.budget_peak,
+        stats.memory_budget
+      );
+    }
+
+    void AssetStreamer::dispatchLocked()
+    {
+      while (!queue.empty() && totals.decoding < max_decodes)
+      {
+        StreamId const id = queue.begin()->second;
+        Entry &entry = entries.at(id);
+        // Until its file is mapped, a request reading to the end of it is taken to fill the whole budget
+        VkDeviceSize const estimate = entry.staging_size != 0 ? entry.staging_size : totals.memory_budget;
+        // Strictly in priority order, so a large asset isn't starved by smaller ones behind it. With nothing
+        // else in flight, it goes ahead however large it is.
+        if (totals.budget_used > 0 && totals.budget_used + estimate > totals.memory_budget)
+        {
+          break;
+        }
+
+        queue.erase(queue.begin());
+        entry.state = StreamState::Decoding;
+        entry.charged = estimate;
+        totals.budget_used += entry.charged;
+        totals.budget_peak = std::max(totals.budget_peak, totals.budget_used);
+        ++totals.decoding;
+        decode_jobs.push_back(job_pool->submit([this, id]() { decode(id); }));
+      }
+    }
+
+    void AssetStreamer::decode(StreamId id)
+    {
+      PROFILE_ZONE("Decode asset");
+
+      StreamRequest request;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry &entry = entries.at(id);
+        if (entry.cancel_requested)
+        {
+          releaseFileLocked(entry.request.path);
+          finishLocked(entry, StreamState::Cancelled);
+          --totals.decoding;
+          dispatchLocked();
+          return;
+        }
+        request = entry.request;
+      }
+
+      Staging staging;
+      try
+      {
+        std::shared_ptr<File::MappedFile> file = mapFile(request.path);
+        if (request.offset > file->size() || request.size > file->size() - request.offset)
+        {
+          throw std::runtime_error("range is past the end of the file");
+        }
+        size_t const source_size = static_cast<size_t>(
+          request.size != 0 ? request.size : file->size() - request.offset
+        );
+        VkDeviceSize const staging_size = request.decoded_size != 0 ? request.decoded_size : source_size;
+        if (staging_size == 0)
+        {
+          throw std::runtime_error("nothing to upload");
+        }
+
+        {
+          // Requests reading to the end of the file were charged an estimate
+          std::lock_guard<std::mutex> lock(mutex);
+          Entry &entry = entries.at(id);
+          totals.budget_used = totals.budget_used - entry.charged + staging_size;
+          totals.budget_peak = std::max(totals.budget_peak, totals.budget_used);
+          entry.charged = staging_size;
+          entry.staging_size = staging_size;
+        }
+
+        staging = createStaging(staging_size);
+        void const *source = static_cast<std::uint8_t const *>(file->data()) + request.offset;
+        if (request.decode)
+        {
+          request.decode(source, source_size, staging.memory->mapped, static_cast<size_t>(staging_size));
+        }
+        else if (request.decoded_size != 0 && request.decoded_size != source_size)
+        {
+          throw std::runtime_error("decoded size differs from the stored size, with no decode function");
+        }
+        else
+        {
+          std::memcpy(staging.memory->mapped, source, source_size);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry &entry = entries.at(id);
+        if (entry.cancel_requested)
+        {
+          destroyStaging(staging);
+        }
+        else if (request.is_image)
+        {
+          ImageUpload upload = request.image;
+          upload.data = nullptr;
+          upload.size = staging_size;
+          upload.src_buffer = staging.buffer;
+          upload.src_offset = 0;
+          entry.ticket = transfer_engine->upload(upload);
+        }
+        else
+        {
+          BufferUpload upload = request.buffer;
+          upload.data = nullptr;
+          upload.size = staging_size;
+          upload.src_buffer = staging.buffer;
+          upload.src_offset = 0;
+          entry.ticket = transfer_engine->upload(upload);
+        }
+
+        // Nothing past here throws, so the failure path below never sees a half finished request
+        releaseFileLocked(request.path);
+        --totals.decoding;
+        totals.bytes_read += source_size;
+        if (entry.cancel_requested)
+        {
+          finishLocked(entry, StreamState::Cancelled);
+        }
+        else
+        {
+          entry.staging = staging;
+          entry.state = StreamState::Uploading;
+          uploading.push_back(id);
+        }
+        dispatchLocked();
+      }
+      catch (std::exception const &e)
+      {
+        Debug::Warning("Failed to stream {} at offset {}: {}", request.path, request.offset, e.what());
+        destroyStaging(staging);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        releaseFileLocked(request.path);
+        finishLocked(entries.at(id), StreamState::Failed);
+        --totals.decoding;
+        dispatchLocked();
+      }
+    }
+
+    std::shared_ptr<File::MappedFile> AssetStreamer::mapFile(std::string const &path)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        MappedPack const &pack = mapped_files.at(path);
+        if (pack.file)
+        {
+          return pack.file;
+        }
+      }
+
+      // Outside the lock, since opening can wait on the disk. Two decodes racing to map the same file both
+      // map it, and the later one uses the earlier one's mapping.
+      std::shared_ptr<File::MappedFile> file = std::make_shared<File::MappedFile>();
+      if (!file->open(path))
+      {
+        throw std::runtime_error("could not map the file");
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      MappedPack &pack = mapped_files.at(path);
+      if (!pack.file)
+      {
+        pack.file = std::move(file);
+      }
+      return pack.file;
+    }
+
+    AssetStreamer::Staging AssetStreamer::createStaging(VkDeviceSize size)
+    {
+      Staging staging;
+
+      VkBufferCreateInfo buffer_info = {};
+      buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      buffer_info.size = size;
+      buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+      buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      if (vk->vkCreateBuffer(device, &buffer_info, allocator, &staging.buffer) != VK_SUCCESS)
+      {
+        throw std::runtime_error("could not create a staging buffer");
+      }
+
+      try
+      {
+        // Coherent, so the decoded data needs no flush before the transfer engine copies it
+        staging.memory = memory_allocator->allocateForBuffer(
+          staging.buffer,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+      }
+      catch (...)
+      {
+        destroyStaging(staging);
+        throw;
+      }
+      if (staging.memory->mapped == nullptr)
+      {
+        destroyStaging(staging);
+        throw std::runtime_error("staging memory is not mapped");
+      }
+      return staging;
+    }
+
+    void AssetStreamer::destroyStaging(Staging &staging)
+    {
+      if (staging.buffer != VK_NULL_HANDLE)
+      {
+        vk->vkDestroyBuffer(device, staging.buffer, allocator);
+      }
+      if (staging.memory != nullptr)
+      {
+        memory_allocator->free(staging.memory);
+      }
+      staging = Staging();
+    }
+
+    void AssetStreamer::releaseFileLocked(std::string const &path)
+    {
+      auto found = mapped_files.find(path);
+      if (found != mapped_files.end() && --found->second.requests == 0)
+      {
+        mapped_files.erase(found);
+      }
+    }
+
+    void AssetStreamer::finishLocked(Entry &entry, StreamState state)
+    {
+      totals.budget_used -= entry.charged;
+      entry.charged = 0;
+      entry.state = state;
+      switch (state)
+      {
+        case StreamState::Ready:
+          ++totals.completed;
+          break;
+        case StreamState::Cancelled:
+          ++totals.cancelled;
+          break;
+        default:
+          ++totals.failed;
+          break;
+      }
+    }
+  }
+#endif
+
+}
@@ -0,0 +1,191 @@
+#ifndef ASSET_STREAMER_H
+#define ASSET_STREAMER_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "device_memory.h"
+#include "file_io.h"
+#include "job_pool.h"
+#include "transfer_engine.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    using StreamId = std::uint64_t; // 0 is never handed out
+
+    enum class StreamState : std::uint8_t
+    {
+      Unknown,   // Never requested, or released
+      Queued,
+      Decoding,
+      Uploading,
+      Ready,     // The ticket's uploads are done; the destination can be used
+      Cancelled,
+      Failed
+    };
+
+    // Turns an asset's bytes as stored on disk into what gets uploaded, writing straight into mapped staging
+    // memory. Runs on a job pool worker. Throwing fails the request.
+    using DecodeFunction = std::function<void(
+      void const *source, size_t source_size, void *destination, size_t destination_size
+    )>;
+
+    struct StreamRequest
+    {
+      // Mapped on first use and kept mapped while requests for it are outstanding, so several assets packed
+      // into one file share a mapping
+      std::string path;
+      std::uint64_t offset = 0;
+      std::uint64_t size = 0;         // 0 reads to the end of the file
+      std::uint64_t decoded_size = 0; // 0 when decoding keeps the size
+      DecodeFunction decode;          // Empty copies the bytes as they are
+
+      // The destination. Data, size and source are filled in by the streamer.
+      bool is_image = false;
+      BufferUpload buffer;
+      ImageUpload image;
+
+      // Higher streams first, for instance from distance to the camera or screen coverage
+      float priority = 0.0f;
+    };
+
+    // Streams assets from memory mapped files into buffers and images without blocking the thread that
+    // renders. Requests wait in priority order until the staging memory budget has room, then a job pool
+    // worker decodes the asset from the mapping into staging memory of its own, which the transfer engine
+    // copies from directly. update() hands out the budget and retires finished uploads once a frame.
+    class AssetStreamer
+    {
+    public:
+      static VkDeviceSize constexpr DEFAULT_MEMORY_BUDGET = 64ull * 1024 * 1024;
+      static std::uint32_t constexpr DEFAULT_MAX_DECODES = 4;
+
+      struct Stats
+      {
+        std::uint32_t queued = 0;
+        std::uint32_t decoding = 0;
+        std::uint32_t uploading = 0;
+        std::uint64_t completed = 0;
+        std::uint64_t cancelled = 0;
+        std::uint64_t failed = 0;
+        std::uint64_t bytes_read = 0;     // From the files, before decoding
+        std::uint64_t bytes_streamed = 0; // Uploaded, after decoding
+        VkDeviceSize budget_used = 0;     // Staging memory held by requests being decoded or uploaded
+        VkDeviceSize budget_peak = 0;
+        VkDeviceSize memory_budget = 0;
+      };
+
+      void init(
+        DeviceDispatch const &vk,
+        VkDevice device,
+        VkAllocationCallbacks const *allocator,
+        DeviceMemoryAllocator &memory_allocator,
+        TransferEngine &transfer_engine,
+        Jobs::JobPool &job_pool,
+        VkDeviceSize memory_budget = DEFAULT_MEMORY_BUDGET,
+        std::uint32_t max_decodes = DEFAULT_MAX_DECODES
+      );
+      // Cancels everything queued and waits for decodes and uploads already under way
+      void destroy();
+
+      StreamId request(StreamRequest request);
+      // Only queued requests can be reprioritized; returns false otherwise
+      bool setPriority(StreamId id, float priority);
+      // Queued requests are dropped, and decoding ones discarded once their decode returns. Uploads already
+      // submitted can't be called back, so cancelling those returns false.
+      bool cancel(StreamId id);
+      // Forgets a request that is ready, cancelled or failed
+      void release(StreamId id);
+
+      StreamState state(StreamId id) const;
+      // Valid from Uploading on, for TransferEngine::addWait and recordAcquire
+      UploadTicket ticket(StreamId id) const;
+
+      // Starts decodes in priority order while the budget allows, and retires finished uploads
+      void update();
+      // Requests larger than the whole budget still stream, one at a time
+      void setMemoryBudget(VkDeviceSize bytes);
+
+      Stats stats() const;
+      void logStats() const;
+
+    private:
+      struct Staging
+      {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        DeviceAllocation *memory = nullptr;
+      };
+
+      struct Entry
+      {
+        StreamRequest request;
+        StreamState state = StreamState::Queued;
+        bool cancel_requested = false;
+        VkDeviceSize staging_size = 0; // Estimated until the file is mapped when the request has no size
+        VkDeviceSize charged = 0;      // Against the budget, while decoding or uploading
+        Staging staging;
+        UploadTicket ticket;
+      };
+
+      // Mapped by the first decode and unmapped once no request for the file is queued or decoding
+      struct MappedPack
+      {
+        std::shared_ptr<File::MappedFile> file;
+        std::uint32_t requests = 0;
+      };
+
+      // Highest priority first, then oldest first
+      struct QueueOrder
+      {
+        bool operator()(std::pair<float, StreamId> const &a, std::pair<float, StreamId> const &b) const
+        {
+          return a.first != b.first ? a.first > b.first : a.second < b.second;
+        }
+      };
+
+      void dispatchLocked();
+      void decode(StreamId id);
+      std::shared_ptr<File::MappedFile> mapFile(std::string const &path);
+      Staging createStaging(VkDeviceSize size);
+      void destroyStaging(Staging &staging);
+      // Drops a request's hold on its file, unmapping it after the last one
+      void releaseFileLocked(std::string const &path);
+      // Hands back the entry's budget and counts how it ended
+      void finishLocked(Entry &entry, StreamState state);
+
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+      DeviceMemoryAllocator *memory_allocator = nullptr;
+      TransferEngine *transfer_engine = nullptr;
+      Jobs::JobPool *job_pool = nullptr;
+      std::uint32_t max_decodes = DEFAULT_MAX_DECODES;
+
+      mutable std::mutex mutex;
+      std::unordered_map<StreamId, Entry> entries;
+      std::set<std::pair<float, StreamId>, QueueOrder> queue;
+      std::vector<StreamId> uploading;
+      std::vector<Jobs::Handle> decode_jobs;
+      std::map<std::string, MappedPack> mapped_files;
+      StreamId next_id = 1;
+      Stats totals;
+    };
+  }
+#endif
+
+}
+
+#endif // ASSET_STREAMER_H
@@ -0,0 +1,249 @@
+#include "async_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace Debug
+{
+  namespace AsyncLog
+  {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "AsyncLog::CAPACITY must be a power of two");
+
+    namespace
+    {
+      size_t constexpr BATCH_SIZE = 64;
+      size_t constexpr CACHE_LINE = 64;
+
+      std::uint32_t currentThreadId()
+      {
+        static std::atomic<std::uint32_t> next_id(0);
+        thread_local std::uint32_t const id = next_id.fetch_add(1, std::memory_order_relaxed);
+        return id;
+      }
+
+      char const *levelName(Level level)
+      {
+        switch (level)
+        {
+          case Level::Trace: return "TRACE";
+          case Level::Info: return "INFO";
+          case Level::Warning: return "WARNING";
+          case Level::Error: return "ERROR";
+          default: return "";
+        }
+      }
+
+      // Bounded MPSC queue after Dmitry Vyukov's MPMC design. Each cell carries a sequence number that
+      // tells producers whether it is free and the consumer whether it has been published.
+      class Writer
+      {
+      public:
+        Writer()
+          : cells(new Cell[CAPACITY]),
+            start(std::chrono::steady_clock::now())
+        {
+          for (size_t i=0; i<CAPACITY; ++i)
+          {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+          }
+
+          thread = std::thread(&Writer::run, this);
+        }
+
+        ~Writer()
+        {
+          running.store(false, std::memory_order_release);
+          thread.join();
+        }
+
+        bool push(Level level, char const *message, size_t size)
+        {
+          size_t position = enqueue_position.load(std::memory_order_relaxed);
+          Cell *cell;
+          for (;;)
+          {
+            cell = &cells[position & (CAPACITY - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+            if (difference == 0)
+            {
+              if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+              {
+                break;
+              }
+            }
+            else if (difference < 0)
+            {
+              // Full: the writer is behind, drop rather than stall the caller
+              dropped.fetch_add(1, std::memory_order_relaxed);
+              return false;
+            }
+            else
+            {
+              position = enqueue_position.load(std::memory_order_relaxed);
+            }
+          }
+
+          Record &record = cell->record;
+          record.timestamp_ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()
+          );
+          record.thread_id = currentThreadId();
+          record.level = level;
+          record.size = static_cast<std::uint16_t>(std::min(size, PAYLOAD_SIZE));
+          std::memcpy(record.payload, message, record.size);
+
+          cell->sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+
+        void flush()
+        {
+          size_t target = enqueue_position.load(std::memory_order_acquire);
+          while (written_position.load(std::memory_order_acquire) < target)
+          {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+          }
+        }
+
+        std::uint64_t droppedCount() const
+        {
+          return dropped.load(std::memory_order_relaxed);
+        }
+
+      private:
+        struct Cell
+        {
+          std::atomic<size_t> sequence;
+          Record record;
+        };
+
+        // Formats up to BATCH_SIZE published records and writes them with one call per stream
+        size_t drainBatch()
+        {
+          size_t count = 0;
+          size_t out_size = 0;
+          size_t err_size = 0;
+
+          while (count < BATCH_SIZE)
+          {
+            Cell &cell = cells[dequeue_position & (CAPACITY - 1)];
+            if (cell.sequence.load(std::memory_order_acquire) != dequeue_position + 1)
+            {
+              break;
+            }
+
+            Record const &record = cell.record;
+            bool is_error = record.level >= Level::Warning;
+            char *buffer = is_error ? err_buffer.get() : out_buffer.get();
+            size_t &size = is_error ? err_size : out_size;
+
+            int written = std::snprintf(
+              buffer + size, LINE_SIZE, "[%9.6f] [T%u] %s: %.*s\n",
+              static_cast<double>(record.timestamp_ns) * 1e-9,
+              record.thread_id,
+              levelName(record.level),
+              static_cast<int>(record.size), record.payload
+            );
+            size += std::min(static_cast<size_t>(std::max(written, 0)), LINE_SIZE - 1);
+
+            cell.sequence.store(dequeue_position + CAPACITY, std::memory_order_release);
+            ++dequeue_position;
+            ++count;
+          }
+
+          std::uint64_t dropped_now = dropped.load(std::memory_order_relaxed);
+          if (dropped_now != dropped_reported)
+          {
+            int written = std::snprintf(
+              err_buffer.get() + err_size, LINE_SIZE, "WARNING: %llu log records dropped\n",
+              static_cast<unsigned long long>(dropped_now - dropped_reported)
+            );
+            err_size += std::min(static_cast<size_t>(std::max(written, 0)), LINE_SIZE - 1);
+            dropped_reported = dropped_now;
+          }
+
+          if (out_size > 0)
+          {
+            std::fwrite(out_buffer.get(), 1, out_size, stdout);
+            std::fflush(stdout);
+          }
+          if (err_size > 0)
+          {
+            std::fwrite(err_buffer.get(), 1, err_size, stderr);
+            std::fflush(stderr);
+          }
+
+          written_position.store(dequeue_position, std::memory_order_release);
+          return count;
+        }
+
+        void run()
+        {
+          for (;;)
+          {
+            if (drainBatch() > 0)
+            {
+              continue;
+            }
+
+            // Producers may still be publishing claimed cells, so drain once more after shutdown is seen
+            if (!running.load(std::memory_order_acquire))
+            {
+              while (drainBatch() > 0)
+              {
+              }
+              break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+        }
+
+        static size_t constexpr LINE_SIZE = PAYLOAD_SIZE + 64;
+
+        std::unique_ptr<Cell[]> cells;
+        alignas(CACHE_LINE) std::atomic<size_t> enqueue_position{0};
+        alignas(CACHE_LINE) std::atomic<size_t> written_position{0};
+        alignas(CACHE_LINE) std::atomic<std::uint64_t> dropped{0};
+        std::atomic<bool> running{true};
+
+        // Only touched by the writer thread
+        alignas(CACHE_LINE) size_t dequeue_position = 0;
+        std::uint64_t dropped_reported = 0;
+        std::unique_ptr<char[]> out_buffer{new char[LINE_SIZE * (BATCH_SIZE + 1)]};
+        std::unique_ptr<char[]> err_buffer{new char[LINE_SIZE * (BATCH_SIZE + 1)]};
+
+        std::chrono::steady_clock::time_point start;
+        std::thread thread;
+      };
+
+      Writer &writer()
+      {
+        static Writer instance;
+        return instance;
+      }
+    }
+
+    bool push(Level level, char const *message, size_t size)
+    {
+      return writer().push(level, message, size);
+    }
+
+    void flush()
+    {
+      writer().flush();
+    }
+
+    std::uint64_t droppedCount()
+    {
+      return writer().droppedCount();
+    }
+  }
+}
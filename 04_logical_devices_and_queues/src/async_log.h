@@ -0,0 +1,44 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Debug
+{
+  enum class Level : std::uint8_t
+  {
+    Trace,
+    Info,
+    Warning,
+    Error,
+    Off
+  };
+
+  // Log lines are handed to a background thread through a bounded lock-free multi-producer ring, so
+  // logging from the main thread or from driver callback threads never waits on stdio.
+  namespace AsyncLog
+  {
+    size_t constexpr PAYLOAD_SIZE = 1000;
+    size_t constexpr CAPACITY = 1024; // Records, must be a power of two
+
+    struct Record
+    {
+      std::uint64_t timestamp_ns; // Since the writer thread started
+      std::uint32_t thread_id;    // Small sequential id, not the OS id
+      Level level;
+      std::uint16_t size;
+      char payload[PAYLOAD_SIZE];
+    };
+
+    // Never blocks. When the ring is full the record is dropped and counted instead.
+    bool push(Level level, char const *message, size_t size);
+
+    // Blocks until every record pushed before the call has been written out
+    void flush();
+
+    std::uint64_t droppedCount();
+  }
+}
+
+#endif // ASYNC_LOG_H
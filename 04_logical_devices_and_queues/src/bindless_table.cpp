@@ -0,0 +1,214 @@
+#include "bindless_table.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    void BindlessTable::init(
+      DeviceDispatch const &vk,
+      VkDevice device,
+      VkAllocationCallbacks const *allocator,
+      DescriptorLayoutCache &layouts,
+      VkPhysicalDeviceDescriptorIndexingPropertiesEXT const &limits,
+      std::uint32_t frames_in_flight,
+      std::uint32_t storage_buffer_capacity,
+      std::uint32_t texture_capacity)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->allocator = allocator;
+      this->frames_in_flight = std::max(frames_in_flight, 1u);
+
+      buffers = Slots();
+      buffers.capacity = std::min({
+        storage_buffer_capacity,
+        limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers
+      });
+      textures = Slots();
+      textures.capacity = std::min({
+        texture_capacity,
+        limits.maxDescriptorSetUpdateAfterBindSampledImages,
+        limits.maxDescriptorSetUpdateAfterBindSamplers,
+        limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        limits.maxPerStageDescriptorUpdateAfterBindSamplers
+      });
+      // Every stage sees both bindings, and both count towards the stage's total
+      std::uint32_t const resources = limits.maxPerStageUpdateAfterBindResources;
+      buffers.capacity = std::min(buffers.capacity, resources);
+      textures.capacity = std::min(textures.capacity, resources - buffers.capacity);
+
+      VkDescriptorSetLayoutBinding bindings[2] = {};
+      bindings[0].binding = STORAGE_BUFFER_BINDING;
+      bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bindings[0].descriptorCount = buffers.capacity;
+      bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+      bindings[1].binding = TEXTURE_BINDING;
+      bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[1].descriptorCount = textures.capacity;
+      bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+      // Slots nothing was written to are fine as long as shaders don't read them
+      VkDescriptorBindingFlagsEXT const binding_flags =
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+      set_layout = layouts.setLayout(
+        { bindings[0], bindings[1] },
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT,
+        { binding_flags, binding_flags }
+      );
+
+      VkDescriptorPoolSize sizes[2] = {};
+      sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      sizes[0].descriptorCount = std::max(buffers.capacity, 1u);
+      sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      sizes[1].descriptorCount = std::max(textures.capacity, 1u);
+
+      VkDescriptorPoolCreateInfo pool_info = {};
+      pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+      pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+      pool_info.maxSets = 1;
+      pool_info.poolSizeCount = 2;
+      pool_info.pPoolSizes = sizes;
+      if (vk.vkCreateDescriptorPool(device, &pool_info, allocator, &pool) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create the bindless descriptor pool");
+      }
+
+      VkDescriptorSetAllocateInfo allocate_info = {};
+      allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+      allocate_info.descriptorPool = pool;
+      allocate_info.descriptorSetCount = 1;
+      allocate_info.pSetLayouts = &set_layout;
+      if (vk.vkAllocateDescriptorSets(device, &allocate_info, &set) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to allocate the bindless descriptor set");
+      }
+
+      Debug::Trace(
+        "Bindless table with {} storage buffer and {} texture slots", buffers.capacity, textures.capacity
+      );
+    }
+
+    void BindlessTable::destroy()
+    {
+      if (pool != VK_NULL_HANDLE)
+      {
+        vk->vkDestroyDescriptorPool(device, pool, allocator);
+      }
+      pool = VK_NULL_HANDLE;
+      set = VK_NULL_HANDLE;
+      set_layout = VK_NULL_HANDLE;
+      buffers = Slots();
+      textures = Slots();
+    }
+
+    void BindlessTable::beginFrame()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++frame_number;
+      for (Slots *slots : { &buffers, &textures })
+      {
+        // A slot released during a frame is free once that frame has finished, which the wait before the frame
+        // frames_in_flight later makes sure of
+        auto finished = std::stable_partition(
+          slots->retired.begin(), slots->retired.end(), [this](std::pair<std::uint32_t, std::uint64_t> const &slot)
+          {
+            return slot.second + frames_in_flight > frame_number;
+          }
+        );
+        for (auto it=finished; it!=slots->retired.end(); ++it)
+        {
+          slots->free.push_back(it->first);
+        }
+        slots->retired.erase(finished, slots->retired.end());
+      }
+    }
+
+    std::uint32_t BindlessTable::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+    {
+      VkDescriptorBufferInfo buffer_info = {};
+      buffer_info.buffer = buffer;
+      buffer_info.offset = offset;
+      buffer_info.range = range;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::uint32_t const slot = claim(buffers, "storage buffer");
+
+      VkWriteDescriptorSet descriptor_write = {};
+      descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      descriptor_write.dstSet = set;
+      descriptor_write.dstBinding = STORAGE_BUFFER_BINDING;
+      descriptor_write.dstArrayElement = slot;
+      descriptor_write.descriptorCount = 1;
+      descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      descriptor_write.pBufferInfo = &buffer_info;
+      vk->vkUpdateDescriptorSets(device, 1, &descriptor_write, 0, nullptr);
+      return slot;
+    }
+
+    std::uint32_t BindlessTable::addTexture(VkImageView view, VkImageLayout layout, VkSampler sampler)
+    {
+      VkDescriptorImageInfo image_info = {};
+      image_info.sampler = sampler;
+      image_info.imageView = view;
+      image_info.imageLayout = layout;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::uint32_t const slot = claim(textures, "texture");
+
+      VkWriteDescriptorSet descriptor_write = {};
+      descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      descriptor_write.dstSet = set;
+      descriptor_write.dstBinding = TEXTURE_BINDING;
+      descriptor_write.dstArrayElement = slot;
+      descriptor_write.descriptorCount = 1;
+      descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      descriptor_write.pImageInfo = &image_info;
+      vk->vkUpdateDescriptorSets(device, 1, &descriptor_write, 0, nullptr);
+      return slot;
+    }
+
+    void BindlessTable::releaseStorageBuffer(std::uint32_t slot)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      release(buffers, slot);
+    }
+
+    void BindlessTable::releaseTexture(std::uint32_t slot)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      release(textures, slot);
+    }
+
+    std::uint32_t BindlessTable::claim(Slots &slots, char const *kind)
+    {
+      if (!slots.free.empty())
+      {
+        std::uint32_t const slot = slots.free.back();
+        slots.free.pop_back();
+        return slot;
+      }
+      if (slots.next == slots.capacity)
+      {
+        throw std::runtime_error(std::string("ERROR: The bindless table is out of ") + kind + " slots");
+      }
+      return slots.next++;
+    }
+
+    void BindlessTable::release(Slots &slots, std::uint32_t slot)
+    {
+      slots.retired.emplace_back(slot, frame_number);
+    }
+  }
+#endif
+
+}
@@ -0,0 +1,93 @@
+#ifndef BINDLESS_TABLE_H
+#define BINDLESS_TABLE_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "descriptor_layout_cache.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // One descriptor set holding every storage buffer and texture, bound once and indexed from shaders by slot,
+    // so draws need no descriptor sets of their own for them. Needs VK_EXT_descriptor_indexing: the set is
+    // updated after it is bound, and slots no frame in flight reads can change while those frames run. A
+    // released slot is only handed out again once every frame that might still read it has finished. Safe to use
+    // from several threads.
+    class BindlessTable
+    {
+    public:
+      // In the set, as shaders declare them:
+      //   layout(set = N, binding = 0) buffer Buffers { ... } buffers[];
+      //   layout(set = N, binding = 1) uniform sampler2D textures[];
+      static std::uint32_t constexpr STORAGE_BUFFER_BINDING = 0;
+      static std::uint32_t constexpr TEXTURE_BINDING = 1;
+
+      // Capacities are lowered to what the device's update-after-bind limits allow
+      void init(
+        DeviceDispatch const &vk,
+        VkDevice device,
+        VkAllocationCallbacks const *allocator,
+        DescriptorLayoutCache &layouts,
+        VkPhysicalDeviceDescriptorIndexingPropertiesEXT const &limits,
+        std::uint32_t frames_in_flight,
+        std::uint32_t storage_buffer_capacity = 1024,
+        std::uint32_t texture_capacity = 16384
+      );
+      void destroy();
+      bool isEnabled() const { return set != VK_NULL_HANDLE; }
+
+      // Counts frames for slot recycling. Called once per frame, after waiting for the frame the slot is reused
+      // from, as with the other per-frame resources.
+      void beginFrame();
+
+      // Slot indices, throwing when the table is full
+      std::uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+      std::uint32_t addTexture(VkImageView view, VkImageLayout layout, VkSampler sampler);
+      void releaseStorageBuffer(std::uint32_t slot);
+      void releaseTexture(std::uint32_t slot);
+
+      // For DescriptorLayoutCache::pipelineLayout's set overrides
+      VkDescriptorSetLayout layout() const { return set_layout; }
+      VkDescriptorSet descriptorSet() const { return set; }
+      std::uint32_t storageBufferCapacity() const { return buffers.capacity; }
+      std::uint32_t textureCapacity() const { return textures.capacity; }
+
+    private:
+      struct Slots
+      {
+        std::uint32_t capacity = 0;
+        std::uint32_t next = 0; // Never handed out at or past this
+        std::vector<std::uint32_t> free;
+        // Released slots with the frame they were released in
+        std::vector<std::pair<std::uint32_t, std::uint64_t>> retired;
+      };
+
+      std::uint32_t claim(Slots &slots, char const *kind);
+      void release(Slots &slots, std::uint32_t slot);
+
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+      VkDescriptorSetLayout set_layout = VK_NULL_HANDLE; // Owned by the layout cache
+      VkDescriptorPool pool = VK_NULL_HANDLE;
+      VkDescriptorSet set = VK_NULL_HANDLE;
+      std::uint32_t frames_in_flight = 1;
+
+      std::mutex mutex;
+      std::uint64_t frame_number = 0;
+      Slots buffers;
+      Slots textures;
+    };
+  }
+#endif
+
+}
+
+#endif // BINDLESS_TABLE_H
@@ -0,0 +1,16 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace Clock
+{
+  // Time from start to now on the steady clock, for durations written to the log
+  inline std::int64_t microsecondsSince(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+#endif // CLOCK_H
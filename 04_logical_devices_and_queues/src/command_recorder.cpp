@@ -0,0 +1,152 @@
+#include "command_recorder.h"
+#include "parallel_for.h"
+#include "profiler.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    void CommandRecorder::init(
+      DeviceDispatch const &vk,
+      VkDevice device,
+      VkAllocationCallbacks const *allocator,
+      std::uint32_t queue_family,
+      std::uint32_t frames_in_flight,
+      std::uint32_t thread_count)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->allocator = allocator;
+      this->thread_count = std::max(thread_count, 1u);
+
+      // Buffers are only ever reset along with their pool
+      VkCommandPoolCreateInfo pool_info = {};
+      pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+      pool_info.queueFamilyIndex = queue_family;
+
+      pools.resize(std::max(frames_in_flight, 1u) * this->thread_count);
+      for (ThreadPool &pool : pools)
+      {
+        if (vk.vkCreateCommandPool(device, &pool_info, allocator, &(pool.pool)) != VK_SUCCESS)
+        {
+          throw std::runtime_error("ERROR: Failed to create a recording thread's command pool");
+        }
+      }
+
+      Debug::Trace("Command recorder with {} pools for {} threads", pools.size(), this->thread_count);
+    }
+
+    void CommandRecorder::destroy()
+    {
+      for (ThreadPool &pool : pools)
+      {
+        // Destroying the pool frees its buffers with it
+        vk->vkDestroyCommandPool(device, pool.pool, allocator);
+      }
+      pools.clear();
+      slice_buffers.clear();
+    }
+
+    void CommandRecorder::beginFrame(std::uint32_t frame)
+    {
+      current_frame = frame % static_cast<std::uint32_t>(pools.size() / thread_count);
+      for (std::uint32_t thread=0; thread<thread_count; ++thread)
+      {
+        ThreadPool &pool = pools[current_frame * thread_count + thread];
+        if (pool.used > 0)
+        {
+          vk->vkResetCommandPool(device, pool.pool, 0);
+          pool.used = 0;
+        }
+      }
+    }
+
+    void CommandRecorder::record(
+      Jobs::JobPool &job_pool,
+      VkCommandBuffer primary,
+      VkCommandBufferInheritanceInfo const &inheritance,
+      std::uint32_t item_count,
+      std::uint32_t slice_size,
+      RecordFunction const &function)
+    {
+      PROFILE_ZONE("Record secondary command buffers");
+
+      slice_size = std::max(slice_size, 1u);
+      std::uint32_t slice_count = (item_count + slice_size - 1) / slice_size;
+      if (slice_count == 0)
+      {
+        return;
+      }
+      slice_buffers.assign(slice_count, VK_NULL_HANDLE);
+
+      VkCommandBufferBeginInfo begin_info = {};
+      begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      if (inheritance.renderPass != VK_NULL_HANDLE)
+      {
+        begin_info.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+      }
+      begin_info.pInheritanceInfo = &inheritance;
+
+      Jobs::parallelFor(
+        job_pool, slice_count, thread_count,
+        [this, &begin_info, &function, item_count, slice_size](std::uint32_t slice, std::uint32_t thread)
+        {
+          VkCommandBuffer command_buffer = nextBuffer(pools[current_frame * thread_count + thread]);
+          vk->vkBeginCommandBuffer(command_buffer, &begin_info);
+
+          std::uint32_t begin = slice * slice_size;
+          function(command_buffer, begin, std::min(begin + slice_size, item_count), thread);
+
+          if (vk->vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+          {
+            throw std::runtime_error("ERROR: Failed to record a secondary command buffer");
+          }
+          slice_buffers[slice] = command_buffer;
+        }
+      );
+
+      vk->vkCmdExecuteCommands(primary, slice_count, slice_buffers.data());
+    }
+
+    std::uint32_t CommandRecorder::bufferCount() const
+    {
+      size_t count = 0;
+      for (ThreadPool const &pool : pools)
+      {
+        count += pool.buffers.size();
+      }
+      return static_cast<std::uint32_t>(count);
+    }
+
+    VkCommandBuffer CommandRecorder::nextBuffer(ThreadPool &pool)
+    {
+      if (pool.used == pool.buffers.size())
+      {
+        VkCommandBufferAllocateInfo allocate_info = {};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = pool.pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocate_info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        if (vk->vkAllocateCommandBuffers(device, &allocate_info, &command_buffer) != VK_SUCCESS)
+        {
+          throw std::runtime_error("ERROR: Failed to allocate a secondary command buffer");
+        }
+        pool.buffers.push_back(command_buffer);
+      }
+
+      return pool.buffers[pool.used++];
+    }
+  }
+#endif
+
+}
@@ -0,0 +1,83 @@
+#ifndef COMMAND_RECORDER_H
+#define COMMAND_RECORDER_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "job_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Records a draw list into secondary command buffers on the job pool's workers and the calling thread at
+    // once. Every recording thread has a command pool of its own per frame in flight, so pools need no
+    // locking, and a frame's pools are reset wholesale when the frame comes round rather than their
+    // buffers being freed one by one.
+    class CommandRecorder
+    {
+    public:
+      // Records items [begin, end) of the list into a secondary command buffer that is already begun. thread is
+      // the recording thread's index, below threadCount(), for per-thread resources such as descriptor pools.
+      using RecordFunction = std::function<
+        void(VkCommandBuffer command_buffer, std::uint32_t begin, std::uint32_t end, std::uint32_t thread)
+      >;
+
+      // thread_count is how many threads may record at once, the job pool's workers plus the caller
+      void init(
+        DeviceDispatch const &vk,
+        VkDevice device,
+        VkAllocationCallbacks const *allocator,
+        std::uint32_t queue_family,
+        std::uint32_t frames_in_flight,
+        std::uint32_t thread_count
+      );
+      void destroy();
+
+      // Resets the frame's command pools. The GPU must be done with what was last recorded for the frame.
+      void beginFrame(std::uint32_t frame);
+      // Splits item_count items into slices of up to slice_size, records each slice into a secondary command
+      // buffer of its own, spread over the job pool with work stealing, then executes them from primary in
+      // list order. inheritance describes the render pass, if any, primary is inside.
+      void record(
+        Jobs::JobPool &job_pool,
+        VkCommandBuffer primary,
+        VkCommandBufferInheritanceInfo const &inheritance,
+        std::uint32_t item_count,
+        std::uint32_t slice_size,
+        RecordFunction const &function
+      );
+
+      std::uint32_t threadCount() const { return thread_count; }
+      // Secondary command buffers allocated over all pools; they are reused frame after frame
+      std::uint32_t bufferCount() const;
+
+    private:
+      struct ThreadPool
+      {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        std::uint32_t used = 0; // Buffers handed out since the pool was last reset
+      };
+
+      VkCommandBuffer nextBuffer(ThreadPool &pool);
+
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+      std::uint32_t thread_count = 0;
+      std::uint32_t current_frame = 0;
+      std::vector<ThreadPool> pools; // thread_count per frame in flight
+      std::vector<VkCommandBuffer> slice_buffers;
+    };
+  }
+#endif
+
+}
+
+#endif // COMMAND_RECORDER_H
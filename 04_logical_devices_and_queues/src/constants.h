@@ -7,6 +7,20 @@ namespace Constants
 int constexpr WIDTH = 800;
 int constexpr HEIGHT = 600;
 
+// Without a window there is nothing to close, so headless runs stop after a fixed number of frames
+unsigned constexpr HEADLESS_FRAME_COUNT = 1000;
+
+// Frames per second the run loop sleeps to hold, 0 for as fast as possible. Headless runs aren't paced by
+// default, so they keep working as a quick benchmark.
+double constexpr TARGET_FRAME_RATE = 60.0;
+double constexpr HEADLESS_TARGET_FRAME_RATE = 0.0;
+
+// How often, in seconds, a run loop with nothing to render still wakes to move streaming and uploads along
+double constexpr BACKGROUND_WORK_INTERVAL = 0.01;
+
+// Where builds configured with VTI_PROFILING write their Chrome trace on exit
+char const *const TRACE_PATH = "trace.json";
+
 }
 
 #endif // CONSTANTS_H
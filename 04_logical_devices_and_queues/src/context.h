@@ -1,6 +1,27 @@
 #ifndef CONTEXT_H
 #define CONTEXT_H
 
+#include "init.h"
+#include "dispatch.h"
+#include "asset_streamer.h"
+#include "bindless_table.h"
+#include "command_recorder.h"
+#include "descriptor_allocator.h"
+#include "descriptor_layout_cache.h"
+#include "device_memory.h"
+#include "device_selection.h"
+#include "gpu_profiler.h"
+#include "host_allocator.h"
+#include "job_pool.h"
+#include "pipeline_library.h"
+#include "queue_families.h"
+#include "queue_submission.h"
+#include "transfer_engine.h"
+#include "validation_filter.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 struct Context
@@ -8,22 +29,138 @@ struct Context
   struct Window
   {
     #ifdef USING_GLFW
-      GLFWwindow *window;
+      GLFWwindow *window = nullptr;
     #endif
   };
 
   struct Graphics
   {
     #ifdef USING_VULKAN
-      VkInstance instance;
+      // Highest version both the loader and this code support, picked in createInstance
+      std::uint32_t api_version = VK_API_VERSION_1_0;
+      VkInstance instance = VK_NULL_HANDLE;
       VkPhysicalDevice physical_device = VK_NULL_HANDLE; // For now we only pick one physical device
+      VkPhysicalDeviceProperties physical_device_properties = {};
+      VkDevice device = VK_NULL_HANDLE;
+      VkQueue graphics_queue = VK_NULL_HANDLE;
+      // Without a dedicated family, compute and transfer get a queue of their own from the graphics family
+      // if it has queues to spare, and otherwise share the graphics queue
+      VkQueue compute_queue = VK_NULL_HANDLE;
+      VkQueue transfer_queue = VK_NULL_HANDLE;
+      #ifdef USING_GLFW
+        VkQueue present_queue = VK_NULL_HANDLE;
+      #endif
+
+      // Used for each role's queue; a queue shared by several roles takes the highest of their priorities
+      struct QueuePriorities
+      {
+        float graphics = 1.0f;
+        float compute = 0.5f;
+        float transfer = 0.5f;
+      } queue_priorities;
+
+      // Submissions go through these rather than straight to vkQueueSubmit. There is one per distinct VkQueue,
+      // and roles sharing a queue point at the same one.
+      ::Graphics::Vulkan::SyncPool sync_pool;
+      std::vector<std::unique_ptr<::Graphics::Vulkan::SubmitQueue>> submit_queues;
+      ::Graphics::Vulkan::SubmitQueue *graphics_submit = nullptr;
+      ::Graphics::Vulkan::SubmitQueue *compute_submit = nullptr;
+      ::Graphics::Vulkan::SubmitQueue *transfer_submit = nullptr;
+      ::Graphics::Vulkan::QueueFamilyIndices queue_families;
+      // VK_KHR_timeline_semaphore, enabled whenever the device has it
+      bool timeline_semaphores_enabled = false;
+      // Uploads buffer and image data on the transfer queue for the graphics queue family
+      ::Graphics::Vulkan::TransferEngine transfer_engine;
+      // Streams assets from files through the job pool and the transfer engine, updated once a frame
+      ::Graphics::Vulkan::AssetStreamer asset_streamer;
+      // Frames the CPU may record while the GPU still works on earlier ones, each with resources of its own
+      std::uint32_t frames_in_flight = 2;
+      // Times passes recorded for the graphics queue
+      ::Graphics::Vulkan::GpuProfiler gpu_profiler;
+
+      // Replaces the default device ranking when set
+      std::shared_ptr<::Graphics::Vulkan::DeviceScoringPolicy const> device_scoring_policy;
+      // The chosen device is remembered here until a device or driver changes. Empty disables the cache.
+      std::string device_cache_path = "device_selection.cache";
+
+      // Passed to every pipeline creation, and kept on disk between runs so warm starts skip shader compiles.
+      // Empty path disables loading and saving.
+      VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+      std::string pipeline_cache_path = "pipeline.cache";
+      std::uint64_t pipeline_cache_hash = 0; // Of the data last loaded or saved
+
+      // Workers for anything that can run off the main thread, shader and pipeline creation to begin with
+      Jobs::JobPool job_pool;
+      ::Graphics::Vulkan::PipelineLibrary pipeline_library;
+      // Records draw lists for the graphics queue across the job pool, one command pool per thread and frame
+      ::Graphics::Vulkan::CommandRecorder command_recorder;
+      // Set and pipeline layouts by content, and the sets draws bind, from pools per thread and frame in the same
+      // way as the command recorder's
+      ::Graphics::Vulkan::DescriptorLayoutCache descriptor_layouts;
+      ::Graphics::Vulkan::DescriptorAllocator descriptor_allocator;
+      // VK_EXT_descriptor_indexing, enabled whenever the device has what the bindless table needs. Found out
+      // while picking the device, along with the limits the table is sized by.
+      bool descriptor_indexing_enabled = false;
+      VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptor_indexing_limits = {};
+      // Every texture and storage buffer in one set, when descriptor_indexing_enabled
+      ::Graphics::Vulkan::BindlessTable bindless_table;
+
       std::vector<VkExtensionProperties> extensions;
 
+      // VK_EXT_debug_utils is enabled whenever the loader exposes it, release builds included, so object
+      // names and labels show up in profilers and capture tools. Its functions stay null otherwise.
+      bool debug_utils_enabled = false;
+
+      // Host memory for the Vulkan implementation, passed to every create and destroy call
+      ::Graphics::Vulkan::HostAllocator host_allocator;
+      // Buffers and images get their memory from here rather than from vkAllocateMemory
+      ::Graphics::Vulkan::DeviceMemoryAllocator memory_allocator;
+
+      // Every Vulkan call goes through these rather than the loader's exported functions
+      ::Graphics::Vulkan::InstanceDispatch instance_functions;
+      ::Graphics::Vulkan::DeviceDispatch device_functions;
+
+      #ifndef USING_GLFW
+        // Without a swap chain, frames are rendered into an image and copied into a host visible buffer
+        // that stays mapped for the lifetime of the context
+        struct Offscreen
+        {
+          // One per frame in flight, reused once the GPU is done with the frame that last used it
+          struct Frame
+          {
+            VkCommandPool command_pool = VK_NULL_HANDLE;
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            VkBuffer readback_buffer = VK_NULL_HANDLE;
+            ::Graphics::Vulkan::DeviceAllocation *readback_memory = nullptr;
+            ::Graphics::Vulkan::SubmitTicket ticket;
+            std::uint64_t number = 0; // 1 + frame_count of the frame last recorded here, 0 if none yet
+          };
+
+          // Shared by every frame; barriers order each frame's use of it after the previous one's
+          VkImage image = VK_NULL_HANDLE;
+          ::Graphics::Vulkan::DeviceAllocation *image_memory = nullptr;
+          std::vector<Frame> frames;
+          // The readback of the latest frame known to have finished. Stays valid until the next frame is rendered.
+          void const *pixels = nullptr;
+          std::uint64_t frame_count = 0;
+        } offscreen;
+      #endif
+
       #ifndef NDEBUG
         std::vector<char const *> validation_layers = {
           "VK_LAYER_LUNARG_standard_validation"
         };
+        VkDebugUtilsMessageSeverityFlagsEXT debug_message_severity =
+          VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        VkDebugUtilsMessageTypeFlagsEXT debug_message_types =
+          VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+          VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+          VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        VkDebugUtilsMessengerEXT debug_messenger = VK_NULL_HANDLE;
+        // Fallback when VK_EXT_debug_utils isn't available
         std::vector<VkDebugReportCallbackEXT> debug_report_callbacks;
+        // Per-message repeat counters, queryable while running
+        ::Graphics::Vulkan::ValidationFilter validation_messages;
       #endif
     #endif
   };
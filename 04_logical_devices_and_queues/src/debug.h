@@ -1,30 +1,191 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
-#include <iostream>
+#include "async_log.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <string>
+#include <type_traits>
 
 namespace Debug
 {
-  inline void Log()
+  // Anything below MIN_LEVEL compiles to nothing, arguments included.
+  // Override with -DDEBUG_LOG_LEVEL=<0 (Trace) .. 4 (Off)>
+  #if defined(DEBUG_LOG_LEVEL)
+    Level constexpr MIN_LEVEL = static_cast<Level>(DEBUG_LOG_LEVEL);
+  #elif defined(NDEBUG)
+    Level constexpr MIN_LEVEL = Level::Off;
+  #else
+    Level constexpr MIN_LEVEL = Level::Trace;
+  #endif
+
+  template <Level level>
+  bool constexpr isEnabled()
+  {
+    return level != Level::Off && level >= MIN_LEVEL;
+  }
+
+  namespace Detail
+  {
+    // A message is formatted on the stack and copied into the async log ring, so logging never allocates.
+    // Messages longer than a record payload are truncated.
+    struct LineBuffer
+    {
+      static size_t constexpr CAPACITY = AsyncLog::PAYLOAD_SIZE;
+
+      char data[CAPACITY];
+      size_t size = 0;
+
+      void append(char const *text, size_t length)
+      {
+        size_t space = CAPACITY - size;
+        length = length < space ? length : space;
+        std::memcpy(data + size, text, length);
+        size += length;
+      }
+
+      void append(char const *text)
+      {
+        append(text, std::strlen(text));
+      }
+
+      template <typename... Args>
+      void appendPrintf(char const *format, Args... args)
+      {
+        // snprintf needs room for its terminator, which isn't counted in size
+        if (size + 1 >= CAPACITY)
+        {
+          return;
+        }
+
+        int written = std::snprintf(data + size, CAPACITY - size, format, args...);
+        if (written > 0)
+        {
+          size_t space = CAPACITY - size - 1;
+          size += static_cast<size_t>(written) < space ? static_cast<size_t>(written) : space;
+        }
+      }
+    };
+
+    inline void appendArg(LineBuffer &buffer, char const *value)
+    {
+      buffer.append(value != nullptr ? value : "(null)");
+    }
+
+    inline void appendArg(LineBuffer &buffer, std::string const &value)
+    {
+      buffer.append(value.data(), value.size());
+    }
+
+    inline void appendArg(LineBuffer &buffer, bool value)
+    {
+      buffer.append(value ? "true" : "false");
+    }
+
+    inline void appendArg(LineBuffer &buffer, char value)
+    {
+      buffer.append(&value, 1);
+    }
+
+    inline void appendArg(LineBuffer &buffer, void const *value)
+    {
+      buffer.appendPrintf("%p", value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    appendArg(LineBuffer &buffer, T value)
+    {
+      buffer.appendPrintf("%lld", static_cast<long long>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    appendArg(LineBuffer &buffer, T value)
+    {
+      buffer.appendPrintf("%llu", static_cast<unsigned long long>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    appendArg(LineBuffer &buffer, T value)
+    {
+      buffer.appendPrintf("%g", static_cast<double>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type
+    appendArg(LineBuffer &buffer, T value)
+    {
+      appendArg(buffer, static_cast<typename std::underlying_type<T>::type>(value));
+    }
+
+    inline void format(LineBuffer &buffer, char const *format)
+    {
+      buffer.append(format);
+    }
+
+    // Each "{}" in the format string is replaced by the next argument
+    template <typename T, typename... Args>
+    void format(LineBuffer &buffer, char const *format, T const &arg, Args const &... args)
+    {
+      char const *placeholder = std::strstr(format, "{}");
+      if (placeholder == nullptr)
+      {
+        buffer.append(format);
+        return;
+      }
+
+      buffer.append(format, static_cast<size_t>(placeholder - format));
+      appendArg(buffer, arg);
+      Detail::format(buffer, placeholder + 2, args...);
+    }
+  }
+
+  template <Level level, typename... Args>
+  inline void Log([[maybe_unused]] char const *format, [[maybe_unused]] Args const &... args)
+  {
+    if constexpr (isEnabled<level>())
+    {
+      Detail::LineBuffer buffer;
+      Detail::format(buffer, format, args...);
+      AsyncLog::push(level, buffer.data, buffer.size);
+    }
+  }
+
+  // Waits for queued log lines to reach the terminal, e.g. before reporting a fatal error
+  inline void Flush()
+  {
+    if constexpr (MIN_LEVEL != Level::Off)
+    {
+      AsyncLog::flush();
+    }
+  }
+
+  template <typename... Args>
+  inline void Trace(char const *format, Args const &... args)
+  {
+    Log<Level::Trace>(format, args...);
+  }
+
+  template <typename... Args>
+  inline void Info(char const *format, Args const &... args)
   {
-    #ifndef NDEBUG
-      std::cout << '\n';
-    #endif
+    Log<Level::Info>(format, args...);
   }
 
-  inline void Log(std::string const &message)
+  template <typename... Args>
+  inline void Warning(char const *format, Args const &... args)
   {
-    #ifndef NDEBUG
-      std::cout << message << '\n';
-    #endif
+    Log<Level::Warning>(format, args...);
   }
 
-  inline void Log(std::string const &level, std::string const &message)
+  template <typename... Args>
+  inline void Error(char const *format, Args const &... args)
   {
-    #ifndef NDEBUG
-      std::cout << level << ": " << message << '\n';
-    #endif
+    Log<Level::Error>(format, args...);
   }
 }
 
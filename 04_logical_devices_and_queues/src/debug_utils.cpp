@@ -0,0 +1,112 @@
+#include "debug_utils.h"
+#include "debug.h"
+
+#ifdef USING_VULKAN
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    static VkDebugUtilsLabelEXT makeLabel(char const *name, float const (&color)[4])
+    {
+      VkDebugUtilsLabelEXT label = {};
+      label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+      label.pLabelName = name;
+      for (int i=0; i<4; ++i)
+      {
+        label.color[i] = color[i];
+      }
+      return label;
+    }
+
+    // A zero colour tells tools to pick their own
+    static float constexpr NO_COLOR[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    void setObjectName(
+      Context::Graphics const &context,
+      VkObjectType object_type,
+      std::uint64_t object,
+      char const *name)
+    {
+      if (context.instance_functions.vkSetDebugUtilsObjectNameEXT == nullptr || context.device == VK_NULL_HANDLE)
+      {
+        return;
+      }
+
+      VkDebugUtilsObjectNameInfoEXT name_info = {};
+      name_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+      name_info.objectType = object_type;
+      name_info.objectHandle = object;
+      name_info.pObjectName = name;
+      context.instance_functions.vkSetDebugUtilsObjectNameEXT(context.device, &name_info);
+    }
+
+    void beginQueueLabel(Context::Graphics const &context, VkQueue queue, char const *name, float const (&color)[4])
+    {
+      if (context.instance_functions.vkQueueBeginDebugUtilsLabelEXT != nullptr)
+      {
+        VkDebugUtilsLabelEXT label = makeLabel(name, color);
+        context.instance_functions.vkQueueBeginDebugUtilsLabelEXT(queue, &label);
+      }
+    }
+
+    void beginQueueLabel(Context::Graphics const &context, VkQueue queue, char const *name)
+    {
+      beginQueueLabel(context, queue, name, NO_COLOR);
+    }
+
+    void endQueueLabel(Context::Graphics const &context, VkQueue queue)
+    {
+      if (context.instance_functions.vkQueueEndDebugUtilsLabelEXT != nullptr)
+      {
+        context.instance_functions.vkQueueEndDebugUtilsLabelEXT(queue);
+      }
+    }
+
+    void insertQueueLabel(Context::Graphics const &context, VkQueue queue, char const *name)
+    {
+      if (context.instance_functions.vkQueueInsertDebugUtilsLabelEXT != nullptr)
+      {
+        VkDebugUtilsLabelEXT label = makeLabel(name, NO_COLOR);
+        context.instance_functions.vkQueueInsertDebugUtilsLabelEXT(queue, &label);
+      }
+    }
+
+    void beginCommandBufferLabel(
+      Context::Graphics const &context,
+      VkCommandBuffer command_buffer,
+      char const *name,
+      float const (&color)[4])
+    {
+      if (context.instance_functions.vkCmdBeginDebugUtilsLabelEXT != nullptr)
+      {
+        VkDebugUtilsLabelEXT label = makeLabel(name, color);
+        context.instance_functions.vkCmdBeginDebugUtilsLabelEXT(command_buffer, &label);
+      }
+    }
+
+    void beginCommandBufferLabel(Context::Graphics const &context, VkCommandBuffer command_buffer, char const *name)
+    {
+      beginCommandBufferLabel(context, command_buffer, name, NO_COLOR);
+    }
+
+    void endCommandBufferLabel(Context::Graphics const &context, VkCommandBuffer command_buffer)
+    {
+      if (context.instance_functions.vkCmdEndDebugUtilsLabelEXT != nullptr)
+      {
+        context.instance_functions.vkCmdEndDebugUtilsLabelEXT(command_buffer);
+      }
+    }
+
+    void insertCommandBufferLabel(Context::Graphics const &context, VkCommandBuffer command_buffer, char const *name)
+    {
+      if (context.instance_functions.vkCmdInsertDebugUtilsLabelEXT != nullptr)
+      {
+        VkDebugUtilsLabelEXT label = makeLabel(name, NO_COLOR);
+        context.instance_functions.vkCmdInsertDebugUtilsLabelEXT(command_buffer, &label);
+      }
+    }
+  }
+}
+
+#endif
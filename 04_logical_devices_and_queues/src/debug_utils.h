@@ -0,0 +1,47 @@
+#ifndef DEBUG_UTILS_H
+#define DEBUG_UTILS_H
+
+#include "context.h"
+
+#include <cstdint>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // All of these are no-ops when VK_EXT_debug_utils isn't enabled
+    void setObjectName(
+      Context::Graphics const &context,
+      VkObjectType object_type,
+      std::uint64_t object,
+      char const *name
+    );
+
+    template <typename Handle>
+    void setObjectName(Context::Graphics const &context, VkObjectType object_type, Handle object, char const *name)
+    {
+      setObjectName(context, object_type, reinterpret_cast<std::uint64_t>(object), name);
+    }
+
+    void beginQueueLabel(Context::Graphics const &context, VkQueue queue, char const *name, float const (&color)[4]);
+    void beginQueueLabel(Context::Graphics const &context, VkQueue queue, char const *name);
+    void endQueueLabel(Context::Graphics const &context, VkQueue queue);
+    void insertQueueLabel(Context::Graphics const &context, VkQueue queue, char const *name);
+
+    void beginCommandBufferLabel(
+      Context::Graphics const &context,
+      VkCommandBuffer command_buffer,
+      char const *name,
+      float const (&color)[4]
+    );
+    void beginCommandBufferLabel(Context::Graphics const &context, VkCommandBuffer command_buffer, char const *name);
+    void endCommandBufferLabel(Context::Graphics const &context, VkCommandBuffer command_buffer);
+    void insertCommandBufferLabel(Context::Graphics const &context, VkCommandBuffer command_buffer, char const *name);
+  }
+#endif
+
+}
+
+#endif // DEBUG_UTILS_H
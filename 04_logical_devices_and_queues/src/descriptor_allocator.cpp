@@ -0,0 +1,354 @@
+#include "descriptor_allocator.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Which of VkWriteDescriptorSet's arrays a descriptor type is read from
+    enum class WriteKind
+    {
+      Buffer,
+      TexelBuffer,
+      Image,
+      Unsupported
+    };
+
+    static WriteKind writeKind(VkDescriptorType type)
+    {
+      switch (type)
+      {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+          return WriteKind::Buffer;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+          return WriteKind::TexelBuffer;
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+          return WriteKind::Image;
+        default:
+          return WriteKind::Unsupported;
+      }
+    }
+
+    static void checkWriteKind(VkDescriptorType type, WriteKind kind, char const *builder)
+    {
+      if (writeKind(type) != kind)
+      {
+        throw std::runtime_error(
+          "ERROR: Descriptor type " + std::to_string(type) + " can't be written with DescriptorWrites::" + builder
+        );
+      }
+    }
+
+    DescriptorWrites &DescriptorWrites::buffer(
+      std::uint32_t binding,
+      VkDescriptorType type,
+      VkBuffer buffer,
+      VkDeviceSize offset,
+      VkDeviceSize range,
+      std::uint32_t array_element)
+    {
+      checkWriteKind(type, WriteKind::Buffer, "buffer");
+
+      Write write = {};
+      write.binding = binding;
+      write.array_element = array_element;
+      write.type = type;
+      write.buffer_info.buffer = buffer;
+      write.buffer_info.offset = offset;
+      write.buffer_info.range = range;
+      writes.push_back(write);
+
+      hash_value = hashDescriptorKey(hash_value, binding);
+      hash_value = hashDescriptorKey(hash_value, array_element);
+      hash_value = hashDescriptorKey(hash_value, type);
+      hash_value = hashDescriptorKey(hash_value, buffer);
+      hash_value = hashDescriptorKey(hash_value, offset);
+      hash_value = hashDescriptorKey(hash_value, range);
+      return *this;
+    }
+
+    DescriptorWrites &DescriptorWrites::texelBuffer(
+      std::uint32_t binding,
+      VkDescriptorType type,
+      VkBufferView view,
+      std::uint32_t array_element)
+    {
+      checkWriteKind(type, WriteKind::TexelBuffer, "texelBuffer");
+
+      Write write = {};
+      write.binding = binding;
+      write.array_element = array_element;
+      write.type = type;
+      write.texel_buffer_view = view;
+      writes.push_back(write);
+
+      hash_value = hashDescriptorKey(hash_value, binding);
+      hash_value = hashDescriptorKey(hash_value, array_element);
+      hash_value = hashDescriptorKey(hash_value, type);
+      hash_value = hashDescriptorKey(hash_value, view);
+      return *this;
+    }
+
+    DescriptorWrites &DescriptorWrites::image(
+      std::uint32_t binding,
+      VkDescriptorType type,
+      VkImageView view,
+      VkImageLayout layout,
+      VkSampler sampler,
+      std::uint32_t array_element)
+    {
+      checkWriteKind(type, WriteKind::Image, "image");
+
+      Write write = {};
+      write.binding = binding;
+      write.array_element = array_element;
+      write.type = type;
+      write.image_info.sampler = sampler;
+      write.image_info.imageView = view;
+      write.image_info.imageLayout = layout;
+      writes.push_back(write);
+
+      hash_value = hashDescriptorKey(hash_value, binding);
+      hash_value = hashDescriptorKey(hash_value, array_element);
+      hash_value = hashDescriptorKey(hash_value, type);
+      hash_value = hashDescriptorKey(hash_value, view);
+      hash_value = hashDescriptorKey(hash_value, layout);
+      hash_value = hashDescriptorKey(hash_value, sampler);
+      return *this;
+    }
+
+    void DescriptorWrites::clear()
+    {
+      writes.clear();
+      hash_value = DESCRIPTOR_KEY_SEED;
+    }
+
+    bool DescriptorWrites::operator==(DescriptorWrites const &other) const
+    {
+      auto same_write = [](Write const &a, Write const &b)
+      {
+        return a.binding == b.binding && a.array_element == b.array_element && a.type == b.type &&
+          a.buffer_info.buffer == b.buffer_info.buffer && a.buffer_info.offset == b.buffer_info.offset &&
+          a.buffer_info.range == b.buffer_info.range &&
+          a.image_info.sampler == b.image_info.sampler && a.image_info.imageView == b.image_info.imageView &&
+          a.image_info.imageLayout == b.image_info.imageLayout && a.texel_buffer_view == b.texel_buffer_view;
+      };
+      return hash_value == other.hash_value &&
+        std::equal(writes.begin(), writes.end(), other.writes.begin(), other.writes.end(), same_write);
+    }
+
+    void DescriptorWrites::apply(DeviceDispatch const &vk, VkDevice device, VkDescriptorSet set) const
+    {
+      std::vector<VkWriteDescriptorSet> descriptor_writes(writes.size());
+      for (size_t i=0; i<writes.size(); ++i)
+      {
+        Write const &write = writes[i];
+        WriteKind const kind = writeKind(write.type);
+
+        VkWriteDescriptorSet &descriptor_write = descriptor_writes[i];
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet = set;
+        descriptor_write.dstBinding = write.binding;
+        descriptor_write.dstArrayElement = write.array_element;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.descriptorType = write.type;
+        descriptor_write.pBufferInfo = kind == WriteKind::Buffer ? &write.buffer_info : nullptr;
+        descriptor_write.pTexelBufferView = kind == WriteKind::TexelBuffer ? &write.texel_buffer_view : nullptr;
+        descriptor_write.pImageInfo = kind == WriteKind::Image ? &write.image_info : nullptr;
+      }
+      vk.vkUpdateDescriptorSets(
+        device, static_cast<std::uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr
+      );
+    }
+
+    void DescriptorAllocator::init(
+      DeviceDispatch const &vk,
+      VkDevice device,
+      VkAllocationCallbacks const *allocator,
+      std::uint32_t frames_in_flight,
+      std::uint32_t thread_count)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->allocator = allocator;
+      this->thread_count = std::max(thread_count, 1u);
+      current_frame = 0;
+
+      // Pools are created on first use, so threads that never allocate cost nothing
+      thread_pools.resize(std::max(frames_in_flight, 1u) * this->thread_count);
+      Debug::Trace("Descriptor allocator for {} threads over {} frames", this->thread_count, frames_in_flight);
+    }
+
+    void DescriptorAllocator::destroy()
+    {
+      for (ThreadPools &pools : thread_pools)
+      {
+        // Destroying a pool frees its sets with it
+        for (VkDescriptorPool pool : pools.pools)
+        {
+          vk->vkDestroyDescriptorPool(device, pool, allocator);
+        }
+      }
+      thread_pools.clear();
+    }
+
+    void DescriptorAllocator::beginFrame(std::uint32_t frame)
+    {
+      current_frame = frame % static_cast<std::uint32_t>(thread_pools.size() / thread_count);
+      for (std::uint32_t thread=0; thread<thread_count; ++thread)
+      {
+        ThreadPools &pools = thread_pools[current_frame * thread_count + thread];
+        if (pools.allocated == 0)
+        {
+          continue;
+        }
+        // Pools past current were never touched since their last reset
+        std::uint32_t const used = std::min(pools.current + 1, static_cast<std::uint32_t>(pools.pools.size()));
+        for (std::uint32_t i=0; i<used; ++i)
+        {
+          vk->vkResetDescriptorPool(device, pools.pools[i], 0);
+        }
+        pools.current = 0;
+        pools.current_sets = 0;
+        pools.allocated = 0;
+        pools.sets.clear();
+      }
+    }
+
+    VkDescriptorSet DescriptorAllocator::allocate(
+      std::uint32_t thread,
+      VkDescriptorSetLayout layout,
+      DescriptorWrites const &writes)
+    {
+      ThreadPools &pools = thread_pools[current_frame * thread_count + thread];
+      std::vector<CachedSet> &matches = pools.sets[hashDescriptorKey(writes.hash(), layout)];
+      for (CachedSet const &cached : matches)
+      {
+        if (cached.layout == layout && cached.writes == writes)
+        {
+          ++pools.reuses;
+          return cached.set;
+        }
+      }
+
+      VkDescriptorSet set = allocateFrom(pools, layout);
+      writes.apply(*vk, device, set);
+      matches.push_back(CachedSet{ layout, writes, set });
+      return set;
+    }
+
+    VkDescriptorSet DescriptorAllocator::allocate(std::uint32_t thread, VkDescriptorSetLayout layout)
+    {
+      return allocateFrom(thread_pools[current_frame * thread_count + thread], layout);
+    }
+
+    DescriptorAllocator::Stats DescriptorAllocator::stats() const
+    {
+      Stats stats;
+      for (ThreadPools const &pools : thread_pools)
+      {
+        stats.allocations += pools.allocations;
+        stats.reuses += pools.reuses;
+        stats.pools += static_cast<std::uint32_t>(pools.pools.size());
+      }
+      return stats;
+    }
+
+    void DescriptorAllocator::logStats() const
+    {
+      Stats const stats = this->stats();
+      if (stats.allocations == 0)
+      {
+        return;
+      }
+
+      Debug::Info(
+        "Descriptor sets: {} allocated, {} reused within their frame, from {} pools",
+        stats.allocations,
+        stats.reuses,
+        stats.pools
+      );
+    }
+
+    VkDescriptorSet DescriptorAllocator::allocateFrom(ThreadPools &pools, VkDescriptorSetLayout layout)
+    {
+      VkDescriptorSetAllocateInfo allocate_info = {};
+      allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+      allocate_info.descriptorSetCount = 1;
+      allocate_info.pSetLayouts = &layout;
+
+      for (;;)
+      {
+        if (pools.current == pools.pools.size())
+        {
+          pools.pools.push_back(createPool(pools.current));
+        }
+        allocate_info.descriptorPool = pools.pools[pools.current];
+
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkResult const result = vk->vkAllocateDescriptorSets(device, &allocate_info, &set);
+        if (result == VK_SUCCESS)
+        {
+          ++pools.current_sets;
+          ++pools.allocated;
+          ++pools.allocations;
+          return set;
+        }
+        // A pool that is full, or too fragmented for this layout, is left until the frame comes round again. Only
+        // Vulkan 1.1 and VK_KHR_maintenance1 say so with VK_ERROR_OUT_OF_POOL_MEMORY; before them a full pool
+        // fails with out of memory errors, so any failure from a pool already in use counts. One that can't fit
+        // the layout while empty never will.
+        if (pools.current_sets == 0)
+        {
+          throw std::runtime_error("ERROR: Failed to allocate a descriptor set");
+        }
+        ++pools.current;
+        pools.current_sets = 0;
+      }
+    }
+
+    VkDescriptorPool DescriptorAllocator::createPool(std::uint32_t index)
+    {
+      std::uint32_t const set_count = std::min(first_pool_sets << std::min(index, 16u), max_pool_sets);
+
+      std::vector<VkDescriptorPoolSize> sizes;
+      for (DescriptorPoolRatio const &ratio : pool_ratios)
+      {
+        VkDescriptorPoolSize size = {};
+        size.type = ratio.type;
+        size.descriptorCount = std::max(static_cast<std::uint32_t>(ratio.per_set * set_count), 1u);
+        sizes.push_back(size);
+      }
+
+      // Sets are never freed one by one, so the pool needs no FREE_DESCRIPTOR_SET_BIT
+      VkDescriptorPoolCreateInfo pool_info = {};
+      pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+      pool_info.maxSets = set_count;
+      pool_info.poolSizeCount = static_cast<std::uint32_t>(sizes.size());
+      pool_info.pPoolSizes = sizes.data();
+
+      VkDescriptorPool pool = VK_NULL_HANDLE;
+      if (vk->vkCreateDescriptorPool(device, &pool_info, allocator, &pool) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create a descriptor pool");
+      }
+      return pool;
+    }
+  }
+#endif
+
+}
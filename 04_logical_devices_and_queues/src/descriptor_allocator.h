@@ -0,0 +1,166 @@
+#ifndef DESCRIPTOR_ALLOCATOR_H
+#define DESCRIPTOR_ALLOCATOR_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "descriptor_layout_cache.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // What a descriptor set holds, one binding or array element at a time. Two lists making the same writes in
+    // the same order compare equal and hash the same. Each builder throws for descriptor types it can't write.
+    class DescriptorWrites
+    {
+    public:
+      DescriptorWrites &buffer(
+        std::uint32_t binding,
+        VkDescriptorType type,
+        VkBuffer buffer,
+        VkDeviceSize offset = 0,
+        VkDeviceSize range = VK_WHOLE_SIZE,
+        std::uint32_t array_element = 0
+      );
+      // For uniform and storage texel buffers
+      DescriptorWrites &texelBuffer(
+        std::uint32_t binding,
+        VkDescriptorType type,
+        VkBufferView view,
+        std::uint32_t array_element = 0
+      );
+      // For samplers, images and input attachments. sampler is only read for samplers and combined image
+      // samplers.
+      DescriptorWrites &image(
+        std::uint32_t binding,
+        VkDescriptorType type,
+        VkImageView view,
+        VkImageLayout layout,
+        VkSampler sampler = VK_NULL_HANDLE,
+        std::uint32_t array_element = 0
+      );
+      void clear();
+
+      std::uint64_t hash() const { return hash_value; }
+      bool operator==(DescriptorWrites const &other) const;
+      // Everything in one vkUpdateDescriptorSets
+      void apply(DeviceDispatch const &vk, VkDevice device, VkDescriptorSet set) const;
+
+    private:
+      struct Write
+      {
+        std::uint32_t binding;
+        std::uint32_t array_element;
+        VkDescriptorType type;
+        VkDescriptorBufferInfo buffer_info;
+        VkDescriptorImageInfo image_info;
+        VkBufferView texel_buffer_view;
+      };
+
+      std::vector<Write> writes;
+      std::uint64_t hash_value = DESCRIPTOR_KEY_SEED;
+    };
+
+    // Descriptors of one type to make room for in each pool, per set the pool holds
+    struct DescriptorPoolRatio
+    {
+      VkDescriptorType type;
+      float per_set;
+    };
+
+    // Descriptor sets that last one frame. Every recording thread has pools of its own per frame in flight, so
+    // allocating needs no locking, and another pool is added whenever the ones it has run out. A frame's pools
+    // are reset wholesale when the frame comes round rather than its sets being freed one by one.
+    //
+    // Within a frame, asking a thread for a set with the same layout and writes as one it already handed out
+    // returns that set, so draws sharing their bindings cost a hash lookup rather than an allocation and an
+    // update.
+    class DescriptorAllocator
+    {
+    public:
+      struct Stats
+      {
+        std::uint64_t allocations = 0;
+        std::uint64_t reuses = 0; // Sets handed out again within their frame instead of being allocated
+        std::uint32_t pools = 0;
+      };
+
+      // thread_count is how many threads may allocate at once, the job pool's workers plus the caller
+      void init(
+        DeviceDispatch const &vk,
+        VkDevice device,
+        VkAllocationCallbacks const *allocator,
+        std::uint32_t frames_in_flight,
+        std::uint32_t thread_count
+      );
+      void destroy();
+
+      // Resets the frame's pools. The GPU must be done with the sets last allocated for the frame.
+      void beginFrame(std::uint32_t frame);
+      // A set with writes already applied, shared with any earlier request from thread this frame for the same
+      // layout and writes. thread is the recording thread's participant index.
+      VkDescriptorSet allocate(std::uint32_t thread, VkDescriptorSetLayout layout, DescriptorWrites const &writes);
+      // A set of the caller's own to write, never handed out again this frame
+      VkDescriptorSet allocate(std::uint32_t thread, VkDescriptorSetLayout layout);
+
+      // Only while no thread is allocating
+      Stats stats() const;
+      void logStats() const;
+
+      // Used for pools created after they are changed. Each pool a thread adds in a frame holds twice as many
+      // sets as the one before it, from first_pool_sets up to max_pool_sets.
+      std::vector<DescriptorPoolRatio> pool_ratios = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f }
+      };
+      std::uint32_t first_pool_sets = 64;
+      std::uint32_t max_pool_sets = 4096;
+
+    private:
+      struct CachedSet
+      {
+        VkDescriptorSetLayout layout;
+        DescriptorWrites writes;
+        VkDescriptorSet set;
+      };
+
+      struct ThreadPools
+      {
+        std::vector<VkDescriptorPool> pools;
+        std::uint32_t current = 0; // Pools before this one ran out this frame
+        std::uint32_t current_sets = 0; // Allocated from the current pool since it was last reset
+        std::uint32_t allocated = 0; // Sets allocated since the pools were last reset
+        // Sets handed out this frame, by a hash of their layout and writes
+        std::unordered_map<std::uint64_t, std::vector<CachedSet>> sets;
+        std::uint64_t allocations = 0;
+        std::uint64_t reuses = 0;
+      };
+
+      VkDescriptorSet allocateFrom(ThreadPools &thread_pools, VkDescriptorSetLayout layout);
+      VkDescriptorPool createPool(std::uint32_t index);
+
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+      std::uint32_t thread_count = 0;
+      std::uint32_t current_frame = 0;
+      std::vector<ThreadPools> thread_pools; // thread_count per frame in flight
+    };
+  }
+#endif
+
+}
+
+#endif // DESCRIPTOR_ALLOCATOR_H
@@ -0,0 +1,250 @@
+#include "descriptor_layout_cache.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    bool DescriptorLayoutCache::SetLayoutKey::operator==(SetLayoutKey const &other) const
+    {
+      auto same_binding = [](VkDescriptorSetLayoutBinding const &a, VkDescriptorSetLayoutBinding const &b)
+      {
+        return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+          a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags;
+      };
+      return flags == other.flags &&
+        std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(), same_binding) &&
+        binding_flags == other.binding_flags &&
+        immutable_samplers == other.immutable_samplers;
+    }
+
+    bool DescriptorLayoutCache::PipelineLayoutKey::operator==(PipelineLayoutKey const &other) const
+    {
+      auto same_range = [](VkPushConstantRange const &a, VkPushConstantRange const &b)
+      {
+        return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+      };
+      return set_layouts == other.set_layouts && std::equal(
+        push_constants.begin(), push_constants.end(), other.push_constants.begin(), other.push_constants.end(),
+        same_range
+      );
+    }
+
+    void DescriptorLayoutCache::init(
+      DeviceDispatch const &vk,
+      VkDevice device,
+      VkAllocationCallbacks const *allocator)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->allocator = allocator;
+    }
+
+    void DescriptorLayoutCache::destroy()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      Debug::Trace(
+        "Destroying {} pipeline layouts and {} descriptor set layouts", pipeline_layout_count, set_layout_count
+      );
+      for (auto const &bucket : pipeline_layouts)
+      {
+        for (std::pair<PipelineLayoutKey, VkPipelineLayout> const &entry : bucket.second)
+        {
+          vk->vkDestroyPipelineLayout(device, entry.second, allocator);
+        }
+      }
+      for (auto const &bucket : set_layouts)
+      {
+        for (std::pair<SetLayoutKey, VkDescriptorSetLayout> const &entry : bucket.second)
+        {
+          vk->vkDestroyDescriptorSetLayout(device, entry.second, allocator);
+        }
+      }
+      pipeline_layouts.clear();
+      set_layouts.clear();
+      pipeline_layout_count = 0;
+      set_layout_count = 0;
+    }
+
+    VkDescriptorSetLayout DescriptorLayoutCache::setLayout(
+      std::vector<VkDescriptorSetLayoutBinding> const &bindings,
+      VkDescriptorSetLayoutCreateFlags flags,
+      std::vector<VkDescriptorBindingFlagsEXT> const &binding_flags)
+    {
+      if (!binding_flags.empty() && binding_flags.size() != bindings.size())
+      {
+        throw std::runtime_error("ERROR: Descriptor binding flags don't match the bindings they're for");
+      }
+
+      // The same bindings listed in another order make the same layout
+      std::vector<size_t> order(bindings.size());
+      std::iota(order.begin(), order.end(), size_t(0));
+      std::sort(order.begin(), order.end(), [&bindings](size_t a, size_t b)
+      {
+        return bindings[a].binding < bindings[b].binding;
+      });
+
+      SetLayoutKey key;
+      key.flags = flags;
+      std::uint64_t hash = hashDescriptorKey(DESCRIPTOR_KEY_SEED, flags);
+      for (size_t i : order)
+      {
+        VkDescriptorSetLayoutBinding binding = bindings[i];
+        if (binding.pImmutableSamplers != nullptr)
+        {
+          VkSampler const *samplers = binding.pImmutableSamplers;
+          key.immutable_samplers.insert(key.immutable_samplers.end(), samplers, samplers + binding.descriptorCount);
+          binding.pImmutableSamplers = nullptr;
+        }
+        key.bindings.push_back(binding);
+        hash = hashDescriptorKey(hash, binding.binding);
+        hash = hashDescriptorKey(hash, binding.descriptorType);
+        hash = hashDescriptorKey(hash, binding.descriptorCount);
+        hash = hashDescriptorKey(hash, binding.stageFlags);
+        if (!binding_flags.empty())
+        {
+          key.binding_flags.push_back(binding_flags[i]);
+          hash = hashDescriptorKey(hash, binding_flags[i]);
+        }
+      }
+      for (VkSampler sampler : key.immutable_samplers)
+      {
+        hash = hashDescriptorKey(hash, sampler);
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::vector<std::pair<SetLayoutKey, VkDescriptorSetLayout>> &bucket = set_layouts[hash];
+      for (std::pair<SetLayoutKey, VkDescriptorSetLayout> const &entry : bucket)
+      {
+        if (entry.first == key)
+        {
+          return entry.second;
+        }
+      }
+
+      VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flags_info = {};
+      flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+      flags_info.bindingCount = static_cast<std::uint32_t>(binding_flags.size());
+      flags_info.pBindingFlags = binding_flags.data();
+
+      VkDescriptorSetLayoutCreateInfo create_info = {};
+      create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+      create_info.pNext = binding_flags.empty() ? nullptr : &flags_info;
+      create_info.flags = flags;
+      create_info.bindingCount = static_cast<std::uint32_t>(bindings.size());
+      create_info.pBindings = bindings.data();
+
+      VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+      if (vk->vkCreateDescriptorSetLayout(device, &create_info, allocator, &layout) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create a descriptor set layout");
+      }
+      bucket.emplace_back(std::move(key), layout);
+      ++set_layout_count;
+      return layout;
+    }
+
+    VkPipelineLayout DescriptorLayoutCache::pipelineLayout(
+      std::vector<VkDescriptorSetLayout> const &set_layouts,
+      std::vector<VkPushConstantRange> const &push_constants)
+    {
+      std::uint64_t hash = DESCRIPTOR_KEY_SEED;
+      for (VkDescriptorSetLayout set_layout : set_layouts)
+      {
+        hash = hashDescriptorKey(hash, set_layout);
+      }
+      for (VkPushConstantRange const &range : push_constants)
+      {
+        hash = hashDescriptorKey(hash, range.stageFlags);
+        hash = hashDescriptorKey(hash, range.offset);
+        hash = hashDescriptorKey(hash, range.size);
+      }
+      PipelineLayoutKey key = { set_layouts, push_constants };
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::vector<std::pair<PipelineLayoutKey, VkPipelineLayout>> &bucket = pipeline_layouts[hash];
+      for (std::pair<PipelineLayoutKey, VkPipelineLayout> const &entry : bucket)
+      {
+        if (entry.first == key)
+        {
+          return entry.second;
+        }
+      }
+
+      VkPipelineLayoutCreateInfo create_info = {};
+      create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+      create_info.setLayoutCount = static_cast<std::uint32_t>(set_layouts.size());
+      create_info.pSetLayouts = set_layouts.data();
+      create_info.pushConstantRangeCount = static_cast<std::uint32_t>(push_constants.size());
+      create_info.pPushConstantRanges = push_constants.data();
+
+      VkPipelineLayout layout = VK_NULL_HANDLE;
+      if (vk->vkCreatePipelineLayout(device, &create_info, allocator, &layout) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create a pipeline layout");
+      }
+      bucket.emplace_back(std::move(key), layout);
+      ++pipeline_layout_count;
+      return layout;
+    }
+
+    VkPipelineLayout DescriptorLayoutCache::pipelineLayout(
+      ShaderReflection const &reflection,
+      std::map<std::uint32_t, VkDescriptorSetLayout> const &set_overrides)
+    {
+      // Overridden sets are included even where the shader doesn't use them, so every pipeline layout made with
+      // the same overrides is compatible in those sets and they stay bound from one pipeline to the next
+      std::uint32_t set_count = reflection.setCount();
+      if (!set_overrides.empty())
+      {
+        set_count = std::max(set_count, set_overrides.rbegin()->first + 1);
+      }
+
+      std::vector<VkDescriptorSetLayout> layouts(set_count, VK_NULL_HANDLE);
+      for (std::uint32_t set=0; set<set_count; ++set)
+      {
+        std::map<std::uint32_t, VkDescriptorSetLayout>::const_iterator found = set_overrides.find(set);
+        if (found != set_overrides.end())
+        {
+          layouts[set] = found->second;
+          continue;
+        }
+
+        std::vector<VkDescriptorSetLayoutBinding> const bindings = reflection.setBindings(set);
+        for (VkDescriptorSetLayoutBinding const &binding : bindings)
+        {
+          if (binding.descriptorCount == 0)
+          {
+            throw std::runtime_error(
+              "ERROR: Set " + std::to_string(set) + " binding " + std::to_string(binding.binding) +
+              " is a runtime sized array with no layout given for its set"
+            );
+          }
+        }
+        layouts[set] = setLayout(bindings);
+      }
+      return pipelineLayout(layouts, reflection.push_constants);
+    }
+
+    size_t DescriptorLayoutCache::setLayoutCount() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return set_layout_count;
+    }
+
+    size_t DescriptorLayoutCache::pipelineLayoutCount() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return pipeline_layout_count;
+    }
+  }
+#endif
+
+}
@@ -0,0 +1,103 @@
+#ifndef DESCRIPTOR_LAYOUT_CACHE_H
+#define DESCRIPTOR_LAYOUT_CACHE_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "shader_reflection.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    std::uint64_t constexpr DESCRIPTOR_KEY_SEED = 14695981039346656037ull;
+
+    // FNV-1a over the bytes of value, which must have no padding. Layouts and descriptor set contents are
+    // looked up by it.
+    template<typename T>
+    std::uint64_t hashDescriptorKey(std::uint64_t hash, T const &value)
+    {
+      std::uint8_t const *bytes = reinterpret_cast<std::uint8_t const *>(&value);
+      for (size_t i=0; i<sizeof(T); ++i)
+      {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+      }
+      return hash;
+    }
+
+    // Descriptor set and pipeline layouts, each created once per distinct description and kept until destroy, so
+    // pipelines built from the same bindings share their layouts and the sets allocated for them. Lookups go by a
+    // hash of the description and then compare it in full. Safe to use from several threads.
+    class DescriptorLayoutCache
+    {
+    public:
+      void init(DeviceDispatch const &vk, VkDevice device, VkAllocationCallbacks const *allocator);
+      // Every pipeline and set made with the layouts must be gone or no longer in use
+      void destroy();
+
+      // Bindings may come in any order. binding_flags is either empty or holds one entry per binding, in the
+      // same order, and needs VK_EXT_descriptor_indexing.
+      VkDescriptorSetLayout setLayout(
+        std::vector<VkDescriptorSetLayoutBinding> const &bindings,
+        VkDescriptorSetLayoutCreateFlags flags = 0,
+        std::vector<VkDescriptorBindingFlagsEXT> const &binding_flags = {}
+      );
+      VkPipelineLayout pipelineLayout(
+        std::vector<VkDescriptorSetLayout> const &set_layouts,
+        std::vector<VkPushConstantRange> const &push_constants
+      );
+      // A set layout for every set below reflection.setCount(), empty for sets it skips, and the pipeline layout
+      // over them. Sets in set_overrides take the layout given there instead, such as the bindless table's; any
+      // other set with a runtime sized array throws, since only its owner knows how large the array is.
+      VkPipelineLayout pipelineLayout(
+        ShaderReflection const &reflection,
+        std::map<std::uint32_t, VkDescriptorSetLayout> const &set_overrides = {}
+      );
+
+      size_t setLayoutCount() const;
+      size_t pipelineLayoutCount() const;
+
+    private:
+      struct SetLayoutKey
+      {
+        VkDescriptorSetLayoutCreateFlags flags = 0;
+        // Sorted by binding, with pImmutableSamplers cleared; the samplers are kept in immutable_samplers
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        std::vector<VkDescriptorBindingFlagsEXT> binding_flags;
+        std::vector<VkSampler> immutable_samplers;
+
+        bool operator==(SetLayoutKey const &other) const;
+      };
+
+      struct PipelineLayoutKey
+      {
+        std::vector<VkDescriptorSetLayout> set_layouts;
+        std::vector<VkPushConstantRange> push_constants;
+
+        bool operator==(PipelineLayoutKey const &other) const;
+      };
+
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+
+      mutable std::mutex mutex;
+      // Keyed by hash, with every description that hashed the same in the vector
+      std::unordered_map<std::uint64_t, std::vector<std::pair<SetLayoutKey, VkDescriptorSetLayout>>> set_layouts;
+      std::unordered_map<std::uint64_t, std::vector<std::pair<PipelineLayoutKey, VkPipelineLayout>>> pipeline_layouts;
+      size_t set_layout_count = 0;
+      size_t pipeline_layout_count = 0;
+    };
+  }
+#endif
+
+}
+
+#endif // DESCRIPTOR_LAYOUT_CACHE_H
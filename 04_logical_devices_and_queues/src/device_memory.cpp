@@ -0,0 +1,792 @@
+#include "device_memory.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#ifdef USING_VULKAN
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    // One VkDeviceMemory. Pooled blocks keep a free list of offsets per buddy order, order 0 being
+    // MIN_ALLOCATION_SIZE; dedicated blocks hold a single allocation and have no free lists.
+    struct MemoryBlock
+    {
+      VkDeviceMemory memory = VK_NULL_HANDLE;
+      VkDeviceSize size = 0;
+      void *mapped = nullptr;
+      std::uint32_t memory_type = 0;
+      ResourceKind kind = ResourceKind::Linear;
+      bool dedicated = false;
+      std::uint8_t max_order = 0;
+      std::vector<std::set<VkDeviceSize>> free_lists;
+      VkDeviceSize used = 0;
+      std::map<VkDeviceSize, DeviceAllocation *> allocations;
+    };
+
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+      return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    static std::uint8_t orderFor(VkDeviceSize size)
+    {
+      std::uint8_t order = 0;
+      while ((DeviceMemoryAllocator::MIN_ALLOCATION_SIZE << order) < size)
+      {
+        ++order;
+      }
+      return order;
+    }
+
+    static VkDeviceSize orderSize(std::uint8_t order)
+    {
+      return DeviceMemoryAllocator::MIN_ALLOCATION_SIZE << order;
+    }
+
+    static std::uint32_t bitCount(std::uint32_t bits)
+    {
+      std::uint32_t count = 0;
+      for (; bits != 0; bits &= bits - 1)
+      {
+        ++count;
+      }
+      return count;
+    }
+
+    // Takes the lowest free offset of the smallest order that fits and splits it down, so blocks fill from
+    // the front and the tail stays free for large allocations
+    static bool buddyAllocate(MemoryBlock &block, std::uint8_t order, VkDeviceSize &offset)
+    {
+      if (block.dedicated || order > block.max_order)
+      {
+        return false;
+      }
+
+      std::uint8_t found = order;
+      while (found <= block.max_order && block.free_lists[found].empty())
+      {
+        ++found;
+      }
+      if (found > block.max_order)
+      {
+        return false;
+      }
+
+      offset = *block.free_lists[found].begin();
+      block.free_lists[found].erase(block.free_lists[found].begin());
+      while (found > order)
+      {
+        --found;
+        block.free_lists[found].insert(offset + orderSize(found));
+      }
+
+      block.used += orderSize(order);
+      return true;
+    }
+
+    static void buddyFree(MemoryBlock &block, VkDeviceSize offset, std::uint8_t order)
+    {
+      block.used -= orderSize(order);
+
+      while (order < block.max_order)
+      {
+        VkDeviceSize buddy = offset ^ orderSize(order);
+        std::set<VkDeviceSize>::iterator it = block.free_lists[order].find(buddy);
+        if (it == block.free_lists[order].end())
+        {
+          break;
+        }
+        block.free_lists[order].erase(it);
+        offset = std::min(offset, buddy);
+        ++order;
+      }
+      block.free_lists[order].insert(offset);
+    }
+
+    DeviceMemoryAllocator::DeviceMemoryAllocator() = default;
+
+    DeviceMemoryAllocator::~DeviceMemoryAllocator() = default;
+
+    void DeviceMemoryAllocator::init(
+      InstanceDispatch const &instance_functions,
+      DeviceDispatch const &vk,
+      VkPhysicalDevice physical_device,
+      VkDevice device,
+      VkAllocationCallbacks const *allocator)
+    {
+      this->instance_functions = &instance_functions;
+      this->vk = &vk;
+      this->device = device;
+      this->host_allocator = allocator;
+
+      instance_functions.vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+      VkPhysicalDeviceProperties properties;
+      instance_functions.vkGetPhysicalDeviceProperties(physical_device, &properties);
+      buffer_image_granularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+      non_coherent_atom_size = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+      for (std::uint32_t i=0; i<memory_properties.memoryHeapCount; ++i)
+      {
+        heap_stats[i] = HeapStats();
+        heap_stats[i].heap_size = memory_properties.memoryHeaps[i].size;
+      }
+
+      Debug::Trace(
+        "Device memory: {} types in {} heaps, bufferImageGranularity {}",
+        memory_properties.memoryTypeCount,
+        memory_properties.memoryHeapCount,
+        buffer_image_granularity
+      );
+    }
+
+    void DeviceMemoryAllocator::destroy()
+    {
+      reportLeaks();
+
+      std::lock_guard<std::mutex> lock(mutex);
+      pending_moves.clear();
+      while (!blocks.empty())
+      {
+        for (std::pair<VkDeviceSize const, DeviceAllocation *> const &entry : blocks.back()->allocations)
+        {
+          delete entry.second;
+        }
+        blocks.back()->allocations.clear();
+        destroyBlock(blocks.back().get());
+      }
+    }
+
+    std::uint32_t DeviceMemoryAllocator::findMemoryType(
+      std::uint32_t type_bits,
+      VkMemoryPropertyFlags required,
+      VkMemoryPropertyFlags preferred) const
+    {
+      std::uint32_t best = UINT32_MAX;
+      std::uint32_t best_preferred = 0;
+      std::uint32_t best_extra = 0;
+
+      for (std::uint32_t i=0; i<memory_properties.memoryTypeCount; ++i)
+      {
+        VkMemoryPropertyFlags flags = memory_properties.memoryTypes[i].propertyFlags;
+        if (!(type_bits & (1u << i)) || (flags & required) != required)
+        {
+          continue;
+        }
+
+        // More of the preferred flags wins, then fewer flags nobody asked for
+        std::uint32_t preferred_count = bitCount(flags & preferred);
+        std::uint32_t extra_count = bitCount(flags & ~(required | preferred));
+        if (best == UINT32_MAX ||
+            preferred_count > best_preferred ||
+            (preferred_count == best_preferred && extra_count < best_extra))
+        {
+          best = i;
+          best_preferred = preferred_count;
+          best_extra = extra_count;
+        }
+      }
+
+      return best;
+    }
+
+    DeviceAllocation *DeviceMemoryAllocator::allocate(MemoryRequest const &request)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (!pending_moves.empty())
+      {
+        throw std::runtime_error("ERROR: Device memory allocated during defragmentation");
+      }
+
+      VkDeviceSize size = request.requirements.size;
+      // With a granularity no larger than the smallest allocation, neighbours never share a page
+      ResourceKind kind = buffer_image_granularity > MIN_ALLOCATION_SIZE ? request.kind : ResourceKind::Linear;
+
+      std::uint32_t type_bits = request.requirements.memoryTypeBits;
+      std::uint32_t memory_type;
+      while ((memory_type = findMemoryType(type_bits, request.required, request.preferred)) != UINT32_MAX)
+      {
+        type_bits &= ~(1u << memory_type);
+
+        VkMemoryPropertyFlags flags = memory_properties.memoryTypes[memory_type].propertyFlags;
+        VkDeviceSize alignment = std::max<VkDeviceSize>(request.requirements.alignment, 1);
+        // Keeps flushes and invalidates of one allocation from touching its neighbours
+        if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        {
+          alignment = std::max(alignment, non_coherent_atom_size);
+        }
+
+        VkDeviceSize block_size = blockSizeFor(memory_type);
+        VkDeviceSize needed = std::max(size, alignment);
+
+        MemoryBlock *block = nullptr;
+        VkDeviceSize offset = 0;
+        std::uint8_t order = 0;
+        if (request.dedicated || needed > block_size / 2)
+        {
+          block = createBlock(memory_type, kind, alignUp(size, alignment), true);
+          if (block != nullptr)
+          {
+            block->used = block->size;
+          }
+        }
+        else
+        {
+          order = orderFor(needed);
+          block = allocateFrom(memory_type, kind, order, offset);
+          // Driver limits or a nearly full heap can refuse a full block where a smaller one still fits
+          for (VkDeviceSize try_size = block_size; block == nullptr && try_size >= orderSize(order); try_size /= 2)
+          {
+            MemoryBlock *new_block = createBlock(memory_type, kind, try_size, false);
+            if (new_block != nullptr && buddyAllocate(*new_block, order, offset))
+            {
+              block = new_block;
+            }
+          }
+        }
+
+        if (block == nullptr)
+        {
+          continue;
+        }
+
+        DeviceAllocation *allocation = new DeviceAllocation();
+        allocation->memory = block->memory;
+        allocation->offset = offset;
+        allocation->size = size;
+        allocation->memory_type = memory_type;
+        allocation->mapped = block->mapped != nullptr ? static_cast<char *>(block->mapped) + offset : nullptr;
+        allocation->block = block;
+        allocation->order = order;
+        block->allocations[offset] = allocation;
+
+        HeapStats &stats = heap_stats[heapOf(block)];
+        stats.used_bytes += block->dedicated ? block->size : orderSize(order);
+        stats.requested_bytes += size;
+        ++stats.allocation_count;
+        return allocation;
+      }
+
+      throw std::runtime_error("ERROR: Failed to allocate device memory of " + std::to_string(size) + " bytes");
+    }
+
+    DeviceAllocation *DeviceMemoryAllocator::allocateForBuffer(
+      VkBuffer buffer,
+      VkMemoryPropertyFlags required,
+      VkMemoryPropertyFlags preferred)
+    {
+      MemoryRequest request;
+      vk->vkGetBufferMemoryRequirements(device, buffer, &(request.requirements));
+      request.required = required;
+      request.preferred = preferred;
+      request.kind = ResourceKind::Linear;
+
+      DeviceAllocation *allocation = allocate(request);
+      if (vk->vkBindBufferMemory(device, buffer, allocation->memory, allocation->offset) != VK_SUCCESS)
+      {
+        free(allocation);
+        throw std::runtime_error("ERROR: Failed to bind buffer memory");
+      }
+      return allocation;
+    }
+
+    DeviceAllocation *DeviceMemoryAllocator::allocateForImage(
+      VkImage image,
+      VkMemoryPropertyFlags required,
+      VkMemoryPropertyFlags preferred,
+      ResourceKind kind)
+    {
+      MemoryRequest request;
+      vk->vkGetImageMemoryRequirements(device, image, &(request.requirements));
+      request.required = required;
+      request.preferred = preferred;
+      request.kind = kind;
+
+      DeviceAllocation *allocation = allocate(request);
+      if (vk->vkBindImageMemory(device, image, allocation->memory, allocation->offset) != VK_SUCCESS)
+      {
+        free(allocation);
+        throw std::runtime_error("ERROR: Failed to bind image memory");
+      }
+      return allocation;
+    }
+
+    void DeviceMemoryAllocator::free(DeviceAllocation *allocation)
+    {
+      if (allocation == nullptr)
+      {
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (!pending_moves.empty())
+      {
+        throw std::runtime_error("ERROR: Device memory freed during defragmentation");
+      }
+
+      MemoryBlock *block = allocation->block;
+      HeapStats &stats = heap_stats[heapOf(block)];
+      stats.used_bytes -= block->dedicated ? block->size : orderSize(allocation->order);
+      stats.requested_bytes -= allocation->size;
+      --stats.allocation_count;
+
+      block->allocations.erase(allocation->offset);
+      if (block->dedicated)
+      {
+        block->used = 0;
+      }
+      else
+      {
+        buddyFree(*block, allocation->offset, allocation->order);
+      }
+      delete allocation;
+
+      if (!block->allocations.empty())
+      {
+        return;
+      }
+
+      // An empty block is kept while it is the only one of its kind, so a lone resource being recreated
+      // over and over doesn't cost a vkAllocateMemory each time
+      bool keep = false;
+      if (!block->dedicated)
+      {
+        keep = true;
+        for (std::unique_ptr<MemoryBlock> const &other : blocks)
+        {
+          if (other.get() != block && !other->dedicated &&
+              other->memory_type == block->memory_type && other->kind == block->kind)
+          {
+            keep = false;
+            break;
+          }
+        }
+      }
+      if (!keep)
+      {
+        destroyBlock(block);
+      }
+    }
+
+    std::vector<DefragmentationMove> DeviceMemoryAllocator::beginDefragmentation(VkDeviceSize max_bytes)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (!pending_moves.empty())
+      {
+        throw std::runtime_error("ERROR: Defragmentation already in progress");
+      }
+
+      std::vector<DefragmentationMove> moves;
+      VkDeviceSize moved_bytes = 0;
+
+      std::map<std::pair<std::uint32_t, ResourceKind>, std::vector<MemoryBlock *>> pools;
+      for (std::unique_ptr<MemoryBlock> const &block : blocks)
+      {
+        if (!block->dedicated)
+        {
+          pools[std::make_pair(block->memory_type, block->kind)].push_back(block.get());
+        }
+      }
+
+      for (std::pair<std::pair<std::uint32_t, ResourceKind> const, std::vector<MemoryBlock *>> &pool : pools)
+      {
+        std::vector<MemoryBlock *> &pool_blocks = pool.second;
+        std::stable_sort(
+          pool_blocks.begin(),
+          pool_blocks.end(),
+          [](MemoryBlock const *a, MemoryBlock const *b) { return a->used > b->used; }
+        );
+
+        std::vector<bool> received(pool_blocks.size(), false);
+
+        // Empties blocks from the sparsest up, each one only if all of it fits in fuller blocks, since a block
+        // that is merely thinned out frees nothing
+        for (size_t i = pool_blocks.size(); i-- > 1;)
+        {
+          MemoryBlock *source = pool_blocks[i];
+          if (received[i] || source->allocations.empty() || moved_bytes + source->used > max_bytes)
+          {
+            continue;
+          }
+
+          size_t first_move = pending_moves.size();
+          std::vector<size_t> destinations;
+          bool evacuated = true;
+          for (std::pair<VkDeviceSize const, DeviceAllocation *> const &entry : source->allocations)
+          {
+            DeviceAllocation *allocation = entry.second;
+            bool placed = false;
+            for (size_t j=0; j<i && !placed; ++j)
+            {
+              VkDeviceSize offset = 0;
+              if (buddyAllocate(*pool_blocks[j], allocation->order, offset))
+              {
+                pending_moves.push_back(PendingMove{ allocation, pool_blocks[j], offset });
+                destinations.push_back(j);
+                placed = true;
+              }
+            }
+            if (!placed)
+            {
+              evacuated = false;
+              break;
+            }
+          }
+
+          if (!evacuated)
+          {
+            for (size_t m = first_move; m < pending_moves.size(); ++m)
+            {
+              buddyFree(*pending_moves[m].block, pending_moves[m].offset, pending_moves[m].allocation->order);
+            }
+            pending_moves.resize(first_move);
+            continue;
+          }
+
+          for (size_t j : destinations)
+          {
+            received[j] = true;
+          }
+          moved_bytes += source->used;
+        }
+      }
+
+      for (PendingMove const &move : pending_moves)
+      {
+        DefragmentationMove defragmentation_move;
+        defragmentation_move.allocation = move.allocation;
+        defragmentation_move.src_memory = move.allocation->memory;
+        defragmentation_move.src_offset = move.allocation->offset;
+        defragmentation_move.dst_memory = move.block->memory;
+        defragmentation_move.dst_offset = move.offset;
+        defragmentation_move.size = move.allocation->size;
+        moves.push_back(defragmentation_move);
+      }
+
+      Debug::Trace("Defragmentation planned {} moves, {} bytes", moves.size(), moved_bytes);
+      return moves;
+    }
+
+    void DeviceMemoryAllocator::endDefragmentation()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      std::set<MemoryBlock *> sources;
+      for (PendingMove const &move : pending_moves)
+      {
+        DeviceAllocation *allocation = move.allocation;
+        MemoryBlock *source = allocation->block;
+        source->allocations.erase(allocation->offset);
+        buddyFree(*source, allocation->offset, allocation->order);
+        sources.insert(source);
+
+        allocation->memory = move.block->memory;
+        allocation->offset = move.offset;
+        allocation->mapped =
+          move.block->mapped != nullptr ? static_cast<char *>(move.block->mapped) + move.offset : nullptr;
+        allocation->block = move.block;
+        move.block->allocations[move.offset] = allocation;
+      }
+
+      size_t released = 0;
+      for (MemoryBlock *source : sources)
+      {
+        if (source->allocations.empty())
+        {
+          destroyBlock(source);
+          ++released;
+        }
+      }
+
+      Debug::Trace("Defragmentation moved {} allocations and released {} blocks", pending_moves.size(), released);
+      pending_moves.clear();
+    }
+
+    DeviceMemoryAllocator::HeapStats DeviceMemoryAllocator::heapStats(std::uint32_t heap) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return heap < VK_MAX_MEMORY_HEAPS ? heap_stats[heap] : HeapStats();
+    }
+
+    void DeviceMemoryAllocator::logStats() const
+    {
+      for (std::uint32_t i=0; i<memory_properties.memoryHeapCount; ++i)
+      {
+        HeapStats stats = heapStats(i);
+        if (stats.device_allocation_calls == 0)
+        {
+          continue;
+        }
+
+        bool device_local = (memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        Debug::Info(
+          "Device memory heap {} ({} MiB{}): {} blocks and {} dedicated allocations reserve {} bytes (peak {}), "
+          "{} bytes in {} allocations used ({} requested), {} vkAllocateMemory calls",
+          i,
+          stats.heap_size / (1024 * 1024),
+          device_local ? ", device local" : "",
+          stats.block_count,
+          stats.dedicated_count,
+          stats.block_bytes,
+          stats.peak_block_bytes,
+          stats.used_bytes,
+          stats.allocation_count,
+          stats.requested_bytes,
+          stats.device_allocation_calls
+        );
+      }
+    }
+
+    bool DeviceMemoryAllocator::reportLeaks() const
+    {
+      bool leaked = false;
+      for (std::uint32_t i=0; i<memory_properties.memoryHeapCount; ++i)
+      {
+        HeapStats stats = heapStats(i);
+        if (stats.allocation_count > 0)
+        {
+          Debug::Warning(
+            "Device memory heap {}: {} bytes in {} allocations were never freed",
+            i,
+            stats.requested_bytes,
+            stats.allocation_count
+          );
+          leaked = true;
+        }
+      }
+      return leaked;
+    }
+
+    VkDeviceSize DeviceMemoryAllocator::blockSizeFor(std::uint32_t memory_type) const
+    {
+      std::uint32_t heap = memory_properties.memoryTypes[memory_type].heapIndex;
+      VkDeviceSize heap_size = memory_properties.memoryHeaps[heap].size;
+
+      VkDeviceSize block_size = DEFAULT_BLOCK_SIZE;
+      while (block_size > 1024 * 1024 && block_size * SMALL_HEAP_BLOCKS > heap_size)
+      {
+        block_size /= 2;
+      }
+      return block_size;
+    }
+
+    MemoryBlock *DeviceMemoryAllocator::createBlock(
+      std::uint32_t memory_type,
+      ResourceKind kind,
+      VkDeviceSize size,
+      bool dedicated)
+    {
+      VkMemoryAllocateInfo allocate_info = {};
+      allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+      allocate_info.allocationSize = size;
+      allocate_info.memoryTypeIndex = memory_type;
+
+      VkDeviceMemory memory = VK_NULL_HANDLE;
+      if (vk->vkAllocateMemory(device, &allocate_info, host_allocator, &memory) != VK_SUCCESS)
+      {
+        return nullptr;
+      }
+
+      std::unique_ptr<MemoryBlock> block = std::make_unique<MemoryBlock>();
+      block->memory = memory;
+      block->size = size;
+      block->memory_type = memory_type;
+      block->kind = kind;
+      block->dedicated = dedicated;
+
+      VkMemoryPropertyFlags flags = memory_properties.memoryTypes[memory_type].propertyFlags;
+      if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+      {
+        if (vk->vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &(block->mapped)) != VK_SUCCESS)
+        {
+          vk->vkFreeMemory(device, memory, host_allocator);
+          return nullptr;
+        }
+      }
+
+      if (!dedicated)
+      {
+        block->max_order = orderFor(size);
+        block->free_lists.resize(block->max_order + 1);
+        block->free_lists[block->max_order].insert(0);
+      }
+
+      if (instance_functions->vkSetDebugUtilsObjectNameEXT != nullptr)
+      {
+        std::string name = dedicated ? "Dedicated memory, type " : "Memory block, type ";
+        name += std::to_string(memory_type);
+        VkDebugUtilsObjectNameInfoEXT name_info = {};
+        name_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+        name_info.objectType = VK_OBJECT_TYPE_DEVICE_MEMORY;
+        name_info.objectHandle = reinterpret_cast<std::uint64_t>(memory);
+        name_info.pObjectName = name.c_str();
+        instance_functions->vkSetDebugUtilsObjectNameEXT(device, &name_info);
+      }
+
+      HeapStats &stats = heap_stats[heapOf(block.get())];
+      stats.block_bytes += size;
+      stats.peak_block_bytes = std::max(stats.peak_block_bytes, stats.block_bytes);
+      ++(dedicated ? stats.dedicated_count : stats.block_count);
+      ++stats.device_allocation_calls;
+
+      blocks.push_back(std::move(block));
+      return blocks.back().get();
+    }
+
+    void DeviceMemoryAllocator::destroyBlock(MemoryBlock *block)
+    {
+      HeapStats &stats = heap_stats[heapOf(block)];
+      stats.block_bytes -= block->size;
+      --(block->dedicated ? stats.dedicated_count : stats.block_count);
+
+      if (block->mapped != nullptr)
+      {
+        vk->vkUnmapMemory(device, block->memory);
+      }
+      vk->vkFreeMemory(device, block->memory, host_allocator);
+
+      for (size_t i=0; i<blocks.size(); ++i)
+      {
+        if (blocks[i].get() == block)
+        {
+          blocks.erase(blocks.begin() + i);
+          break;
+        }
+      }
+    }
+
+    MemoryBlock *DeviceMemoryAllocator::allocateFrom(
+      std::uint32_t memory_type,
+      ResourceKind kind,
+      std::uint8_t order,
+      VkDeviceSize &offset)
+    {
+      for (std::unique_ptr<MemoryBlock> const &block : blocks)
+      {
+        if (block->memory_type == memory_type && block->kind == kind && buddyAllocate(*block, order, offset))
+        {
+          return block.get();
+        }
+      }
+      return nullptr;
+    }
+
+    std::uint32_t DeviceMemoryAllocator::heapOf(MemoryBlock const *block) const
+    {
+      return memory_properties.memoryTypes[block->memory_type].heapIndex;
+    }
+
+    void RingAllocator::init(
+      DeviceMemoryAllocator &allocator,
+      VkDeviceSize capacity,
+      std::uint32_t type_bits,
+      VkMemoryPropertyFlags required,
+      VkMemoryPropertyFlags preferred)
+    {
+      MemoryRequest request;
+      request.requirements.size = capacity;
+      request.requirements.alignment = DeviceMemoryAllocator::MIN_ALLOCATION_SIZE;
+      request.requirements.memoryTypeBits = type_bits;
+      request.required = required;
+      request.preferred = preferred;
+      request.kind = ResourceKind::Linear;
+      request.dedicated = true;
+
+      this->allocator = &allocator;
+      ring_allocation = allocator.allocate(request);
+      ring_capacity = capacity;
+      reset();
+      peak = 0;
+    }
+
+    void RingAllocator::destroy()
+    {
+      if (allocator != nullptr)
+      {
+        allocator->free(ring_allocation);
+      }
+      ring_allocation = nullptr;
+      allocator = nullptr;
+      ring_capacity = 0;
+      reset();
+    }
+
+    bool RingAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, Range &range)
+    {
+      if (size == 0 || size > ring_capacity)
+      {
+        return false;
+      }
+      if (in_use == 0)
+      {
+        head = 0;
+      }
+
+      // Alignment applies to the offset within the memory, not within the ring
+      VkDeviceSize base = ring_allocation->offset;
+      VkDeviceSize start = alignUp(base + head, alignment) - base;
+      VkDeviceSize taken;
+      if (start + size <= ring_capacity)
+      {
+        taken = start + size - head;
+      }
+      else
+      {
+        // Wrap around, giving up the tail end of the ring until this frame retires
+        start = alignUp(base, alignment) - base;
+        taken = ring_capacity - head + start + size;
+      }
+
+      if (taken > ring_capacity - in_use)
+      {
+        return false;
+      }
+
+      head = start + size == ring_capacity ? 0 : start + size;
+      in_use += taken;
+      frame_bytes += taken;
+      peak = std::max(peak, in_use);
+
+      range.memory = ring_allocation->memory;
+      range.offset = base + start;
+      range.mapped =
+        ring_allocation->mapped != nullptr ? static_cast<char *>(ring_allocation->mapped) + start : nullptr;
+      return true;
+    }
+
+    void RingAllocator::endFrame()
+    {
+      frames.push_back(frame_bytes);
+      frame_bytes = 0;
+    }
+
+    void RingAllocator::retireFrame()
+    {
+      if (!frames.empty())
+      {
+        in_use -= frames.front();
+        frames.pop_front();
+      }
+    }
+
+    void RingAllocator::reset()
+    {
+      head = 0;
+      in_use = 0;
+      frame_bytes = 0;
+      frames.clear();
+    }
+  }
+}
+
+#endif
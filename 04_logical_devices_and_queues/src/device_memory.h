@@ -0,0 +1,229 @@
+#ifndef DEVICE_MEMORY_H
+#define DEVICE_MEMORY_H
+
+#include "init.h"
+#include "dispatch.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    struct MemoryBlock;
+
+    // Buffers and linear images may not share a bufferImageGranularity page with optimal images
+    enum class ResourceKind : std::uint8_t
+    {
+      Linear,
+      Optimal
+    };
+
+    struct MemoryRequest
+    {
+      VkMemoryRequirements requirements = {};
+      VkMemoryPropertyFlags required = 0;
+      // Memory types with more of these are tried first
+      VkMemoryPropertyFlags preferred = 0;
+      ResourceKind kind = ResourceKind::Linear;
+      // Gets a VkDeviceMemory of its own. Requests too large for a block always do.
+      bool dedicated = false;
+    };
+
+    // A range of a VkDeviceMemory handed out by DeviceMemoryAllocator. It stays valid until freed, and moves
+    // only when a defragmentation pass that moved it ends.
+    class DeviceAllocation
+    {
+    public:
+      VkDeviceMemory memory = VK_NULL_HANDLE;
+      VkDeviceSize offset = 0;
+      VkDeviceSize size = 0;
+      std::uint32_t memory_type = 0;
+      // Points at offset for host visible memory, which stays mapped for the lifetime of its block
+      void *mapped = nullptr;
+
+    private:
+      friend class DeviceMemoryAllocator;
+      MemoryBlock *block = nullptr;
+      std::uint8_t order = 0;
+    };
+
+    // Reported by beginDefragmentation. The caller copies size bytes from the source range to the destination
+    // and recreates whatever was bound to the allocation on the destination before calling endDefragmentation.
+    struct DefragmentationMove
+    {
+      DeviceAllocation *allocation;
+      VkDeviceMemory src_memory;
+      VkDeviceSize src_offset;
+      VkDeviceMemory dst_memory;
+      VkDeviceSize dst_offset;
+      VkDeviceSize size;
+    };
+
+    // Device memory suballocated from large blocks, one set of blocks per memory type, so resources don't
+    // each cost a vkAllocateMemory and don't run into maxMemoryAllocationCount. Blocks are split with a
+    // buddy scheme in powers of two from MIN_ALLOCATION_SIZE, which keeps every allocation aligned to its
+    // own size. Where bufferImageGranularity is larger than that, linear and optimal resources get
+    // separate blocks.
+    class DeviceMemoryAllocator
+    {
+    public:
+      static VkDeviceSize constexpr MIN_ALLOCATION_SIZE = 256;
+      static VkDeviceSize constexpr DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+      // Heaps smaller than this many default blocks get proportionally smaller blocks
+      static VkDeviceSize constexpr SMALL_HEAP_BLOCKS = 8;
+
+      struct HeapStats
+      {
+        VkDeviceSize heap_size = 0;
+        VkDeviceSize block_bytes = 0;     // Taken from the heap with vkAllocateMemory
+        VkDeviceSize peak_block_bytes = 0;
+        VkDeviceSize used_bytes = 0;      // Handed out, rounded up to the buddy size
+        VkDeviceSize requested_bytes = 0; // Handed out, as requested
+        std::uint32_t block_count = 0;
+        std::uint32_t dedicated_count = 0;
+        std::uint32_t allocation_count = 0;
+        std::uint64_t device_allocation_calls = 0;
+      };
+
+      DeviceMemoryAllocator();
+      ~DeviceMemoryAllocator();
+      DeviceMemoryAllocator(DeviceMemoryAllocator const &) = delete;
+      DeviceMemoryAllocator &operator=(DeviceMemoryAllocator const &) = delete;
+
+      void init(
+        InstanceDispatch const &instance_functions,
+        DeviceDispatch const &vk,
+        VkPhysicalDevice physical_device,
+        VkDevice device,
+        VkAllocationCallbacks const *allocator
+      );
+      // Frees every block, warning about allocations still live
+      void destroy();
+
+      // The memory type best matching required and preferred among type_bits, or UINT32_MAX
+      std::uint32_t findMemoryType(
+        std::uint32_t type_bits,
+        VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred = 0
+      ) const;
+      VkPhysicalDeviceMemoryProperties const &memoryProperties() const { return memory_properties; }
+
+      DeviceAllocation *allocate(MemoryRequest const &request);
+      // Allocates for the resource and binds it
+      DeviceAllocation *allocateForBuffer(
+        VkBuffer buffer,
+        VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred = 0
+      );
+      DeviceAllocation *allocateForImage(
+        VkImage image,
+        VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred = 0,
+        ResourceKind kind = ResourceKind::Optimal
+      );
+      void free(DeviceAllocation *allocation);
+
+      // Plans moves out of the emptiest blocks into fuller ones of the same memory type, up to max_bytes,
+      // and reserves their destinations. Nothing may be allocated or freed until endDefragmentation.
+      std::vector<DefragmentationMove> beginDefragmentation(VkDeviceSize max_bytes = ~VkDeviceSize(0));
+      // Points moved allocations at their destinations and releases the blocks left empty
+      void endDefragmentation();
+
+      HeapStats heapStats(std::uint32_t heap) const;
+      void logStats() const;
+      // Logs a warning per heap with allocations still live and returns whether there were any
+      bool reportLeaks() const;
+
+    private:
+      struct PendingMove
+      {
+        DeviceAllocation *allocation;
+        MemoryBlock *block;
+        VkDeviceSize offset;
+      };
+
+      VkDeviceSize blockSizeFor(std::uint32_t memory_type) const;
+      MemoryBlock *createBlock(std::uint32_t memory_type, ResourceKind kind, VkDeviceSize size, bool dedicated);
+      void destroyBlock(MemoryBlock *block);
+      // A pooled block of the type and kind with a free range of the order, taken into offset
+      MemoryBlock *allocateFrom(
+        std::uint32_t memory_type,
+        ResourceKind kind,
+        std::uint8_t order,
+        VkDeviceSize &offset
+      );
+      std::uint32_t heapOf(MemoryBlock const *block) const;
+
+      InstanceDispatch const *instance_functions = nullptr;
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *host_allocator = nullptr;
+      VkPhysicalDeviceMemoryProperties memory_properties = {};
+      VkDeviceSize buffer_image_granularity = 1;
+      VkDeviceSize non_coherent_atom_size = 1;
+
+      mutable std::mutex mutex;
+      std::vector<std::unique_ptr<MemoryBlock>> blocks;
+      std::vector<PendingMove> pending_moves;
+      HeapStats heap_stats[VK_MAX_MEMORY_HEAPS];
+    };
+
+    // Per-frame transient data bump allocated from one dedicated allocation, mapped when host visible. Space
+    // is handed out in order and wraps around; a frame's space comes back once retireFrame says the GPU is
+    // done with it. Without endFrame/retireFrame it works as a plain linear allocator that reset empties.
+    // Not thread safe, so recording threads each want their own.
+    class RingAllocator
+    {
+    public:
+      struct Range
+      {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0; // From the start of memory, for binding and descriptors
+        void *mapped = nullptr;
+      };
+
+      void init(
+        DeviceMemoryAllocator &allocator,
+        VkDeviceSize capacity,
+        std::uint32_t type_bits,
+        VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred = 0
+      );
+      void destroy();
+
+      // Returns false when the ring is full; nothing is handed out then
+      bool allocate(VkDeviceSize size, VkDeviceSize alignment, Range &range);
+      // Closes the frame that allocations since the previous call belong to
+      void endFrame();
+      // The oldest closed frame has finished on the GPU
+      void retireFrame();
+      void reset();
+
+      VkDeviceSize capacity() const { return ring_capacity; }
+      VkDeviceSize usedBytes() const { return in_use; }
+      VkDeviceSize peakBytes() const { return peak; }
+      DeviceAllocation const *allocation() const { return ring_allocation; }
+
+    private:
+      DeviceMemoryAllocator *allocator = nullptr;
+      DeviceAllocation *ring_allocation = nullptr;
+      VkDeviceSize ring_capacity = 0;
+      VkDeviceSize head = 0;
+      VkDeviceSize in_use = 0;     // From the oldest live frame's start to head, padding included
+      VkDeviceSize frame_bytes = 0;
+      VkDeviceSize peak = 0;
+      std::deque<VkDeviceSize> frames; // Bytes taken by each closed frame, oldest first
+    };
+  }
+#endif
+
+}
+
+#endif // DEVICE_MEMORY_H
@@ -0,0 +1,356 @@
+#include "device_selection.h"
+#include "debug.h"
+#include "file_io.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifdef USING_VULKAN
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    static char const CACHE_MAGIC[] = "vti-device-selection";
+    static int constexpr CACHE_VERSION = 1;
+
+    static bool canQueryProperties2(
+      InstanceDispatch const &vk,
+      std::uint32_t api_version,
+      std::uint32_t device_version)
+    {
+      return vk.vkGetPhysicalDeviceProperties2 != nullptr
+        && api_version >= VK_API_VERSION_1_1
+        && device_version >= VK_API_VERSION_1_1;
+    }
+
+    static std::string uuidToString(std::uint8_t const (&uuid)[VK_UUID_SIZE])
+    {
+      char text[VK_UUID_SIZE * 2 + 1];
+      for (std::uint32_t i=0; i<VK_UUID_SIZE; ++i)
+      {
+        std::snprintf(text + i * 2, 3, "%02x", uuid[i]);
+      }
+      return std::string(text, VK_UUID_SIZE * 2);
+    }
+
+    int DeviceScore::total() const
+    {
+      return device_type + memory + queues + subgroup + features + limits;
+    }
+
+    DeviceScore DefaultScoringPolicy::score(PhysicalDeviceInfo const &device) const
+    {
+      DeviceScore score;
+
+      // Application can't function without geometry shaders or the queues it needs
+      score.suitable = device.features.geometryShader && device.indices.isComplete();
+
+      // Discrete GPUs have a significant performance advantage
+      if (device.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+      {
+        score.device_type = discrete_gpu;
+      }
+      else if (device.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
+      {
+        score.device_type = integrated_gpu;
+      }
+
+      VkDeviceSize device_local_size = 0;
+      for (std::uint32_t i=0; i<device.memory_properties.memoryHeapCount; ++i)
+      {
+        VkMemoryHeap const &heap = device.memory_properties.memoryHeaps[i];
+        if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        {
+          device_local_size += heap.size;
+        }
+      }
+      score.memory = static_cast<int>(device_local_size >> 30) * per_device_local_gib;
+
+      // Families without graphics let uploads and compute run alongside rendering
+      score.queues = (device.indices.transfer.isValid() ? dedicated_transfer_family : 0)
+        + (device.indices.compute.isValid() ? async_compute_family : 0);
+
+      score.subgroup = static_cast<int>(device.subgroup_size) * per_subgroup_lane;
+
+      VkBool32 const optional_features[] = {
+        device.features.samplerAnisotropy,
+        device.features.fillModeNonSolid,
+        device.features.multiDrawIndirect,
+        device.features.textureCompressionBC,
+        device.features.pipelineStatisticsQuery,
+        device.features.shaderInt64
+      };
+      for (VkBool32 feature : optional_features)
+      {
+        if (feature)
+        {
+          score.features += per_optional_feature;
+        }
+      }
+
+      // Maximum possible size of textures affects graphics quality
+      score.limits = static_cast<int>(device.properties.limits.maxImageDimension2D) / max_image_dimension_divisor;
+
+      return score;
+    }
+
+    std::string DefaultScoringPolicy::signature() const
+    {
+      std::ostringstream stream;
+      stream << "default"
+        << ' ' << discrete_gpu << ' ' << integrated_gpu << ' ' << per_device_local_gib
+        << ' ' << dedicated_transfer_family << ' ' << async_compute_family << ' ' << per_subgroup_lane
+        << ' ' << per_optional_feature << ' ' << max_image_dimension_divisor;
+      return stream.str();
+    }
+
+    void queryPhysicalDeviceIdentity(
+      InstanceDispatch const &vk,
+      std::uint32_t api_version,
+      VkPhysicalDevice device,
+      PhysicalDeviceInfo &info)
+    {
+      info.device = device;
+      vk.vkGetPhysicalDeviceProperties(device, &info.properties);
+
+      if (canQueryProperties2(vk, api_version, info.properties.apiVersion))
+      {
+        VkPhysicalDeviceIDProperties id_properties = {};
+        id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &id_properties;
+        vk.vkGetPhysicalDeviceProperties2(device, &properties);
+
+        std::copy(id_properties.deviceUUID, id_properties.deviceUUID + VK_UUID_SIZE, info.uuid);
+      }
+      else
+      {
+        std::copy(info.properties.pipelineCacheUUID, info.properties.pipelineCacheUUID + VK_UUID_SIZE, info.uuid);
+      }
+    }
+
+    void queryPhysicalDeviceDetails(
+      InstanceDispatch const &vk,
+      VkInstance instance,
+      std::uint32_t api_version,
+      PhysicalDeviceInfo &info)
+    {
+      Debug::Trace("Querying Vulkan device {}", info.properties.deviceName);
+
+      vk.vkGetPhysicalDeviceFeatures(info.device, &info.features);
+      vk.vkGetPhysicalDeviceMemoryProperties(info.device, &info.memory_properties);
+
+      std::uint32_t queue_family_count = 0;
+      vk.vkGetPhysicalDeviceQueueFamilyProperties(info.device, &queue_family_count, nullptr);
+      info.queue_families.resize(queue_family_count);
+      vk.vkGetPhysicalDeviceQueueFamilyProperties(info.device, &queue_family_count, info.queue_families.data());
+      info.indices = findQueueFamilies(
+        info.queue_families, queryPresentSupport(instance, info.device, queue_family_count)
+      );
+
+      if (canQueryProperties2(vk, api_version, info.properties.apiVersion))
+      {
+        VkPhysicalDeviceSubgroupProperties subgroup_properties = {};
+        subgroup_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &subgroup_properties;
+        vk.vkGetPhysicalDeviceProperties2(info.device, &properties);
+
+        info.subgroup_size = subgroup_properties.subgroupSize;
+
+        info.descriptor_indexing = queryDescriptorIndexing(
+          vk, api_version, info.device, info.descriptor_indexing_limits
+        );
+      }
+    }
+
+    bool queryDescriptorIndexing(
+      InstanceDispatch const &vk,
+      std::uint32_t api_version,
+      VkPhysicalDevice device,
+      VkPhysicalDeviceDescriptorIndexingPropertiesEXT &limits)
+    {
+      VkPhysicalDeviceProperties2 properties = {};
+      properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+      vk.vkGetPhysicalDeviceProperties(device, &properties.properties);
+      if (!canQueryProperties2(vk, api_version, properties.properties.apiVersion)
+        || vk.vkGetPhysicalDeviceFeatures2 == nullptr)
+      {
+        return false;
+      }
+
+      std::uint32_t extension_count = 0;
+      vk.vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
+      std::vector<VkExtensionProperties> extensions(extension_count);
+      vk.vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, extensions.data());
+      bool const available = std::any_of(extensions.begin(), extensions.end(), [](VkExtensionProperties const &e)
+      {
+        return std::strcmp(e.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+      });
+      if (!available)
+      {
+        return false;
+      }
+
+      VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {};
+      indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+      VkPhysicalDeviceFeatures2 features = {};
+      features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+      features.pNext = &indexing_features;
+      vk.vkGetPhysicalDeviceFeatures2(device, &features);
+      // Shaders index one array of every texture with whatever index a draw passes in, and slots are filled
+      // in while frames using other slots are still in flight
+      if (!indexing_features.runtimeDescriptorArray
+        || !indexing_features.shaderSampledImageArrayNonUniformIndexing
+        || !indexing_features.descriptorBindingPartiallyBound
+        || !indexing_features.descriptorBindingSampledImageUpdateAfterBind
+        || !indexing_features.descriptorBindingStorageBufferUpdateAfterBind
+        || !indexing_features.descriptorBindingUpdateUnusedWhilePending)
+      {
+        return false;
+      }
+
+      limits = {};
+      limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+      properties.pNext = &limits;
+      vk.vkGetPhysicalDeviceProperties2(device, &properties);
+      return true;
+    }
+
+    // The cache is a small text file:
+    //   vti-device-selection <version>
+    //   policy <signature>
+    //   devices <count>
+    //   <vendor id> <device id> <driver version> <uuid>     one line per device, in enumeration order
+    //   selected <index>
+    //   score <device type> <memory> <queues> <subgroup> <features> <limits>
+    int loadDeviceSelection(
+      std::string const &path,
+      std::string const &policy_signature,
+      std::vector<PhysicalDeviceInfo> const &devices,
+      DeviceScore &score)
+    {
+      std::ifstream file(path);
+      if (!file)
+      {
+        return -1;
+      }
+
+      std::string magic;
+      int version = 0;
+      file >> magic >> version;
+      if (!file || magic != CACHE_MAGIC || version != CACHE_VERSION)
+      {
+        Debug::Trace("Ignoring device cache {} with unknown format", path);
+        return -1;
+      }
+
+      std::string keyword;
+      std::string signature;
+      file >> keyword;
+      file.ignore(1);
+      std::getline(file, signature);
+      if (!file || keyword != "policy" || signature != policy_signature)
+      {
+        Debug::Trace("Ignoring device cache {} written with another scoring policy", path);
+        return -1;
+      }
+
+      size_t device_count = 0;
+      file >> keyword >> device_count;
+      if (!file || keyword != "devices" || device_count != devices.size())
+      {
+        Debug::Trace("Ignoring device cache {}, the set of devices changed", path);
+        return -1;
+      }
+
+      // Any new driver may change what a device supports, so the whole choice is redone
+      for (PhysicalDeviceInfo const &device : devices)
+      {
+        std::uint32_t vendor_id = 0;
+        std::uint32_t device_id = 0;
+        std::uint32_t driver_version = 0;
+        std::string uuid;
+        file >> vendor_id >> device_id >> driver_version >> uuid;
+        if (!file
+          || vendor_id != device.properties.vendorID
+          || device_id != device.properties.deviceID
+          || driver_version != device.properties.driverVersion
+          || uuid != uuidToString(device.uuid))
+        {
+          Debug::Trace("Ignoring device cache {}, a device or driver changed", path);
+          return -1;
+        }
+      }
+
+      size_t selected = 0;
+      file >> keyword >> selected;
+      if (!file || keyword != "selected" || selected >= devices.size())
+      {
+        return -1;
+      }
+
+      DeviceScore cached;
+      file >> keyword
+        >> cached.device_type >> cached.memory >> cached.queues
+        >> cached.subgroup >> cached.features >> cached.limits;
+      if (!file || keyword != "score")
+      {
+        return -1;
+      }
+
+      cached.suitable = true;
+      score = cached;
+      return static_cast<int>(selected);
+    }
+
+    void saveDeviceSelection(
+      std::string const &path,
+      std::string const &policy_signature,
+      std::vector<PhysicalDeviceInfo> const &devices,
+      size_t selected,
+      DeviceScore const &score)
+    {
+      // Written next to the real file and renamed over it, so a crash never leaves a half written cache behind
+      std::string const temporary_path = File::temporaryPath(path);
+      bool written;
+      {
+        std::ofstream file(temporary_path, std::ios::trunc);
+        file << CACHE_MAGIC << ' ' << CACHE_VERSION << '\n';
+        file << "policy " << policy_signature << '\n';
+        file << "devices " << devices.size() << '\n';
+        for (PhysicalDeviceInfo const &device : devices)
+        {
+          file << device.properties.vendorID << ' ' << device.properties.deviceID << ' '
+            << device.properties.driverVersion << ' ' << uuidToString(device.uuid) << '\n';
+        }
+        file << "selected " << selected << '\n';
+        file << "score " << score.device_type << ' ' << score.memory << ' ' << score.queues << ' '
+          << score.subgroup << ' ' << score.features << ' ' << score.limits << '\n';
+
+        written = static_cast<bool>(file.flush());
+      }
+      if (!written)
+      {
+        std::remove(temporary_path.c_str());
+        Debug::Warning("Failed to write device cache {}", temporary_path);
+        return;
+      }
+
+      if (!File::replaceFile(temporary_path, path))
+      {
+        Debug::Warning("Failed to replace device cache {}", path);
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef DEVICE_SELECTION_H
+#define DEVICE_SELECTION_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "queue_families.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Everything a scoring policy may look at, gathered once per device
+    struct PhysicalDeviceInfo
+    {
+      VkPhysicalDevice device = VK_NULL_HANDLE;
+      VkPhysicalDeviceProperties properties = {};
+      VkPhysicalDeviceFeatures features = {};
+      VkPhysicalDeviceMemoryProperties memory_properties = {};
+      std::vector<VkQueueFamilyProperties> queue_families;
+      QueueFamilyIndices indices;
+      // deviceUUID on Vulkan 1.1, pipelineCacheUUID otherwise
+      std::uint8_t uuid[VK_UUID_SIZE] = {};
+      // 0 when the instance or device is Vulkan 1.0 and the size can't be queried
+      std::uint32_t subgroup_size = 0;
+      // VK_EXT_descriptor_indexing with everything the bindless table needs, and its update-after-bind limits
+      bool descriptor_indexing = false;
+      VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptor_indexing_limits = {};
+    };
+
+    // A score split by criterion, so the choice can be logged and cached.
+    // Devices missing a hard requirement are unsuitable whatever their total.
+    struct DeviceScore
+    {
+      bool suitable = false;
+      int device_type = 0;
+      int memory = 0;
+      int queues = 0;
+      int subgroup = 0;
+      int features = 0;
+      int limits = 0;
+
+      int total() const;
+    };
+
+    class DeviceScoringPolicy
+    {
+    public:
+      virtual ~DeviceScoringPolicy() = default;
+
+      virtual DeviceScore score(PhysicalDeviceInfo const &device) const = 0;
+      // Identifies the policy and its weights; a cached choice made under a different signature is discarded
+      virtual std::string signature() const = 0;
+    };
+
+    // Requires geometry shaders and graphics and present queues, then prefers discrete GPUs with lots of device
+    // local memory, separate transfer and compute queue families, wide subgroups and the optional features below
+    class DefaultScoringPolicy : public DeviceScoringPolicy
+    {
+    public:
+      DeviceScore score(PhysicalDeviceInfo const &device) const override;
+      std::string signature() const override;
+
+      int discrete_gpu = 1000;
+      int integrated_gpu = 250;
+      int per_device_local_gib = 100;
+      int dedicated_transfer_family = 200;
+      int async_compute_family = 200;
+      int per_subgroup_lane = 4;
+      int per_optional_feature = 50;
+      // Image size limits used to be the whole score, so they are scaled down to break ties only
+      int max_image_dimension_divisor = 64;
+    };
+
+    // Fills in properties and uuid only, which is all the device cache needs to recognise a device
+    void queryPhysicalDeviceIdentity(
+      InstanceDispatch const &vk,
+      std::uint32_t api_version,
+      VkPhysicalDevice device,
+      PhysicalDeviceInfo &info
+    );
+    // Fills in everything else. Safe to run for several devices at once.
+    void queryPhysicalDeviceDetails(
+      InstanceDispatch const &vk,
+      VkInstance instance,
+      std::uint32_t api_version,
+      PhysicalDeviceInfo &info
+    );
+
+    // Whether device has VK_EXT_descriptor_indexing with every feature the bindless table uses, filling in its
+    // update-after-bind limits if so. Always false when the instance or device is Vulkan 1.0.
+    bool queryDescriptorIndexing(
+      InstanceDispatch const &vk,
+      std::uint32_t api_version,
+      VkPhysicalDevice device,
+      VkPhysicalDeviceDescriptorIndexingPropertiesEXT &limits
+    );
+
+    // Returns the index into devices of the cached choice, or -1 when the cache is missing, unreadable, or was
+    // written for a different set of devices, driver versions or scoring policy
+    int loadDeviceSelection(
+      std::string const &path,
+      std::string const &policy_signature,
+      std::vector<PhysicalDeviceInfo> const &devices,
+      DeviceScore &score
+    );
+    void saveDeviceSelection(
+      std::string const &path,
+      std::string const &policy_signature,
+      std::vector<PhysicalDeviceInfo> const &devices,
+      size_t selected,
+      DeviceScore const &score
+    );
+  }
+#endif
+
+}
+
+#endif // DEVICE_SELECTION_H
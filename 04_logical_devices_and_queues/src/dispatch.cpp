@@ -0,0 +1,66 @@
+#include "dispatch.h"
+#include "debug.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef USING_VULKAN
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    template <typename Function>
+    static void loadRequired(Function &function, PFN_vkVoidFunction address, char const *name)
+    {
+      if (address == nullptr)
+      {
+        throw std::runtime_error(std::string("ERROR: Failed to load Vulkan function ") + name);
+      }
+      function = reinterpret_cast<Function>(address);
+    }
+
+    template <typename Function>
+    static void loadOptional(Function &function, PFN_vkVoidFunction address)
+    {
+      function = reinterpret_cast<Function>(address);
+    }
+
+    void loadGlobalFunctions(InstanceDispatch &dispatch)
+    {
+      #define VULKAN_GLOBAL_FUNCTION(name) \
+        loadRequired(dispatch.name, vkGetInstanceProcAddr(VK_NULL_HANDLE, #name), #name);
+      #define VULKAN_GLOBAL_EXTENSION(name) \
+        loadOptional(dispatch.name, vkGetInstanceProcAddr(VK_NULL_HANDLE, #name));
+      #include "vulkan_functions.inl"
+
+      Debug::Trace("Vulkan global functions loaded");
+    }
+
+    void loadInstanceFunctions(InstanceDispatch &dispatch, VkInstance instance)
+    {
+      #define VULKAN_INSTANCE_FUNCTION(name) \
+        loadRequired(dispatch.name, vkGetInstanceProcAddr(instance, #name), #name);
+      #define VULKAN_INSTANCE_EXTENSION(name) \
+        loadOptional(dispatch.name, vkGetInstanceProcAddr(instance, #name));
+      #include "vulkan_functions.inl"
+
+      Debug::Trace("Vulkan instance functions loaded");
+    }
+
+    void loadDeviceFunctions(DeviceDispatch &dispatch, InstanceDispatch const &instance_dispatch, VkDevice device)
+    {
+      PFN_vkGetDeviceProcAddr get_device_proc_addr = instance_dispatch.vkGetDeviceProcAddr;
+
+      #define VULKAN_DEVICE_FUNCTION(name) \
+        loadRequired(dispatch.name, get_device_proc_addr(device, #name), #name);
+      #define VULKAN_DEVICE_EXTENSION(name) \
+        loadOptional(dispatch.name, get_device_proc_addr(device, #name));
+      #include "vulkan_functions.inl"
+
+      Debug::Trace("Vulkan device functions loaded");
+    }
+  }
+}
+
+#endif
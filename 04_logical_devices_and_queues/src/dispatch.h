@@ -0,0 +1,39 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "init.h"
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Function pointers resolved once per instance and per device, so calls skip the loader trampolines.
+    // Device level functions are fetched with vkGetDeviceProcAddr and go straight to the driver.
+    struct InstanceDispatch
+    {
+      #define VULKAN_GLOBAL_FUNCTION(name) PFN_##name name = nullptr;
+      #define VULKAN_GLOBAL_EXTENSION(name) PFN_##name name = nullptr;
+      #define VULKAN_INSTANCE_FUNCTION(name) PFN_##name name = nullptr;
+      #define VULKAN_INSTANCE_EXTENSION(name) PFN_##name name = nullptr;
+      #include "vulkan_functions.inl"
+    };
+
+    struct DeviceDispatch
+    {
+      #define VULKAN_DEVICE_FUNCTION(name) PFN_##name name = nullptr;
+      #define VULKAN_DEVICE_EXTENSION(name) PFN_##name name = nullptr;
+      #include "vulkan_functions.inl"
+    };
+
+    // Functions usable before an instance exists
+    void loadGlobalFunctions(InstanceDispatch &dispatch);
+    void loadInstanceFunctions(InstanceDispatch &dispatch, VkInstance instance);
+    void loadDeviceFunctions(DeviceDispatch &dispatch, InstanceDispatch const &instance_dispatch, VkDevice device);
+  }
+#endif
+
+}
+
+#endif // DISPATCH_H
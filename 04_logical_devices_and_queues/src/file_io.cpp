@@ -0,0 +1,133 @@
+#include "file_io.h"
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace File
+{
+  MappedFile::~MappedFile()
+  {
+    close();
+  }
+
+  bool MappedFile::open(std::string const &path)
+  {
+    close();
+
+    #ifdef _WIN32
+      HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+      );
+      if (file == INVALID_HANDLE_VALUE)
+      {
+        return false;
+      }
+
+      LARGE_INTEGER file_size;
+      if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+      {
+        CloseHandle(file);
+        return false;
+      }
+
+      // The view keeps the file open, so both handles can go right away
+      HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      CloseHandle(file);
+      if (mapping == nullptr)
+      {
+        return false;
+      }
+      view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+      if (view == nullptr)
+      {
+        return false;
+      }
+      view_size = static_cast<size_t>(file_size.QuadPart);
+    #else
+      int file = ::open(path.c_str(), O_RDONLY);
+      if (file < 0)
+      {
+        return false;
+      }
+
+      struct stat file_stat;
+      if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+      {
+        ::close(file);
+        return false;
+      }
+
+      // The mapping keeps the file open, so the descriptor can go right away
+      void *mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+      ::close(file);
+      if (mapping == MAP_FAILED)
+      {
+        return false;
+      }
+      view = mapping;
+      view_size = static_cast<size_t>(file_stat.st_size);
+    #endif
+
+    return true;
+  }
+
+  void MappedFile::close()
+  {
+    if (view == nullptr)
+    {
+      return;
+    }
+
+    #ifdef _WIN32
+      UnmapViewOfFile(view);
+    #else
+      munmap(view, view_size);
+    #endif
+
+    view = nullptr;
+    view_size = 0;
+  }
+
+  bool replaceFile(std::string const &temporary_path, std::string const &path)
+  {
+    // Both replace path in one step, so there is never a moment without it
+    #ifdef _WIN32
+      // rename() won't replace an existing file on Windows
+      bool const replaced = MoveFileExA(
+        temporary_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+      ) != 0;
+    #else
+      bool const replaced = std::rename(temporary_path.c_str(), path.c_str()) == 0;
+    #endif
+
+    if (!replaced)
+    {
+      std::remove(temporary_path.c_str());
+    }
+    return replaced;
+  }
+
+  std::string temporaryPath(std::string const &path)
+  {
+    static std::atomic<unsigned> counter(0);
+    #ifdef _WIN32
+      unsigned long const process = GetCurrentProcessId();
+    #else
+      unsigned long const process = static_cast<unsigned long>(getpid());
+    #endif
+    return path + "." + std::to_string(process) + "." + std::to_string(counter.fetch_add(1)) + ".tmp";
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <cstddef>
+#include <string>
+
+namespace File
+{
+  // A whole file mapped read only. Pages are read in on first touch, so loading costs nothing up front.
+  class MappedFile
+  {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+
+    // False if the file is missing, empty or can't be mapped
+    bool open(std::string const &path);
+    void close();
+
+    void const *data() const { return view; }
+    size_t size() const { return view_size; }
+
+  private:
+    void *view = nullptr;
+    size_t view_size = 0;
+  };
+
+  // Moves temporary_path over path. Writing to a temporary file first and replacing the real one with it
+  // means a crash never leaves a half written file behind. The temporary file is removed on failure.
+  bool replaceFile(std::string const &temporary_path, std::string const &path);
+  // A temporary file name beside path for replaceFile, unique to this process and call, so writers of the same
+  // file in parallel builds or threads never write through the same temporary file
+  std::string temporaryPath(std::string const &path);
+}
+
+#endif // FILE_IO_H
@@ -0,0 +1,52 @@
+#include "frame_pacer.h"
+#include "profiler.h"
+
+#include <thread>
+
+FramePacer::FramePacer(double target_frame_rate)
+{
+  setTargetFrameRate(target_frame_rate);
+}
+
+void FramePacer::setTargetFrameRate(double target_frame_rate)
+{
+  period = target_frame_rate > 0.0
+    ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / target_frame_rate)
+      )
+    : std::chrono::steady_clock::duration::zero();
+  scheduled = false;
+}
+
+void FramePacer::wait()
+{
+  ++frame_count;
+  if (period == std::chrono::steady_clock::duration::zero())
+  {
+    return;
+  }
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (!scheduled)
+  {
+    next_frame = now + period;
+    scheduled = true;
+    return;
+  }
+
+  if (now >= next_frame)
+  {
+    ++late_frames;
+    next_frame = now + period;
+    return;
+  }
+
+  PROFILE_ZONE("Frame pacing");
+  std::this_thread::sleep_until(next_frame);
+  next_frame += period;
+}
+
+void FramePacer::reset()
+{
+  scheduled = false;
+}
@@ -0,0 +1,32 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+#include <cstdint>
+
+// Holds the run loop to a target frame rate by sleeping until each frame is due, rather than spinning.
+// A frame that runs long pushes the schedule back instead of being made up for with a burst of frames.
+class FramePacer
+{
+public:
+  // 0 leaves frames unpaced
+  explicit FramePacer(double target_frame_rate = 0.0);
+
+  void setTargetFrameRate(double target_frame_rate);
+  // Sleeps until the next frame is due
+  void wait();
+  // Starts the schedule over from now, for after the loop has blocked on something else such as input
+  void reset();
+
+  std::uint64_t frameCount() const { return frame_count; }
+  std::uint64_t lateFrames() const { return late_frames; }
+
+private:
+  std::chrono::steady_clock::duration period = std::chrono::steady_clock::duration::zero();
+  std::chrono::steady_clock::time_point next_frame;
+  bool scheduled = false;
+  std::uint64_t frame_count = 0;
+  std::uint64_t late_frames = 0;
+};
+
+#endif // FRAME_PACER_H
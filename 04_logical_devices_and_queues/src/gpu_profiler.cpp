@@ -0,0 +1,246 @@
+#include "gpu_profiler.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    void GpuProfiler::init(
+      DeviceDispatch const &vk,
+      VkDevice device,
+      VkAllocationCallbacks const *allocator,
+      VkPhysicalDeviceProperties const &properties,
+      QueueFamily const &family,
+      char const *name,
+      std::uint32_t latency)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->allocator = allocator;
+      profiler_name = name;
+
+      if (family.timestamp_valid_bits == 0 || properties.limits.timestampPeriod <= 0.0f)
+      {
+        Debug::Info("The {} queue family can't write timestamps, GPU profiling is off", name);
+        return;
+      }
+
+      timestamp_period = static_cast<double>(properties.limits.timestampPeriod);
+      timestamp_mask = family.timestamp_valid_bits >= 64
+        ? ~std::uint64_t(0)
+        : (std::uint64_t(1) << family.timestamp_valid_bits) - 1;
+
+      frames.assign(std::max(latency, 1u), Frame());
+      results.resize(2 * MAX_PASSES);
+
+      VkQueryPoolCreateInfo pool_info = {};
+      pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+      pool_info.queryCount = static_cast<std::uint32_t>(frames.size()) * 2 * MAX_PASSES;
+      if (vk.vkCreateQueryPool(device, &pool_info, allocator, &query_pool) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create timestamp query pool");
+      }
+
+      #ifdef PROFILING
+        track = Profiling::addTrack(std::string("GPU ") + name + " queue");
+      #endif
+
+      Debug::Trace(
+        "GPU profiler for the {} queue: {} ns per tick, {} valid bits, {} frames latency",
+        name, timestamp_period, family.timestamp_valid_bits, frames.size()
+      );
+    }
+
+    void GpuProfiler::destroy()
+    {
+      if (query_pool != VK_NULL_HANDLE)
+      {
+        vk->vkDestroyQueryPool(device, query_pool, allocator);
+        query_pool = VK_NULL_HANDLE;
+      }
+      frames.clear();
+    }
+
+    void GpuProfiler::beginFrame(VkCommandBuffer command_buffer)
+    {
+      if (!isEnabled())
+      {
+        return;
+      }
+
+      current = static_cast<std::uint32_t>(frame_count % frames.size());
+      ++frame_count;
+      collect(current);
+
+      vk->vkCmdResetQueryPool(command_buffer, query_pool, current * 2 * MAX_PASSES, 2 * MAX_PASSES);
+    }
+
+    std::uint32_t GpuProfiler::beginPass(VkCommandBuffer command_buffer, char const *name)
+    {
+      if (!isEnabled())
+      {
+        return NO_PASS;
+      }
+
+      Frame &frame = frames[current];
+      if (frame.pass_count == MAX_PASSES)
+      {
+        return NO_PASS;
+      }
+
+      auto found = pass_lookup.find(name);
+      std::uint32_t stats = 0;
+      if (found != pass_lookup.end())
+      {
+        stats = found->second;
+      }
+      else
+      {
+        stats = static_cast<std::uint32_t>(pass_stats.size());
+        pass_stats.emplace_back();
+        pass_stats.back().name = name;
+        #ifdef PROFILING
+          pass_stats.back().zone_name = Profiling::intern(name);
+        #endif
+        pass_lookup.emplace(name, stats);
+      }
+
+      std::uint32_t pass = frame.pass_count++;
+      frame.passes[pass] = stats;
+      frame.pending = true;
+      vk->vkCmdWriteTimestamp(
+        command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, (current * MAX_PASSES + pass) * 2
+      );
+      return pass;
+    }
+
+    void GpuProfiler::endPass(VkCommandBuffer command_buffer, std::uint32_t pass)
+    {
+      if (pass == NO_PASS)
+      {
+        return;
+      }
+
+      vk->vkCmdWriteTimestamp(
+        command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, (current * MAX_PASSES + pass) * 2 + 1
+      );
+    }
+
+    void GpuProfiler::endFrame()
+    {
+      if (!isEnabled())
+      {
+        return;
+      }
+
+      #ifdef PROFILING
+        frames[current].submit_time = Profiling::now();
+      #endif
+    }
+
+    void GpuProfiler::collectAll()
+    {
+      for (std::uint32_t slot=0; slot<frames.size(); ++slot)
+      {
+        collect(slot);
+      }
+    }
+
+    void GpuProfiler::collect(std::uint32_t slot)
+    {
+      Frame &frame = frames[slot];
+      if (!frame.pending)
+      {
+        return;
+      }
+      frame.pending = false;
+
+      std::uint32_t query_count = frame.pass_count * 2;
+      frame.pass_count = 0;
+
+      // No WAIT flag: a frame whose timestamps aren't all written, such as one that was never submitted,
+      // is dropped rather than waited on
+      VkResult result = vk->vkGetQueryPoolResults(
+        device, query_pool, slot * 2 * MAX_PASSES, query_count,
+        query_count * sizeof(std::uint64_t), results.data(), sizeof(std::uint64_t),
+        VK_QUERY_RESULT_64_BIT
+      );
+      if (result != VK_SUCCESS)
+      {
+        ++dropped_frames;
+        return;
+      }
+
+      for (std::uint32_t pass=0; pass<query_count/2; ++pass)
+      {
+        // Masking the difference keeps it right across a counter wrap
+        std::uint64_t begin = results[2 * pass];
+        std::uint64_t ticks = (results[2 * pass + 1] - begin) & timestamp_mask;
+        double duration_ns = static_cast<double>(ticks) * timestamp_period;
+
+        PassStats &stats = pass_stats[frame.passes[pass]];
+        stats.samples_us[stats.next] = duration_ns / 1000.0;
+        stats.next = (stats.next + 1) % HISTORY;
+        stats.count = std::min(stats.count + 1, HISTORY);
+
+        #ifdef PROFILING
+          double offset_ns = static_cast<double>((begin - results[0]) & timestamp_mask) * timestamp_period;
+          std::uint64_t start = frame.submit_time + static_cast<std::uint64_t>(offset_ns);
+          Profiling::record(track, stats.zone_name, start, start + static_cast<std::uint64_t>(duration_ns));
+        #endif
+      }
+    }
+
+    std::vector<GpuProfiler::PassTiming> GpuProfiler::passTimings() const
+    {
+      std::vector<PassTiming> timings;
+      for (PassStats const &stats : pass_stats)
+      {
+        if (stats.count == 0)
+        {
+          continue;
+        }
+
+        PassTiming timing = { stats.name, stats.samples_us[0], 0.0, stats.samples_us[0], stats.count };
+        double total = 0.0;
+        for (std::uint32_t i=0; i<stats.count; ++i)
+        {
+          timing.min_us = std::min(timing.min_us, stats.samples_us[i]);
+          timing.max_us = std::max(timing.max_us, stats.samples_us[i]);
+          total += stats.samples_us[i];
+        }
+        timing.avg_us = total / stats.count;
+        timings.push_back(timing);
+      }
+      return timings;
+    }
+
+    void GpuProfiler::logTimings() const
+    {
+      if (!isEnabled())
+      {
+        return;
+      }
+
+      for (PassTiming const &timing : passTimings())
+      {
+        Debug::Info(
+          "GPU {} pass {}: avg {} us, min {} us, max {} us over the last {} frames",
+          profiler_name, timing.name, timing.avg_us, timing.min_us, timing.max_us, timing.samples
+        );
+      }
+      if (dropped_frames > 0)
+      {
+        Debug::Warning("GPU {} profiler dropped {} frames with timestamps missing", profiler_name, dropped_frames);
+      }
+    }
+  }
+#endif
+
+}
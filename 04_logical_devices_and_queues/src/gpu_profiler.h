@@ -0,0 +1,114 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "queue_families.h"
+#include "profiler.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // GPU time per named pass, from timestamps written around the pass into a query pool. Each frame writes
+    // into one of latency slots, and a slot's results are read when it comes round again, by which time the
+    // frame has finished, so reading never stalls. Frames in flight must stay below the latency.
+    // Not thread safe; it belongs to the thread recording the frames.
+    class GpuProfiler
+    {
+    public:
+      static std::uint32_t constexpr MAX_PASSES = 32;      // Per frame; later passes aren't timed
+      static std::uint32_t constexpr HISTORY = 128;        // Frames the rolling statistics cover
+      static std::uint32_t constexpr DEFAULT_LATENCY = 3;
+      static std::uint32_t constexpr NO_PASS = ~std::uint32_t(0);
+
+      struct PassTiming
+      {
+        std::string name;
+        double min_us;
+        double avg_us;
+        double max_us;
+        std::uint32_t samples;
+      };
+
+      // Stays disabled, with every call below doing nothing, when the family can't write timestamps
+      void init(
+        DeviceDispatch const &vk,
+        VkDevice device,
+        VkAllocationCallbacks const *allocator,
+        VkPhysicalDeviceProperties const &properties,
+        QueueFamily const &family,
+        char const *name,
+        std::uint32_t latency = DEFAULT_LATENCY
+      );
+      void destroy();
+      bool isEnabled() const { return query_pool != VK_NULL_HANDLE; }
+
+      // Collects the results of the frame that last used this frame's slot and resets its queries
+      void beginFrame(VkCommandBuffer command_buffer);
+      // Passes may nest. Returns the pass to end, or NO_PASS once the frame has MAX_PASSES.
+      std::uint32_t beginPass(VkCommandBuffer command_buffer, char const *name);
+      void endPass(VkCommandBuffer command_buffer, std::uint32_t pass);
+      // Call as the frame is submitted. GPU and CPU clocks aren't calibrated against each other, so the
+      // frame's passes are placed in the trace from this moment.
+      void endFrame();
+      // Collects every frame still outstanding. The GPU must be done with all of them.
+      void collectAll();
+
+      std::vector<PassTiming> passTimings() const;
+      void logTimings() const;
+
+    private:
+      struct Frame
+      {
+        std::uint32_t passes[MAX_PASSES]; // Into pass_stats, in the order begun
+        std::uint32_t pass_count = 0;
+        bool pending = false;
+        std::uint64_t submit_time = 0;    // Profiling clock
+      };
+
+      struct PassStats
+      {
+        std::string name;
+        char const *zone_name = nullptr;
+        double samples_us[HISTORY] = {};
+        std::uint32_t next = 0;
+        std::uint32_t count = 0;
+      };
+
+      void collect(std::uint32_t slot);
+
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+      VkQueryPool query_pool = VK_NULL_HANDLE;
+      double timestamp_period = 0.0;  // Nanoseconds per tick
+      std::uint64_t timestamp_mask = 0;
+      char const *profiler_name = "";
+
+      std::vector<Frame> frames;
+      std::uint32_t current = 0;
+      std::uint64_t frame_count = 0;
+      std::uint64_t dropped_frames = 0;
+      std::vector<std::uint64_t> results;
+
+      std::vector<PassStats> pass_stats;
+      std::unordered_map<std::string, std::uint32_t> pass_lookup;
+
+      #ifdef PROFILING
+        Profiling::Track *track = nullptr;
+      #endif
+    };
+  }
+#endif
+
+}
+
+#endif // GPU_PROFILER_H
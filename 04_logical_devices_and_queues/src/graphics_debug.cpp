@@ -0,0 +1,190 @@
+#include "graphics_setup.h"
+#include "debug.h"
+
+#include <stdexcept>
+
+#if defined(USING_VULKAN) && !defined(NDEBUG)
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    static VKAPI_ATTR VkBool32 VKAPI_CALL debugPrintCallback(
+      VkDebugReportFlagsEXT flags,
+      VkDebugReportObjectTypeEXT obj_type,
+      std::uint64_t obj,
+      [[maybe_unused]] size_t location,
+      std::int32_t code,
+      char const *layer_prefix,
+      char const *msg,
+      void *user_data)
+    {
+      ValidationFilter &filter = *static_cast<ValidationFilter *>(user_data);
+      std::uint64_t occurrences = 0;
+      switch (filter.record(layer_prefix, code, obj_type, obj, occurrences))
+      {
+        case ValidationFilter::Action::Suppress:
+          return VK_FALSE;
+        case ValidationFilter::Action::Summarize:
+          ValidationFilter::logRepeated(layer_prefix, code, occurrences);
+          return VK_FALSE;
+        case ValidationFilter::Action::SummarizeUntracked:
+          ValidationFilter::logUntracked(occurrences);
+          return VK_FALSE;
+        case ValidationFilter::Action::Report:
+          break;
+      }
+
+      // Called on whatever thread the driver or layer is running, so only queue the message here
+      if (flags & VK_DEBUG_REPORT_ERROR_BIT_EXT)
+      {
+        Debug::Error("Validation layer {} (code {}): {}", layer_prefix, code, msg);
+      }
+      else
+      {
+        Debug::Warning("Validation layer {} (code {}): {}", layer_prefix, code, msg);
+      }
+
+      return VK_FALSE;
+    }
+
+    static VKAPI_ATTR VkBool32 VKAPI_CALL debugUtilsCallback(
+      VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+      VkDebugUtilsMessageTypeFlagsEXT types,
+      VkDebugUtilsMessengerCallbackDataEXT const *data,
+      void *user_data)
+    {
+      char const *source = data->pMessageIdName != nullptr ? data->pMessageIdName : "Unnamed";
+      std::uint32_t object_type = 0;
+      std::uint64_t object = 0;
+      if (data->objectCount > 0)
+      {
+        object_type = static_cast<std::uint32_t>(data->pObjects[0].objectType);
+        object = data->pObjects[0].objectHandle;
+      }
+
+      ValidationFilter &filter = *static_cast<ValidationFilter *>(user_data);
+      std::uint64_t occurrences = 0;
+      switch (filter.record(source, data->messageIdNumber, object_type, object, occurrences))
+      {
+        case ValidationFilter::Action::Suppress:
+          return VK_FALSE;
+        case ValidationFilter::Action::Summarize:
+          ValidationFilter::logRepeated(source, data->messageIdNumber, occurrences);
+          return VK_FALSE;
+        case ValidationFilter::Action::SummarizeUntracked:
+          ValidationFilter::logUntracked(occurrences);
+          return VK_FALSE;
+        case ValidationFilter::Action::Report:
+          break;
+      }
+
+      char const *type =
+        (types & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT) ? "Validation" :
+        (types & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) ? "Performance" : "General";
+      // Names set through setObjectName come back here, which is most of the point of debug_utils
+      char const *object_name =
+        data->objectCount > 0 && data->pObjects[0].pObjectName != nullptr ? data->pObjects[0].pObjectName : "";
+
+      if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+      {
+        Debug::Error("{} {} [{}]: {}", type, source, object_name, data->pMessage);
+      }
+      else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+      {
+        Debug::Warning("{} {} [{}]: {}", type, source, object_name, data->pMessage);
+      }
+      else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+      {
+        Debug::Info("{} {} [{}]: {}", type, source, object_name, data->pMessage);
+      }
+      else
+      {
+        Debug::Trace("{} {} [{}]: {}", type, source, object_name, data->pMessage);
+      }
+
+      return VK_FALSE;
+    }
+
+    static void setupDebugMessenger(Context::Graphics &context)
+    {
+      VkDebugUtilsMessengerCreateInfoEXT create_info = {};
+      create_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+      create_info.messageSeverity = context.debug_message_severity;
+      create_info.messageType = context.debug_message_types;
+      create_info.pfnUserCallback = debugUtilsCallback;
+      create_info.pUserData = &(context.validation_messages);
+
+      PFN_vkCreateDebugUtilsMessengerEXT create = context.instance_functions.vkCreateDebugUtilsMessengerEXT;
+      VkAllocationCallbacks const *allocator = context.host_allocator.callbacks();
+      VkDebugUtilsMessengerEXT &messenger = context.debug_messenger;
+      if (create == nullptr || create(context.instance, &create_info, allocator, &messenger) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to set up debug messenger");
+      }
+
+      Debug::Trace("Vulkan debug messenger set up");
+    }
+
+    static void setupDebugReportCallbacks(Context::Graphics &context)
+    {
+      VkDebugReportCallbackCreateInfoEXT create_info = {};
+      create_info.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
+      create_info.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
+      create_info.pfnCallback = debugPrintCallback;
+      create_info.pUserData = &(context.validation_messages);
+
+      PFN_vkCreateDebugReportCallbackEXT create = context.instance_functions.vkCreateDebugReportCallbackEXT;
+      VkAllocationCallbacks const *allocator = context.host_allocator.callbacks();
+      VkDebugReportCallbackEXT print_callback;
+      if (create == nullptr || create(context.instance, &create_info, allocator, &print_callback) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to set up debug callbacks");
+      }
+
+      context.debug_report_callbacks.push_back(print_callback);
+
+      Debug::Trace("Vulkan debug report callbacks set up");
+    }
+
+    void setupDebugCallbacks(Context::Graphics &context)
+    {
+      Debug::Trace("Setup Vulkan debug callbacks");
+
+      if (context.debug_utils_enabled)
+      {
+        setupDebugMessenger(context);
+      }
+      else
+      {
+        setupDebugReportCallbacks(context);
+      }
+    }
+
+    void destroyDebugCallbacks(Context::Graphics &context)
+    {
+      Debug::Trace("Destroy Vulkan debug callbacks");
+
+      if (context.debug_messenger != VK_NULL_HANDLE)
+      {
+        context.instance_functions.vkDestroyDebugUtilsMessengerEXT(
+          context.instance, context.debug_messenger, context.host_allocator.callbacks()
+        );
+        context.debug_messenger = VK_NULL_HANDLE;
+      }
+
+      for (VkDebugReportCallbackEXT &callback : context.debug_report_callbacks)
+      {
+        context.instance_functions.vkDestroyDebugReportCallbackEXT(
+          context.instance, callback, context.host_allocator.callbacks()
+        );
+      }
+
+      context.debug_report_callbacks.clear();
+
+      context.validation_messages.logSummary();
+    }
+  }
+}
+
+#endif
@@ -1,79 +1,209 @@
 #include "graphics_setup.h"
+#include "offscreen.h"
+#include "pipeline_cache.h"
+#include "debug_utils.h"
 #include "debug.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
 
 namespace Graphics
 {
-  void initGraphics(Context::Graphics const &context)
+  void addInitTasks(
+    Jobs::TaskGraph &graph,
+    Context::Graphics &context,
+    std::vector<Jobs::TaskGraph::Node> const &window_system)
+  {
+    #ifdef USING_VULKAN
+      using Node = Jobs::TaskGraph::Node;
+      Context::Graphics *graphics = &context;
+
+      // Loader and driver discovery happens on the first call into the loader, and the two enumerations
+      // after it are independent of each other
+      Node loader = graph.add("Vulkan loader", {}, [graphics]() { Vulkan::initLoader(*graphics); });
+      Node extensions = graph.add(
+        "Instance extensions", { loader }, [graphics]() { Vulkan::retrieveExtensionList(*graphics); }
+      );
+
+      // Window system extensions come from GLFW, which must be initialized first
+      std::vector<Node> instance_dependencies = window_system;
+      instance_dependencies.push_back(extensions);
+      #ifndef NDEBUG
+        Node layers = graph.add(
+          "Validation layers", { loader }, [graphics]() { Vulkan::verifyValidationLayers(*graphics); }
+        );
+        instance_dependencies.push_back(layers);
+      #endif
+
+      Node instance = graph.add(
+        "Instance", instance_dependencies, [graphics]() { Vulkan::createInstance(*graphics); }
+      );
+      std::vector<Node> device_dependencies;
+      #ifndef NDEBUG
+        // Before the device, so messages about its creation are caught
+        device_dependencies.push_back(graph.add(
+          "Debug callbacks", { instance }, [graphics]() { Vulkan::setupDebugCallbacks(*graphics); }
+        ));
+      #endif
+      device_dependencies.push_back(graph.add(
+        "Physical device", { instance }, [graphics]() { Vulkan::pickPhysicalDevice(*graphics); }
+      ));
+
+      Node device = graph.add(
+        "Logical device", device_dependencies, [graphics]() { Vulkan::createLogicalDevice(*graphics); }
+      );
+      #ifndef USING_GLFW
+        graph.add("Offscreen target", { device }, [graphics]() { Vulkan::createOffscreenTarget(*graphics); });
+      #else
+        static_cast<void>(device);
+      #endif
+    #endif
+  }
+
+  std::vector<char const *> getRequiredExtensions(Context::Graphics const &context)
   {
-    Debug::Log("TRACE", "Init graphics");
+    Debug::Trace("Get required extensions");
+
+    std::vector<char const *> extensions;
+
+    // Headless builds never present, so they need no surface extensions at all
+    #ifdef USING_GLFW
+      std::uint32_t glfw_extension_count = 0;
+      char const * const *glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+      extensions.assign(glfw_extensions, glfw_extensions + glfw_extension_count);
+    #endif
 
     #ifdef USING_VULKAN
-    namespace Vulkan
-    {
-      createInstance(context);
+      if (context.debug_utils_enabled)
+      {
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+      }
       #ifndef NDEBUG
-        setupDebugCallbacks(context);
+        else
+        {
+          extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+        }
       #endif
-      pickPhysicalDevice(context);
-    }
     #endif
 
-    Debug::Log("TRACE", "Graphics initialized");
+    Debug::Trace("Extension count: {}", extensions.size());
+
+    return extensions;
+  }
+
+  bool canRender([[maybe_unused]] Context::Graphics const &context)
+  {
+    #if defined(USING_VULKAN) && !defined(USING_GLFW)
+      return !context.offscreen.frames.empty();
+    #else
+      return false;
+    #endif
+  }
+
+  void update([[maybe_unused]] Context::Graphics &context)
+  {
+    #ifdef USING_VULKAN
+      // Streamed assets decoded since the last update join its uploads, which go out as one batch
+      context.asset_streamer.update();
+      context.transfer_engine.flush();
+    #endif
+  }
+
+  bool hasBackgroundWork([[maybe_unused]] Context::Graphics const &context)
+  {
+    #ifdef USING_VULKAN
+      Vulkan::AssetStreamer::Stats const streams = context.asset_streamer.stats();
+      Vulkan::TransferEngine::Stats const uploads = context.transfer_engine.stats();
+      return streams.queued + streams.decoding + streams.uploading > 0 ||
+        uploads.pending_uploads + uploads.queue_depth > 0;
+    #else
+      return false;
+    #endif
+  }
+
+  void renderFrame([[maybe_unused]] Context::Graphics &context)
+  {
+    #if defined(USING_VULKAN) && !defined(USING_GLFW)
+      Vulkan::renderOffscreenFrame(context);
+    #endif
   }
 
-  void cleanup(Context::Graphics const &context)
+  void cleanup(Context::Graphics &context)
   {
-    Debug::Log("TRACE", "Clean up graphics");
+    Debug::Trace("Clean up graphics");
 
     #ifdef USING_VULKAN
-    namespace Vulkan
-    {
-      cleanup(context);
-    }
+      Vulkan::cleanup(context);
+      context.job_pool.stop();
     #endif
 
-    Debug::Log("TRACE", "Graphics cleaned up");
+    Debug::Trace("Graphics cleaned up");
   }
 
   namespace Vulkan
   {
-    void createInstance(Context::Graphics const &context)
+    void initLoader(Context::Graphics &context)
     {
-      Debug::Log("TRACE", "Creating Vulkan instance");
+      PROFILE_ZONE("initLoader");
+      Debug::Trace("Loading Vulkan");
 
-      #ifndef NDEBUG
-        std::string error_message;
-        if (!checkValidationLayerSupport(context, error_message))
-        {
-          throw std::runtime_error("ERROR: " + error_message);
-        }
-        
-        Debug::Log("TRACE", "All requested Vulkan validation layers available");
-      #endif
+      loadGlobalFunctions(context.instance_functions);
+
+      // Vulkan 1.1 lets device selection read subgroup sizes and device UUIDs.
+      // A 1.0 loader has no vkEnumerateInstanceVersion and rejects any apiVersion but 1.0.
+      std::uint32_t loader_version = VK_API_VERSION_1_0;
+      if (context.instance_functions.vkEnumerateInstanceVersion != nullptr)
+      {
+        context.instance_functions.vkEnumerateInstanceVersion(&loader_version);
+      }
+      context.api_version = loader_version < VK_API_VERSION_1_1 ? loader_version : VK_API_VERSION_1_1;
+    }
+
+    void verifyValidationLayers(Context::Graphics const &context)
+    {
+      std::string error_message;
+      if (!checkValidationLayerSupport(context, error_message))
+      {
+        throw std::runtime_error("ERROR: " + error_message);
+      }
+
+      Debug::Trace("All requested Vulkan validation layers available");
+    }
+
+    void createInstance(Context::Graphics &context)
+    {
+      PROFILE_ZONE("createInstance");
+      Debug::Trace("Creating Vulkan instance");
 
       VkApplicationInfo app_info = {};
-      app_info.sType = VK_STRUCTURE_TYPE_APP_INFO;
+      app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
       app_info.pApplicationName = "Logical Devices and Queues";
       app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
       app_info.pEngineName = "No Engine";
       app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-      app_info.apiVersion = VK_API_VERSION_1_0;
-      Debug::Log("TRACE", "Vulkan app info set");
+      app_info.apiVersion = context.api_version;
+      Debug::Trace("Vulkan app info set");
 
-      VkInstanceCreateInfo instance_create_info = {};
-      instance_create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+      VkInstanceCreateInfo create_info = {};
+      create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
       // The create info is only needed to create the instance, so making a reference to something on the stack
       // is fine since the create info is not stored after being used to create the instance
-      instance_create_info.pApplicationInfo = &app_info; 
-      std::vector<char const *> extensions = std::move(getRequiredExtensions(context));
+      create_info.pApplicationInfo = &app_info; 
+      context.debug_utils_enabled = isExtensionAvailable(context, VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+      std::vector<char const *> extensions = getRequiredExtensions(context);
       std::uint32_t extension_count = static_cast<std::uint32_t>(extensions.size());
-      retrieveExtensionList(context);
       if (verifyExtensionList(context, extension_count, extensions.data()))
       {
-        Debug::Log("TRACE", "All window extensions are supported by Vulkan");
+        Debug::Trace("All window extensions are supported by Vulkan");
       }
       create_info.enabledExtensionCount = extension_count;
-      create_info.ppEnabledLayerNames = extensions.data();
+      create_info.ppEnabledExtensionNames = extensions.data();
       #ifndef NDEBUG
         create_info.enabledLayerCount = static_cast<std::uint32_t>(context.validation_layers.size());
         create_info.ppEnabledLayerNames = context.validation_layers.data();
@@ -81,9 +211,9 @@ namespace Graphics
         create_info.enabledLayerCount = 0;
       #endif
 
-      VkResult result = vkCreateInstance(
+      VkResult result = context.instance_functions.vkCreateInstance(
         &create_info, 
-        nullptr,  // Custom allocator callback
+        context.host_allocator.callbacks(),
         &(context.instance)
       );
 
@@ -92,42 +222,566 @@ namespace Graphics
         throw std::runtime_error("ERROR: Failed to create Vulkan instance");
       }
 
-      Debug::Log("TRACE", "Vulkan instance created");
+      loadInstanceFunctions(context.instance_functions, context.instance);
+
+      Debug::Trace("Vulkan instance created");
     }
 
     void retrieveExtensionList(Context::Graphics &context)
     {
-      Debug::Log("TRACE", "Retrieving Vulkan extension list");
+      Debug::Trace("Retrieving Vulkan extension list");
       std::uint32_t extension_count = 0;
-      vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+      InstanceDispatch const &vk = context.instance_functions;
+      vk.vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
 
       std::vector<VkExtensionProperties> &extensions = context.extensions;
       extensions.resize(extension_count);
-      vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions.data());
+      vk.vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions.data());
 
-      Debug::Log("TRACE", "Available extensions:");
+      Debug::Trace("Available extensions:");
       for (VkExtensionProperties const &extension : extensions)
       {
-        Debug::Log(std::string("  ") + extension.extensionName);
+        Debug::Trace("  {}", extension.extensionName);
       }
       if (extensions.size() == 0)
       {
-        Debug::Log();
+        Debug::Trace("  None");
       }
     }
 
-    void cleanup(Context::Graphics const &context)
+    bool isExtensionAvailable(Context::Graphics const &context, char const *extension_name)
     {
-      Debug::Log("TRACE", "Clean up Vulkan");
+      for (VkExtensionProperties const &extension : context.extensions)
+      {
+        if (std::strcmp(extension.extensionName, extension_name) == 0)
+        {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    bool verifyExtensionList(
+      Context::Graphics const &context,
+      std::uint32_t extension_count,
+      char const * const * const extensions)
+    {
+      bool all_extensions_supported = true;
+
+      std::vector<VkExtensionProperties> const &supported_extensions = context.extensions;
+      size_t supported_extension_count = supported_extensions.size();
 
+      std::set<size_t> seen_supported_extensions;
+
+      for (std::uint32_t i=0; i<extension_count; ++i)
+      {
+        bool found = false;
+
+        for (size_t j=0; j<supported_extension_count; ++j)
+        {
+          if (seen_supported_extensions.find(j) != seen_supported_extensions.end())
+          {
+            continue;
+          }
+
+          if (std::strcmp(extensions[i], supported_extensions[j].extensionName) == 0)
+          {
+            found = true;
+            seen_supported_extensions.insert(j);
+            break;
+          }
+        }
+
+        if (!found)
+        {
+          Debug::Warning("Extension '{}' not supported!", extensions[i]);
+          all_extensions_supported = false;
+        }
+      }
+
+      return all_extensions_supported;
+    }
+
+    bool checkValidationLayerSupport(
+      [[maybe_unused]] Context::Graphics const &context,
+      [[maybe_unused]] std::string &message)
+    {
       #ifndef NDEBUG
-        destroyDebugCallbacks(context);
+        InstanceDispatch const &vk = context.instance_functions;
+        std::uint32_t available_layer_count;
+        vk.vkEnumerateInstanceLayerProperties(&available_layer_count, nullptr);
+
+        std::vector<VkLayerProperties> available_layers(available_layer_count);
+        vk.vkEnumerateInstanceLayerProperties(&available_layer_count, available_layers.data());
+
+        std::set<size_t> seen_available_layers;
+        for (char const *layer_name : context.validation_layers)
+        {
+          bool found = false;
+          for (size_t j=0; j<available_layer_count; ++j)
+          {
+            if (seen_available_layers.find(j) != seen_available_layers.end())
+            {
+              continue;
+            }
+
+            if (std::strcmp(layer_name, available_layers[j].layerName) == 0)
+            {
+              found = true;
+              seen_available_layers.insert(j);
+              break;
+            }
+          }
+
+          if (!found)
+          {
+            message = std::string(layer_name) + " validation layer requested, but not available";
+            return false;
+          }
+        }
       #endif
 
-      // Destroy Vulkan instance after all other resources are cleaned up
-      vkDestroyInstance(context.instance);
+      return true;
+    }
+
+    void pickPhysicalDevice(Context::Graphics &context)
+    {
+      PROFILE_ZONE("pickPhysicalDevice");
+      Debug::Trace("Picking a physical device for Vulkan");
+
+      InstanceDispatch const &vk = context.instance_functions;
+      std::uint32_t device_count = 0;
+      vk.vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+
+      if (device_count == 0)
+      {
+        throw std::runtime_error("ERROR: Failed to find GPU with Vulkan support");
+      }
+
+      std::vector<VkPhysicalDevice> devices(device_count);
+      vk.vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+      std::vector<PhysicalDeviceInfo> candidates(device_count);
+      for (std::uint32_t i=0; i<device_count; ++i)
+      {
+        queryPhysicalDeviceIdentity(vk, context.api_version, devices[i], candidates[i]);
+      }
+
+      DefaultScoringPolicy const default_policy;
+      DeviceScoringPolicy const &policy = context.device_scoring_policy
+        ? *context.device_scoring_policy
+        : default_policy;
+      std::string const signature = policy.signature();
+
+      DeviceScore score;
+      int selected = -1;
+      if (!context.device_cache_path.empty())
+      {
+        selected = loadDeviceSelection(context.device_cache_path, signature, candidates, score);
+      }
+
+      bool const from_cache = selected >= 0;
+      if (from_cache)
+      {
+        Debug::Trace("Using cached choice of device {}", candidates[selected].properties.deviceName);
+      }
+      else
+      {
+        // Physical device queries need no external synchronization, so every device is queried and scored
+        // on its own thread
+        VkInstance const instance = context.instance;
+        std::uint32_t const api_version = context.api_version;
+        std::vector<std::future<DeviceScore>> scores;
+        for (PhysicalDeviceInfo &candidate : candidates)
+        {
+          scores.push_back(std::async(std::launch::async, [&vk, &policy, &candidate, instance, api_version]()
+          {
+            queryPhysicalDeviceDetails(vk, instance, api_version, candidate);
+            return policy.score(candidate);
+          }));
+        }
+
+        for (size_t i=0; i<scores.size(); ++i)
+        {
+          DeviceScore candidate_score = scores[i].get();
+          Debug::Trace(
+            "Device {} {}: {} (type {}, memory {}, queues {}, subgroup {}, features {}, limits {})",
+            candidates[i].properties.deviceName,
+            candidate_score.suitable ? "scored" : "is unsuitable, would have scored",
+            candidate_score.total(),
+            candidate_score.device_type,
+            candidate_score.memory,
+            candidate_score.queues,
+            candidate_score.subgroup,
+            candidate_score.features,
+            candidate_score.limits
+          );
+
+          // Ties go to the device enumerated first
+          if (candidate_score.suitable && (selected < 0 || candidate_score.total() > score.total()))
+          {
+            selected = static_cast<int>(i);
+            score = candidate_score;
+          }
+        }
+
+        if (selected < 0)
+        {
+          throw std::runtime_error("ERROR: Failed to find a suitable GPU for Vulkan");
+        }
+
+        if (!context.device_cache_path.empty())
+        {
+          saveDeviceSelection(context.device_cache_path, signature, candidates, selected, score);
+        }
+      }
+
+      PhysicalDeviceInfo &chosen = candidates[selected];
+      if (from_cache)
+      {
+        // Only the chosen device's identity was queried, and device creation needs this much more of it
+        chosen.descriptor_indexing = queryDescriptorIndexing(
+          vk, context.api_version, chosen.device, chosen.descriptor_indexing_limits
+        );
+      }
+
+      context.physical_device = chosen.device;
+      context.physical_device_properties = chosen.properties;
+      context.queue_families = findQueueFamilies(vk, context.instance, context.physical_device);
+      context.descriptor_indexing_enabled = chosen.descriptor_indexing;
+      context.descriptor_indexing_limits = chosen.descriptor_indexing_limits;
+
+      Debug::Trace(
+        "Physical device found: {} with a score of {}", candidates[selected].properties.deviceName, score.total()
+      );
+    }
+
+    // VK_KHR_timeline_semaphore is core in Vulkan 1.2, but the instance asks for 1.1 at most, so it's enabled as
+    // an extension. Its feature bit is only queryable through vkGetPhysicalDeviceFeatures2.
+    static bool supportsTimelineSemaphores(Context::Graphics const &context)
+    {
+      InstanceDispatch const &vk = context.instance_functions;
+      if (vk.vkGetPhysicalDeviceFeatures2 == nullptr
+        || context.api_version < VK_API_VERSION_1_1
+        || context.physical_device_properties.apiVersion < VK_API_VERSION_1_1)
+      {
+        return false;
+      }
+
+      std::uint32_t extension_count = 0;
+      vk.vkEnumerateDeviceExtensionProperties(context.physical_device, nullptr, &extension_count, nullptr);
+      std::vector<VkExtensionProperties> extensions(extension_count);
+      vk.vkEnumerateDeviceExtensionProperties(context.physical_device, nullptr, &extension_count, extensions.data());
+
+      bool available = false;
+      for (VkExtensionProperties const &extension : extensions)
+      {
+        available = available || std::strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+      }
+      if (!available)
+      {
+        return false;
+      }
+
+      VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {};
+      timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+      VkPhysicalDeviceFeatures2 features = {};
+      features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+      features.pNext = &timeline_features;
+      vk.vkGetPhysicalDeviceFeatures2(context.physical_device, &features);
+      return timeline_features.timelineSemaphore == VK_TRUE;
+    }
+
+    // The index-th queue of a family
+    struct QueueSlot
+    {
+      std::uint32_t family;
+      std::uint32_t index;
+    };
+
+    // Hands out the queues of a family one role at a time. Once they run out, later roles share the last one.
+    static QueueSlot claimQueue(
+      std::map<std::uint32_t, std::vector<float>> &family_priorities,
+      QueueFamily const &family,
+      float priority)
+    {
+      std::uint32_t family_index = static_cast<std::uint32_t>(family.index);
+      std::vector<float> &priorities = family_priorities[family_index];
+      if (priorities.size() < family.queue_count)
+      {
+        priorities.push_back(priority);
+      }
+      else
+      {
+        priorities.back() = std::max(priorities.back(), priority);
+      }
+
+      return QueueSlot{ family_index, static_cast<std::uint32_t>(priorities.size() - 1) };
+    }
+
+    // Roles that ended up on the same VkQueue share its SubmitQueue, which is named after the first of them
+    static SubmitQueue *getSubmitQueue(
+      Context::Graphics &context,
+      VkQueue queue,
+      std::uint32_t family,
+      char const *name)
+    {
+      for (std::unique_ptr<SubmitQueue> const &submit_queue : context.submit_queues)
+      {
+        if (submit_queue->handle() == queue)
+        {
+          return submit_queue.get();
+        }
+      }
+
+      context.submit_queues.push_back(std::make_unique<SubmitQueue>());
+      SubmitQueue *submit_queue = context.submit_queues.back().get();
+      submit_queue->init(
+        context.instance_functions, context.device_functions, context.device, context.sync_pool, queue, family, name
+      );
+      setObjectName(context, VK_OBJECT_TYPE_QUEUE, queue, name);
+      return submit_queue;
+    }
+
+    void createLogicalDevice(Context::Graphics &context)
+    {
+      PROFILE_ZONE("createLogicalDevice");
+      Debug::Trace("Creating Vulkan logical device");
+
+      QueueFamilyIndices const &families = context.queue_families;
+      Context::Graphics::QueuePriorities const &priorities = context.queue_priorities;
+
+      // Roles without a dedicated family fall back to the nearest family that can do their work
+      QueueFamily const &compute_family = families.compute.isValid() ? families.compute : families.graphics;
+      QueueFamily const &transfer_family = families.transfer.isValid() ? families.transfer : compute_family;
+
+      std::map<std::uint32_t, std::vector<float>> family_priorities;
+      QueueSlot graphics_slot = claimQueue(family_priorities, families.graphics, priorities.graphics);
+      QueueSlot compute_slot = claimQueue(family_priorities, compute_family, priorities.compute);
+      QueueSlot transfer_slot = claimQueue(family_priorities, transfer_family, priorities.transfer);
+      #ifdef USING_GLFW
+        // Presenting from the graphics queue saves a semaphore hop per frame
+        QueueSlot present_slot = families.present.index == families.graphics.index
+          ? graphics_slot
+          : claimQueue(family_priorities, families.present, priorities.graphics);
+      #endif
+
+      std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+      for (std::pair<std::uint32_t const, std::vector<float>> const &family : family_priorities)
+      {
+        VkDeviceQueueCreateInfo queue_create_info = {};
+        queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queue_create_info.queueFamilyIndex = family.first;
+        queue_create_info.queueCount = static_cast<std::uint32_t>(family.second.size());
+        queue_create_info.pQueuePriorities = family.second.data();
+        queue_create_infos.push_back(queue_create_info);
+      }
+
+      VkPhysicalDeviceFeatures device_features = {};
+      std::vector<char const *> device_extensions;
+
+      VkDeviceCreateInfo create_info = {};
+      create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+      create_info.pQueueCreateInfos = queue_create_infos.data();
+      create_info.queueCreateInfoCount = static_cast<std::uint32_t>(queue_create_infos.size());
+      create_info.pEnabledFeatures = &device_features;
+
+      // Extension features are chained onto the create info as they are enabled
+      void *features_chain = nullptr;
+
+      VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {};
+      timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+      context.timeline_semaphores_enabled = supportsTimelineSemaphores(context);
+      if (context.timeline_semaphores_enabled)
+      {
+        device_extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        timeline_features.timelineSemaphore = VK_TRUE;
+        timeline_features.pNext = features_chain;
+        features_chain = &timeline_features;
+      }
+
+      // The features pickPhysicalDevice found with queryDescriptorIndexing. VK_KHR_maintenance3, which the
+      // extension needs, is core in the Vulkan 1.1 it takes to query them.
+      VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {};
+      indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+      if (context.descriptor_indexing_enabled)
+      {
+        device_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        indexing_features.runtimeDescriptorArray = VK_TRUE;
+        indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+        indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexing_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        indexing_features.pNext = features_chain;
+        features_chain = &indexing_features;
+      }
+      create_info.pNext = features_chain;
+      create_info.enabledExtensionCount = static_cast<std::uint32_t>(device_extensions.size());
+      create_info.ppEnabledExtensionNames = device_extensions.data();
+      // Device layers are deprecated, but older implementations still expect them to match the instance layers
+      #ifndef NDEBUG
+        create_info.enabledLayerCount = static_cast<std::uint32_t>(context.validation_layers.size());
+        create_info.ppEnabledLayerNames = context.validation_layers.data();
+      #else
+        create_info.enabledLayerCount = 0;
+      #endif
+
+      VkResult result = context.instance_functions.vkCreateDevice(
+        context.physical_device, &create_info, context.host_allocator.callbacks(), &(context.device)
+      );
+
+      if (result != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create Vulkan logical device");
+      }
+
+      loadDeviceFunctions(context.device_functions, context.instance_functions, context.device);
+
+      DeviceDispatch const &vk = context.device_functions;
+      setObjectName(context, VK_OBJECT_TYPE_DEVICE, context.device, "Logical device");
+
+      vk.vkGetDeviceQueue(context.device, graphics_slot.family, graphics_slot.index, &(context.graphics_queue));
+      vk.vkGetDeviceQueue(context.device, compute_slot.family, compute_slot.index, &(context.compute_queue));
+      vk.vkGetDeviceQueue(context.device, transfer_slot.family, transfer_slot.index, &(context.transfer_queue));
+      #ifdef USING_GLFW
+        vk.vkGetDeviceQueue(context.device, present_slot.family, present_slot.index, &(context.present_queue));
+      #endif
+
+      context.sync_pool.init(vk, context.device, context.host_allocator.callbacks());
+      context.memory_allocator.init(
+        context.instance_functions, vk, context.physical_device, context.device, context.host_allocator.callbacks()
+      );
+      createPipelineCache(context);
+      context.pipeline_library.init(
+        vk, context.device, context.pipeline_cache, context.host_allocator.callbacks(), context.job_pool
+      );
+      context.graphics_submit = getSubmitQueue(
+        context, context.graphics_queue, graphics_slot.family, "Graphics queue"
+      );
+      context.command_recorder.init(
+        vk, context.device, context.host_allocator.callbacks(), graphics_slot.family,
+        context.frames_in_flight, context.job_pool.workerCount() + 1
+      );
+      context.descriptor_layouts.init(vk, context.device, context.host_allocator.callbacks());
+      context.descriptor_allocator.init(
+        vk, context.device, context.host_allocator.callbacks(),
+        context.frames_in_flight, context.job_pool.workerCount() + 1
+      );
+      if (context.descriptor_indexing_enabled)
+      {
+        context.bindless_table.init(
+          vk, context.device, context.host_allocator.callbacks(), context.descriptor_layouts,
+          context.descriptor_indexing_limits, context.frames_in_flight
+        );
+      }
+      context.gpu_profiler.init(
+        vk, context.device, context.host_allocator.callbacks(),
+        context.physical_device_properties, context.queue_families.graphics, "graphics",
+        context.frames_in_flight + 1
+      );
+      context.compute_submit = getSubmitQueue(
+        context, context.compute_queue, compute_slot.family, "Compute queue"
+      );
+      context.transfer_submit = getSubmitQueue(
+        context, context.transfer_queue, transfer_slot.family, "Transfer queue"
+      );
+      context.transfer_engine.init(
+        vk, context.device, context.host_allocator.callbacks(), context.memory_allocator, *context.transfer_submit,
+        context.physical_device_properties.limits, graphics_slot.family, context.timeline_semaphores_enabled
+      );
+      context.asset_streamer.init(
+        vk, context.device, context.host_allocator.callbacks(), context.memory_allocator, context.transfer_engine,
+        context.job_pool
+      );
+      #ifdef USING_GLFW
+        if (context.present_queue != context.graphics_queue)
+        {
+          setObjectName(context, VK_OBJECT_TYPE_QUEUE, context.present_queue, "Present queue");
+        }
+      #endif
+
+      Debug::Trace(
+        "Created {} queues: graphics {}.{}, compute {}.{}, transfer {}.{}",
+        context.submit_queues.size(),
+        graphics_slot.family, graphics_slot.index,
+        compute_slot.family, compute_slot.index,
+        transfer_slot.family, transfer_slot.index
+      );
+      Debug::Trace("Vulkan logical device created");
+    }
+
+    void cleanup(Context::Graphics &context)
+    {
+      PROFILE_ZONE("Vulkan cleanup");
+      Debug::Trace("Clean up Vulkan");
+
+      // After a failed init only some of this was made, and without a device none of it was
+      if (context.device != VK_NULL_HANDLE)
+      {
+        #ifndef USING_GLFW
+          destroyOffscreenTarget(context);
+        #endif
+
+        // Before the transfer engine, which its last uploads go through
+        context.asset_streamer.logStats();
+        context.asset_streamer.destroy();
+        // Before the submit queues, since it waits on the transfer queue for its last batches
+        context.transfer_engine.wait(context.transfer_engine.flush());
+        context.transfer_engine.logStats();
+        context.transfer_engine.destroy();
+
+        for (std::unique_ptr<SubmitQueue> const &submit_queue : context.submit_queues)
+        {
+          submit_queue->destroy();
+        }
+        context.submit_queues.clear();
+
+        context.command_recorder.destroy();
+        context.bindless_table.destroy();
+        context.descriptor_allocator.logStats();
+        context.descriptor_allocator.destroy();
+
+        // The queues are idle, so every frame's timestamps are in
+        context.gpu_profiler.collectAll();
+        context.gpu_profiler.logTimings();
+        context.gpu_profiler.destroy();
+        context.graphics_submit = nullptr;
+        context.compute_submit = nullptr;
+        context.transfer_submit = nullptr;
+        context.sync_pool.destroy();
+
+        // Before saving, so pipelines still being built make it into the cache
+        context.pipeline_library.destroy();
+        // After the pipelines, whose creation jobs may still be using layouts from it
+        context.descriptor_layouts.destroy();
+        savePipelineCache(context);
+        destroyPipelineCache(context);
+
+        context.memory_allocator.logStats();
+        context.memory_allocator.destroy();
+
+        context.device_functions.vkDestroyDevice(context.device, context.host_allocator.callbacks());
+        context.device = VK_NULL_HANDLE;
+      }
+
+      if (context.instance != VK_NULL_HANDLE)
+      {
+        #ifndef NDEBUG
+          destroyDebugCallbacks(context);
+        #endif
+
+        // Destroy Vulkan instance after all other resources are cleaned up
+        context.instance_functions.vkDestroyInstance(context.instance, context.host_allocator.callbacks());
+        context.instance = VK_NULL_HANDLE;
+      }
+
+      // Everything the implementation allocated should be gone with the instance
+      context.host_allocator.logStats();
+      context.host_allocator.reportLeaks();
   
-      Debug::Log("TRACE", "Vulkan cleaned up");
+      Debug::Trace("Vulkan cleaned up");
     }
   }
 }
@@ -2,21 +2,45 @@
 #define GRAPHICS_SETUP_H
 
 #include "context.h"
+#include "task_graph.h"
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace Graphics
 {
 
-void initGraphics(Context::Graphics const &context);
+// Adds the graphics init steps to graph. window_system are the tasks that must run before GLFW is usable.
+void addInitTasks(
+  Jobs::TaskGraph &graph,
+  Context::Graphics &context,
+  std::vector<Jobs::TaskGraph::Node> const &window_system
+);
 std::vector<char const *> getRequiredExtensions(Context::Graphics const &context);
-void cleanup(Context::Graphics const &context);
+// False while there is nothing to render into, which for now is always the case with a window since
+// there is no swap chain yet
+bool canRender(Context::Graphics const &context);
+// Moves asset streaming and uploads along. Called once per run loop iteration, whether a frame is rendered or
+// not.
+void update(Context::Graphics &context);
+// True while streams or uploads are still under way, so update needs calling again soon
+bool hasBackgroundWork(Context::Graphics const &context);
+void renderFrame(Context::Graphics &context);
+void cleanup(Context::Graphics &context);
 
 #ifdef USING_VULKAN
   namespace Vulkan
   {
-    void createInstance(Context::Graphics const &context);
+    // Loads the global functions and settles on an API version. The first call into the loader is where it
+    // finds the drivers, which makes this slower than it looks.
+    void initLoader(Context::Graphics &context);
+    // Throws unless every layer in context.validation_layers is available
+    void verifyValidationLayers(Context::Graphics const &context);
+    // Needs initLoader, retrieveExtensionList and, in debug builds, verifyValidationLayers to have run
+    void createInstance(Context::Graphics &context);
     void retrieveExtensionList(Context::Graphics &context);
+    bool isExtensionAvailable(Context::Graphics const &context, char const *extension_name);
     bool verifyExtensionList(
       Context::Graphics const &context,
       std::uint32_t extension_count,
@@ -24,12 +48,12 @@ void cleanup(Context::Graphics const &context);
     );
     bool checkValidationLayerSupport(Context::Graphics const &context, std::string &message);
     void pickPhysicalDevice(Context::Graphics &context);
-    void ratePhysicalDeviceSuitability(VkPhysicalDevice device);
+    void createLogicalDevice(Context::Graphics &context);
     #ifndef NDEBUG
-      void setupDebugCallbacks(Context::Graphics const &context);
-      void destroyDebugCallbacks(Context::Graphics const &context);
+      void setupDebugCallbacks(Context::Graphics &context);
+      void destroyDebugCallbacks(Context::Graphics &context);
     #endif
-    void cleanup(Context::Graphics const &context);
+    void cleanup(Context::Graphics &context);
   }
 #endif
 
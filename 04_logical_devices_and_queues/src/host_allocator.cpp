@@ -0,0 +1,347 @@
+#include "host_allocator.h"
+#include "debug.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef USING_VULKAN
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    // Sits right in front of every block handed out, so free and reallocate know where the block came from
+    struct HostAllocator::Header
+    {
+      std::uint64_t size;
+      std::uint32_t offset;     // From the start of the malloc'd memory, malloc path only
+      std::uint16_t size_class; // NO_SIZE_CLASS for malloc'd blocks
+      std::uint8_t scope;
+      std::uint8_t padding;
+    };
+
+    static std::uint16_t constexpr NO_SIZE_CLASS = 0xffff;
+    static size_t constexpr HEADER_SIZE = 16;
+
+    static char const * const SCOPE_NAMES[HostAllocator::SCOPE_COUNT] = {
+      "command", "object", "cache", "device", "instance"
+    };
+
+    static size_t scopeIndex(VkSystemAllocationScope scope)
+    {
+      size_t index = static_cast<size_t>(scope);
+      return index < HostAllocator::SCOPE_COUNT ? index : HostAllocator::SCOPE_COUNT - 1;
+    }
+
+    static size_t sizeClassFor(size_t size)
+    {
+      size_t size_class = 0;
+      while ((HostAllocator::MIN_CLASS_SIZE << size_class) < size)
+      {
+        ++size_class;
+      }
+      return size_class;
+    }
+
+    static size_t classSize(size_t size_class)
+    {
+      return HostAllocator::MIN_CLASS_SIZE << size_class;
+    }
+
+    HostAllocator::HostAllocator()
+    {
+      // Pooled blocks are a header plus a power of two of at least 16, so payloads stay POOL_ALIGNMENT aligned
+      static_assert(sizeof(Header) == HEADER_SIZE, "Header must stay 16 bytes");
+      static_assert(HEADER_SIZE % POOL_ALIGNMENT == 0, "Header must keep payloads aligned");
+      static_assert(MIN_CLASS_SIZE << (SIZE_CLASS_COUNT - 1) == MAX_CLASS_SIZE, "Size classes must reach the max");
+
+      allocation_callbacks = {};
+      allocation_callbacks.pUserData = this;
+      allocation_callbacks.pfnAllocation = &HostAllocator::allocate;
+      allocation_callbacks.pfnReallocation = &HostAllocator::reallocate;
+      allocation_callbacks.pfnFree = &HostAllocator::free;
+      allocation_callbacks.pfnInternalAllocation = &HostAllocator::internalAllocation;
+      allocation_callbacks.pfnInternalFree = &HostAllocator::internalFree;
+
+      for (Counters &scope_counters : counters)
+      {
+        scope_counters.live_bytes.store(0, std::memory_order_relaxed);
+        scope_counters.peak_bytes.store(0, std::memory_order_relaxed);
+        scope_counters.live_allocations.store(0, std::memory_order_relaxed);
+        scope_counters.allocation_count.store(0, std::memory_order_relaxed);
+        scope_counters.pooled_count.store(0, std::memory_order_relaxed);
+        scope_counters.internal_bytes.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    HostAllocator::~HostAllocator()
+    {
+      for (SizeClass &size_class : size_classes)
+      {
+        for (void *chunk : size_class.chunks)
+        {
+          std::free(chunk);
+        }
+      }
+    }
+
+    HostAllocator::ScopeStats HostAllocator::stats(VkSystemAllocationScope scope) const
+    {
+      Counters const &scope_counters = counters[scopeIndex(scope)];
+
+      ScopeStats result;
+      result.live_bytes = scope_counters.live_bytes.load(std::memory_order_relaxed);
+      result.peak_bytes = scope_counters.peak_bytes.load(std::memory_order_relaxed);
+      result.live_allocations = scope_counters.live_allocations.load(std::memory_order_relaxed);
+      result.allocation_count = scope_counters.allocation_count.load(std::memory_order_relaxed);
+      result.pooled_count = scope_counters.pooled_count.load(std::memory_order_relaxed);
+      result.internal_bytes = scope_counters.internal_bytes.load(std::memory_order_relaxed);
+      return result;
+    }
+
+    std::uint64_t HostAllocator::pooledBytes() const
+    {
+      std::uint64_t bytes = 0;
+      for (SizeClass const &size_class : size_classes)
+      {
+        std::lock_guard<std::mutex> lock(size_class.mutex);
+        bytes += size_class.chunks.size() * CHUNK_SIZE;
+      }
+      return bytes;
+    }
+
+    void HostAllocator::logStats() const
+    {
+      for (size_t i=0; i<SCOPE_COUNT; ++i)
+      {
+        ScopeStats scope_stats = stats(static_cast<VkSystemAllocationScope>(i));
+        Debug::Info(
+          "Host memory, {} scope: {} allocations ({} pooled), peak {} bytes, {} bytes in {} allocations live, "
+          "{} bytes internal",
+          SCOPE_NAMES[i],
+          scope_stats.allocation_count,
+          scope_stats.pooled_count,
+          scope_stats.peak_bytes,
+          scope_stats.live_bytes,
+          scope_stats.live_allocations,
+          scope_stats.internal_bytes
+        );
+      }
+      Debug::Info("Host memory pools reserve {} bytes", pooledBytes());
+    }
+
+    bool HostAllocator::reportLeaks() const
+    {
+      bool leaked = false;
+      for (size_t i=0; i<SCOPE_COUNT; ++i)
+      {
+        ScopeStats scope_stats = stats(static_cast<VkSystemAllocationScope>(i));
+        if (scope_stats.live_allocations > 0)
+        {
+          Debug::Warning(
+            "Host memory, {} scope: {} bytes in {} allocations were never freed",
+            SCOPE_NAMES[i],
+            scope_stats.live_bytes,
+            scope_stats.live_allocations
+          );
+          leaked = true;
+        }
+      }
+      return leaked;
+    }
+
+    void *VKAPI_PTR HostAllocator::allocate(
+      void *user_data,
+      size_t size,
+      size_t alignment,
+      VkSystemAllocationScope scope)
+    {
+      return static_cast<HostAllocator *>(user_data)->allocateBlock(size, alignment, scope);
+    }
+
+    void *VKAPI_PTR HostAllocator::reallocate(
+      void *user_data,
+      void *original,
+      size_t size,
+      size_t alignment,
+      VkSystemAllocationScope scope)
+    {
+      HostAllocator *allocator = static_cast<HostAllocator *>(user_data);
+
+      if (original == nullptr)
+      {
+        return allocator->allocateBlock(size, alignment, scope);
+      }
+      if (size == 0)
+      {
+        allocator->freeBlock(original);
+        return nullptr;
+      }
+
+      // The spec lets the original allocation's scope differ from the new one, so this always moves
+      void *memory = allocator->allocateBlock(size, alignment, scope);
+      if (memory == nullptr)
+      {
+        return nullptr;
+      }
+
+      Header const *header = reinterpret_cast<Header const *>(static_cast<char *>(original) - HEADER_SIZE);
+      std::memcpy(memory, original, header->size < size ? static_cast<size_t>(header->size) : size);
+      allocator->freeBlock(original);
+      return memory;
+    }
+
+    void VKAPI_PTR HostAllocator::free(void *user_data, void *memory)
+    {
+      if (memory != nullptr)
+      {
+        static_cast<HostAllocator *>(user_data)->freeBlock(memory);
+      }
+    }
+
+    void VKAPI_PTR HostAllocator::internalAllocation(
+      void *user_data,
+      size_t size,
+      VkInternalAllocationType,
+      VkSystemAllocationScope scope)
+    {
+      HostAllocator *allocator = static_cast<HostAllocator *>(user_data);
+      allocator->counters[scopeIndex(scope)].internal_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void VKAPI_PTR HostAllocator::internalFree(
+      void *user_data,
+      size_t size,
+      VkInternalAllocationType,
+      VkSystemAllocationScope scope)
+    {
+      HostAllocator *allocator = static_cast<HostAllocator *>(user_data);
+      allocator->counters[scopeIndex(scope)].internal_bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    void *HostAllocator::allocateBlock(size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+      if (size == 0)
+      {
+        return nullptr;
+      }
+
+      bool short_lived = scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND || scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT;
+      if (short_lived && size <= MAX_CLASS_SIZE && alignment <= POOL_ALIGNMENT)
+      {
+        size_t size_class = sizeClassFor(size);
+        void *block = popPooled(size_class);
+        if (block != nullptr)
+        {
+          Header *header = static_cast<Header *>(block);
+          header->size = size;
+          header->offset = 0;
+          header->size_class = static_cast<std::uint16_t>(size_class);
+          header->scope = static_cast<std::uint8_t>(scopeIndex(scope));
+          countAllocation(scope, size, true);
+          return static_cast<char *>(block) + HEADER_SIZE;
+        }
+      }
+
+      // Room for the header in front of the payload and for aligning the payload
+      size_t payload_alignment = alignment > POOL_ALIGNMENT ? alignment : POOL_ALIGNMENT;
+      char *raw = static_cast<char *>(std::malloc(size + HEADER_SIZE + payload_alignment));
+      if (raw == nullptr)
+      {
+        return nullptr;
+      }
+
+      std::uintptr_t payload_address = reinterpret_cast<std::uintptr_t>(raw) + HEADER_SIZE;
+      payload_address = (payload_address + payload_alignment - 1) & ~(std::uintptr_t(payload_alignment) - 1);
+      char *payload = reinterpret_cast<char *>(payload_address);
+
+      Header *header = reinterpret_cast<Header *>(payload - HEADER_SIZE);
+      header->size = size;
+      header->offset = static_cast<std::uint32_t>(payload - raw);
+      header->size_class = NO_SIZE_CLASS;
+      header->scope = static_cast<std::uint8_t>(scopeIndex(scope));
+      countAllocation(scope, size, false);
+      return payload;
+    }
+
+    void HostAllocator::freeBlock(void *memory)
+    {
+      char *payload = static_cast<char *>(memory);
+      Header *header = reinterpret_cast<Header *>(payload - HEADER_SIZE);
+      countFree(static_cast<VkSystemAllocationScope>(header->scope), static_cast<size_t>(header->size));
+
+      if (header->size_class != NO_SIZE_CLASS)
+      {
+        pushPooled(header->size_class, header);
+      }
+      else
+      {
+        std::free(payload - header->offset);
+      }
+    }
+
+    void *HostAllocator::popPooled(size_t size_class)
+    {
+      SizeClass &pool = size_classes[size_class];
+      std::lock_guard<std::mutex> lock(pool.mutex);
+
+      if (pool.free_list == nullptr)
+      {
+        // Carve a new chunk into blocks of header plus class size
+        char *chunk = static_cast<char *>(std::malloc(CHUNK_SIZE));
+        if (chunk == nullptr)
+        {
+          return nullptr;
+        }
+        pool.chunks.push_back(chunk);
+
+        size_t block_size = HEADER_SIZE + classSize(size_class);
+        for (size_t offset = 0; offset + block_size <= CHUNK_SIZE; offset += block_size)
+        {
+          void *block = chunk + offset;
+          *static_cast<void **>(block) = pool.free_list;
+          pool.free_list = block;
+        }
+      }
+
+      void *block = pool.free_list;
+      pool.free_list = *static_cast<void **>(block);
+      return block;
+    }
+
+    void HostAllocator::pushPooled(size_t size_class, void *block)
+    {
+      SizeClass &pool = size_classes[size_class];
+      std::lock_guard<std::mutex> lock(pool.mutex);
+
+      *static_cast<void **>(block) = pool.free_list;
+      pool.free_list = block;
+    }
+
+    void HostAllocator::countAllocation(VkSystemAllocationScope scope, size_t size, bool pooled)
+    {
+      Counters &scope_counters = counters[scopeIndex(scope)];
+      scope_counters.allocation_count.fetch_add(1, std::memory_order_relaxed);
+      scope_counters.live_allocations.fetch_add(1, std::memory_order_relaxed);
+      if (pooled)
+      {
+        scope_counters.pooled_count.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      std::uint64_t live = scope_counters.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+      std::uint64_t peak = scope_counters.peak_bytes.load(std::memory_order_relaxed);
+      while (live > peak && !scope_counters.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+      {
+      }
+    }
+
+    void HostAllocator::countFree(VkSystemAllocationScope scope, size_t size)
+    {
+      Counters &scope_counters = counters[scopeIndex(scope)];
+      scope_counters.live_allocations.fetch_sub(1, std::memory_order_relaxed);
+      scope_counters.live_bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef HOST_ALLOCATOR_H
+#define HOST_ALLOCATOR_H
+
+#include "init.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Host memory handed to the Vulkan implementation through VkAllocationCallbacks.
+    // Short lived COMMAND and OBJECT scope allocations of up to MAX_CLASS_SIZE bytes come from size classed
+    // free lists carved out of CHUNK_SIZE chunks, so per call churn in the driver doesn't reach malloc.
+    // Everything else is a plain aligned malloc. Both paths are counted per scope, which makes leaks show up
+    // as live bytes left over once the instance is destroyed.
+    class HostAllocator
+    {
+    public:
+      static size_t constexpr SCOPE_COUNT = 5;
+      static size_t constexpr MIN_CLASS_SIZE = 16;
+      static size_t constexpr MAX_CLASS_SIZE = 4096;
+      static size_t constexpr SIZE_CLASS_COUNT = 9; // Powers of two from MIN_CLASS_SIZE to MAX_CLASS_SIZE
+      static size_t constexpr CHUNK_SIZE = 64 * 1024;
+      // Pooled blocks are aligned to this; stricter requests fall back to malloc
+      static size_t constexpr POOL_ALIGNMENT = 16;
+
+      struct ScopeStats
+      {
+        std::uint64_t live_bytes = 0;
+        std::uint64_t peak_bytes = 0;
+        std::uint64_t live_allocations = 0;
+        std::uint64_t allocation_count = 0;
+        std::uint64_t pooled_count = 0;
+        // Reported through the internal allocation notifications, for memory the driver got elsewhere
+        std::uint64_t internal_bytes = 0;
+      };
+
+      HostAllocator();
+      ~HostAllocator();
+      HostAllocator(HostAllocator const &) = delete;
+      HostAllocator &operator=(HostAllocator const &) = delete;
+
+      VkAllocationCallbacks const *callbacks() const { return &allocation_callbacks; }
+
+      ScopeStats stats(VkSystemAllocationScope scope) const;
+      // Bytes reserved by the size class pools, used or not
+      std::uint64_t pooledBytes() const;
+      void logStats() const;
+      // Logs a warning per scope with allocations still live and returns whether there were any
+      bool reportLeaks() const;
+
+    private:
+      struct Header;
+
+      struct Counters
+      {
+        std::atomic<std::uint64_t> live_bytes;
+        std::atomic<std::uint64_t> peak_bytes;
+        std::atomic<std::uint64_t> live_allocations;
+        std::atomic<std::uint64_t> allocation_count;
+        std::atomic<std::uint64_t> pooled_count;
+        std::atomic<std::uint64_t> internal_bytes;
+      };
+
+      struct SizeClass
+      {
+        mutable std::mutex mutex;
+        void *free_list = nullptr;
+        std::vector<void *> chunks;
+      };
+
+      static void *VKAPI_PTR allocate(void *user_data, size_t size, size_t alignment, VkSystemAllocationScope scope);
+      static void *VKAPI_PTR reallocate(
+        void *user_data,
+        void *original,
+        size_t size,
+        size_t alignment,
+        VkSystemAllocationScope scope
+      );
+      static void VKAPI_PTR free(void *user_data, void *memory);
+      static void VKAPI_PTR internalAllocation(
+        void *user_data,
+        size_t size,
+        VkInternalAllocationType type,
+        VkSystemAllocationScope scope
+      );
+      static void VKAPI_PTR internalFree(
+        void *user_data,
+        size_t size,
+        VkInternalAllocationType type,
+        VkSystemAllocationScope scope
+      );
+
+      void *allocateBlock(size_t size, size_t alignment, VkSystemAllocationScope scope);
+      void freeBlock(void *memory);
+      void *popPooled(size_t size_class);
+      void pushPooled(size_t size_class, void *block);
+      void countAllocation(VkSystemAllocationScope scope, size_t size, bool pooled);
+      void countFree(VkSystemAllocationScope scope, size_t size);
+
+      VkAllocationCallbacks allocation_callbacks;
+      Counters counters[SCOPE_COUNT];
+      SizeClass size_classes[SIZE_CLASS_COUNT];
+    };
+  }
+#endif
+
+}
+
+#endif // HOST_ALLOCATOR_H
@@ -4,13 +4,18 @@
 //#define USING_OPENGL
 #define USING_VULKAN
 
-#define USING_GLFW
+// Headless builds render into an offscreen image and never touch a windowing system
+#ifndef HEADLESS
+  #define USING_GLFW
+#endif
 
 #define USING_GLM
 
-#ifdef USING_GFLW
+#ifdef USING_GLFW
   #define GLFW_INCLUDE_VULKAN
   #include <GLFW/glfw3.h>
+#elif defined(USING_VULKAN)
+  #include <vulkan/vulkan.h>
 #endif
 
 #ifdef USING_GLM
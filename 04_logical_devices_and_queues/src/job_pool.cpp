@@ -0,0 +1,248 @@
+#include "job_pool.h"
+#include "debug.h"
+#include "profiler.h"
+
+namespace Jobs
+{
+  struct Job
+  {
+    std::function<void()> function;
+    Priority priority;
+    size_t pending_dependencies = 0;
+    bool finished = false;
+    std::exception_ptr error;
+    std::vector<std::shared_ptr<Job>> dependents;
+  };
+
+  JobPool::~JobPool()
+  {
+    stop();
+  }
+
+  void JobPool::start(unsigned worker_count)
+  {
+    if (!workers.empty())
+    {
+      return;
+    }
+
+    if (worker_count == 0)
+    {
+      unsigned hardware_threads = std::thread::hardware_concurrency();
+      worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+    }
+
+    stopping = false;
+    for (unsigned i=0; i<worker_count; ++i)
+    {
+      workers.emplace_back(&JobPool::workerLoop, this);
+    }
+    Debug::Trace("Job pool started with {} workers", worker_count);
+  }
+
+  void JobPool::stop()
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      // Jobs waiting on dependencies become ready as those finish, so this helps until all of them have run
+      while (unfinished > 0)
+      {
+        std::shared_ptr<Job> job = popLocked();
+        if (job != nullptr)
+        {
+          lock.unlock();
+          run(job);
+          lock.lock();
+        }
+        else
+        {
+          job_finished.wait(lock);
+        }
+      }
+      stopping = true;
+    }
+    work_available.notify_all();
+
+    for (std::thread &worker : workers)
+    {
+      worker.join();
+    }
+    workers.clear();
+  }
+
+  Handle JobPool::submit(
+    std::function<void()> function,
+    std::vector<Handle> const &dependencies,
+    Priority priority)
+  {
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->function = std::move(function);
+    job->priority = priority;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++unfinished;
+
+      for (Handle const &dependency : dependencies)
+      {
+        if (dependency.job == nullptr)
+        {
+          continue;
+        }
+        if (!dependency.job->finished)
+        {
+          dependency.job->dependents.push_back(job);
+          ++job->pending_dependencies;
+        }
+        else if (dependency.job->error && !job->error)
+        {
+          job->error = dependency.job->error;
+        }
+      }
+
+      if (job->pending_dependencies == 0)
+      {
+        ready[static_cast<size_t>(priority)].push_back(job);
+      }
+    }
+    work_available.notify_one();
+
+    return Handle(job);
+  }
+
+  bool JobPool::isComplete(Handle const &handle) const
+  {
+    if (handle.job == nullptr)
+    {
+      return true;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return handle.job->finished;
+  }
+
+  void JobPool::wait(Handle const &handle)
+  {
+    if (handle.job == nullptr)
+    {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!handle.job->finished)
+    {
+      std::shared_ptr<Job> job = popLocked();
+      if (job != nullptr)
+      {
+        lock.unlock();
+        run(job);
+        lock.lock();
+      }
+      else
+      {
+        job_finished.wait(lock);
+      }
+    }
+
+    if (handle.job->error)
+    {
+      std::rethrow_exception(handle.job->error);
+    }
+  }
+
+  void JobPool::waitAll(std::vector<Handle> const &handles)
+  {
+    for (Handle const &handle : handles)
+    {
+      wait(handle);
+    }
+  }
+
+  std::shared_ptr<Job> JobPool::popLocked()
+  {
+    for (std::deque<std::shared_ptr<Job>> &queue : ready)
+    {
+      if (!queue.empty())
+      {
+        std::shared_ptr<Job> job = std::move(queue.front());
+        queue.pop_front();
+        return job;
+      }
+    }
+    return nullptr;
+  }
+
+  void JobPool::run(std::shared_ptr<Job> const &job)
+  {
+    // A failed dependency already set the error, and the job is skipped
+    std::exception_ptr error = job->error;
+    if (!error)
+    {
+      try
+      {
+        job->function();
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+    }
+    job->function = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finishLocked(job, error);
+    }
+    job_finished.notify_all();
+  }
+
+  void JobPool::finishLocked(std::shared_ptr<Job> const &job, std::exception_ptr error)
+  {
+    job->finished = true;
+    job->error = error;
+    --unfinished;
+
+    size_t released = 0;
+    for (std::shared_ptr<Job> const &dependent : job->dependents)
+    {
+      if (error && !dependent->error)
+      {
+        dependent->error = error;
+      }
+      if (--dependent->pending_dependencies == 0)
+      {
+        ready[static_cast<size_t>(dependent->priority)].push_back(dependent);
+        ++released;
+      }
+    }
+    job->dependents.clear();
+
+    for (size_t i=0; i<released; ++i)
+    {
+      work_available.notify_one();
+    }
+  }
+
+  void JobPool::workerLoop()
+  {
+    PROFILE_THREAD_NAME("Job worker");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+      std::shared_ptr<Job> job = popLocked();
+      if (job == nullptr)
+      {
+        if (stopping)
+        {
+          return;
+        }
+        work_available.wait(lock);
+        continue;
+      }
+
+      lock.unlock();
+      run(job);
+      lock.lock();
+    }
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Jobs
+{
+  enum class Priority : std::uint8_t
+  {
+    Critical,   // Needed before the first frame, picked ahead of everything else
+    Background
+  };
+
+  struct Job;
+
+  // Refers to a submitted job. Empty handles count as complete.
+  class Handle
+  {
+  public:
+    Handle() = default;
+    bool isValid() const { return job != nullptr; }
+
+  private:
+    friend class JobPool;
+    explicit Handle(std::shared_ptr<Job> job) : job(std::move(job)) {}
+    std::shared_ptr<Job> job;
+  };
+
+  // A fixed set of worker threads running jobs once every job they depend on has finished. A job that
+  // throws fails its dependents as well, without running them, and wait() rethrows the exception.
+  class JobPool
+  {
+  public:
+    JobPool() = default;
+    ~JobPool();
+    JobPool(JobPool const &) = delete;
+    JobPool &operator=(JobPool const &) = delete;
+
+    // Zero picks one worker per hardware thread, less one for the calling thread. Does nothing if running.
+    void start(unsigned worker_count = 0);
+    // Runs everything already submitted, then joins the workers
+    void stop();
+
+    Handle submit(
+      std::function<void()> function,
+      std::vector<Handle> const &dependencies = {},
+      Priority priority = Priority::Background
+    );
+
+    bool isComplete(Handle const &handle) const;
+    // Runs queued jobs on the calling thread while waiting, so waiting from a job or with no workers
+    // still makes progress
+    void wait(Handle const &handle);
+    void waitAll(std::vector<Handle> const &handles);
+
+    unsigned workerCount() const { return static_cast<unsigned>(workers.size()); }
+
+  private:
+    // Takes the next ready job, or nullptr. Called with the mutex held.
+    std::shared_ptr<Job> popLocked();
+    void run(std::shared_ptr<Job> const &job);
+    void finishLocked(std::shared_ptr<Job> const &job, std::exception_ptr error);
+    void workerLoop();
+
+    mutable std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable job_finished;
+    std::deque<std::shared_ptr<Job>> ready[2]; // By priority
+    size_t unfinished = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+  };
+}
+
+#endif // JOB_POOL_H
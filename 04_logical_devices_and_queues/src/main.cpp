@@ -1,25 +1,142 @@
 #include "context.h"
+#include "constants.h"
 #include "window_setup.h"
 #include "graphics_setup.h"
+#include "frame_pacer.h"
+#include "task_graph.h"
 #include "debug.h"
+#include "profiler.h"
 
-#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
 
-void init(Context const &context);
+void init(Context &context);
+void run(Context &context);
+void cleanup(Context &context);
 
 int main()
 {
-  Debug::Log("TRACE", "testing");
-
+  PROFILE_THREAD_NAME("Main");
   Context context;
-  init(context); 
 
+  std::string error;
+  try
+  {
+    init(context);
+    run(context);
+  }
+  catch (std::exception const &e)
+  {
+    error = e.what();
+  }
+
+  // After a failure too, so whatever init got through is released and the pipeline cache is still saved
+  try
+  {
+    cleanup(context);
+  }
+  catch (std::exception const &e)
+  {
+    if (error.empty())
+    {
+      error = e.what();
+    }
+  }
+
+  // Whatever was recorded up to a failure is still worth a look
+  Profiling::writeChromeTrace(Constants::TRACE_PATH);
+  Debug::Flush();
+
+  if (!error.empty())
+  {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
 
-void init(Context const &context)
+void init(Context &context)
+{
+  PROFILE_ZONE("init");
+  Debug::Trace("Init");
+
+  // Window creation on the main thread overlaps with Vulkan loader, instance and device setup on the workers
+  context.graphics.job_pool.start();
+
+  Jobs::TaskGraph graph;
+  Jobs::TaskGraph::Node window_system = graph.add(
+    "Window system", {}, [&context]() { initWindowSystem(context.window); }, Jobs::TaskGraph::Affinity::Caller
+  );
+  graph.add(
+    "Window", { window_system }, [&context]() { createWindow(context.window); }, Jobs::TaskGraph::Affinity::Caller
+  );
+  Graphics::addInitTasks(graph, context.graphics, { window_system });
+
+  graph.run(context.graphics.job_pool);
+  graph.logTimings();
+}
+
+void run(Context &context)
 {
-  initWindow(context.window);
-  initGraphics(context.graphics);
+  PROFILE_ZONE("run");
+  Debug::Trace("Run");
+
+  #ifdef USING_GLFW
+    FramePacer pacer(Constants::TARGET_FRAME_RATE);
+    while (!glfwWindowShouldClose(context.window.window))
+    {
+      // Streaming and uploads carry on with or without anything to render them into
+      Graphics::update(context.graphics);
+
+      if (!isWindowVisible(context.window) || !Graphics::canRender(context.graphics))
+      {
+        // Nothing would change on screen, so sleep until there is input rather than spinning, waking now and
+        // then while background work still needs moving along
+        PROFILE_ZONE("Wait for events");
+        if (Graphics::hasBackgroundWork(context.graphics))
+        {
+          glfwWaitEventsTimeout(Constants::BACKGROUND_WORK_INTERVAL);
+        }
+        else
+        {
+          glfwWaitEvents();
+        }
+        pacer.reset();
+        continue;
+      }
+
+      PROFILE_ZONE("Frame");
+      glfwPollEvents();
+      Graphics::renderFrame(context.graphics);
+      pacer.wait();
+    }
+  #else
+    FramePacer pacer(Constants::HEADLESS_TARGET_FRAME_RATE);
+    for (unsigned frame=0; frame<Constants::HEADLESS_FRAME_COUNT; ++frame)
+    {
+      PROFILE_ZONE("Frame");
+      Graphics::update(context.graphics);
+      Graphics::renderFrame(context.graphics);
+      pacer.wait();
+    }
+  #endif
+
+  if (pacer.lateFrames() > 0)
+  {
+    Debug::Info("{} of {} frames missed their pacing deadline", pacer.lateFrames(), pacer.frameCount());
+  }
+
+  Debug::Trace("Run loop end");
 }
 
+void cleanup(Context &context)
+{
+  PROFILE_ZONE("cleanup");
+  Debug::Trace("Clean up");
+
+  // Graphics resources may reference the window surface, so they go first
+  Graphics::cleanup(context.graphics);
+  cleanupWindow(context.window);
+}
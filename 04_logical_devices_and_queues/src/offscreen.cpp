@@ -0,0 +1,308 @@
+#include "offscreen.h"
+#include "graphics_setup.h"
+#include "debug_utils.h"
+#include "constants.h"
+#include "debug.h"
+#include "profiler.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#if defined(USING_VULKAN) && !defined(USING_GLFW)
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    static VkFormat constexpr OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+    static VkDeviceSize constexpr OFFSCREEN_SIZE =
+      static_cast<VkDeviceSize>(Constants::WIDTH) * Constants::HEIGHT * 4;
+
+    static void createOffscreenImage(Context::Graphics &context)
+    {
+      DeviceDispatch const &vk = context.device_functions;
+      VkAllocationCallbacks const *allocator = context.host_allocator.callbacks();
+      Context::Graphics::Offscreen &offscreen = context.offscreen;
+
+      VkImageCreateInfo image_info = {};
+      image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+      image_info.imageType = VK_IMAGE_TYPE_2D;
+      image_info.format = OFFSCREEN_FORMAT;
+      image_info.extent.width = static_cast<std::uint32_t>(Constants::WIDTH);
+      image_info.extent.height = static_cast<std::uint32_t>(Constants::HEIGHT);
+      image_info.extent.depth = 1;
+      image_info.mipLevels = 1;
+      image_info.arrayLayers = 1;
+      image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+      image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+      image_info.usage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+      image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+      if (vk.vkCreateImage(context.device, &image_info, allocator, &(offscreen.image)) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create offscreen image");
+      }
+
+      offscreen.image_memory = context.memory_allocator.allocateForImage(
+        offscreen.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+      );
+
+      setObjectName(context, VK_OBJECT_TYPE_IMAGE, offscreen.image, "Offscreen target");
+    }
+
+    static void createReadbackBuffer(Context::Graphics &context, Context::Graphics::Offscreen::Frame &frame)
+    {
+      DeviceDispatch const &vk = context.device_functions;
+      VkAllocationCallbacks const *allocator = context.host_allocator.callbacks();
+
+      VkBufferCreateInfo buffer_info = {};
+      buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      buffer_info.size = OFFSCREEN_SIZE;
+      buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+      buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+      if (vk.vkCreateBuffer(context.device, &buffer_info, allocator, &(frame.readback_buffer)) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create offscreen readback buffer");
+      }
+
+      // Coherent memory means the host sees the copy as soon as the fence signals, without an invalidate.
+      // Cached memory makes reading it back on the host faster.
+      frame.readback_memory = context.memory_allocator.allocateForBuffer(
+        frame.readback_buffer,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_CACHED_BIT
+      );
+      setObjectName(context, VK_OBJECT_TYPE_BUFFER, frame.readback_buffer, "Offscreen readback");
+    }
+
+    static void createFrameCommands(Context::Graphics &context, Context::Graphics::Offscreen::Frame &frame)
+    {
+      DeviceDispatch const &vk = context.device_functions;
+      VkAllocationCallbacks const *allocator = context.host_allocator.callbacks();
+
+      // Reset as a whole each time the frame comes round, rather than per command buffer
+      VkCommandPoolCreateInfo pool_info = {};
+      pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+      pool_info.queueFamilyIndex = static_cast<std::uint32_t>(context.queue_families.graphics.index);
+
+      if (vk.vkCreateCommandPool(context.device, &pool_info, allocator, &(frame.command_pool)) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create offscreen command pool");
+      }
+
+      VkCommandBufferAllocateInfo command_buffer_info = {};
+      command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      command_buffer_info.commandPool = frame.command_pool;
+      command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      command_buffer_info.commandBufferCount = 1;
+
+      VkResult result = vk.vkAllocateCommandBuffers(context.device, &command_buffer_info, &(frame.command_buffer));
+      if (result != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to allocate offscreen command buffer");
+      }
+    }
+
+    void createOffscreenTarget(Context::Graphics &context)
+    {
+      Debug::Trace("Creating offscreen render target");
+
+      Context::Graphics::Offscreen &offscreen = context.offscreen;
+
+      createOffscreenImage(context);
+
+      offscreen.frames.resize(context.frames_in_flight > 0 ? context.frames_in_flight : 1);
+      for (Context::Graphics::Offscreen::Frame &frame : offscreen.frames)
+      {
+        createReadbackBuffer(context, frame);
+        createFrameCommands(context, frame);
+      }
+      // Host visible allocations stay mapped
+      offscreen.pixels = offscreen.frames[0].readback_memory->mapped;
+
+      Debug::Trace("Offscreen render target created with {} frames in flight", offscreen.frames.size());
+    }
+
+    static void recordOffscreenFrame(Context::Graphics &context, Context::Graphics::Offscreen::Frame &frame)
+    {
+      DeviceDispatch const &vk = context.device_functions;
+      Context::Graphics::Offscreen &offscreen = context.offscreen;
+      VkCommandBuffer command_buffer = frame.command_buffer;
+
+      vk.vkResetCommandPool(context.device, frame.command_pool, 0);
+
+      VkCommandBufferBeginInfo begin_info = {};
+      begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      vk.vkBeginCommandBuffer(command_buffer, &begin_info);
+      beginCommandBufferLabel(context, command_buffer, "Offscreen frame");
+      GpuProfiler &profiler = context.gpu_profiler;
+      profiler.beginFrame(command_buffer);
+      std::uint32_t frame_pass = profiler.beginPass(command_buffer, "Frame");
+
+      VkImageSubresourceRange range = {};
+      range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      range.levelCount = 1;
+      range.layerCount = 1;
+
+      std::uint32_t clear_pass = profiler.beginPass(command_buffer, "Clear");
+
+      // The previous contents are overwritten, so the old layout can be discarded
+      VkImageMemoryBarrier to_transfer_dst = {};
+      to_transfer_dst.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      to_transfer_dst.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      to_transfer_dst.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      to_transfer_dst.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      to_transfer_dst.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      to_transfer_dst.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      to_transfer_dst.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      to_transfer_dst.image = offscreen.image;
+      to_transfer_dst.subresourceRange = range;
+      vk.vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &to_transfer_dst
+      );
+
+      // There is no pipeline yet, so a frame is a clear that cycles colour to keep readbacks distinguishable
+      float shade = static_cast<float>(offscreen.frame_count % 256) / 255.0f;
+      VkClearColorValue clear_color = {};
+      clear_color.float32[0] = shade;
+      clear_color.float32[1] = 0.0f;
+      clear_color.float32[2] = 1.0f - shade;
+      clear_color.float32[3] = 1.0f;
+      vk.vkCmdClearColorImage(
+        command_buffer, offscreen.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_color, 1, &range
+      );
+      profiler.endPass(command_buffer, clear_pass);
+
+      std::uint32_t readback_pass = profiler.beginPass(command_buffer, "Readback copy");
+
+      VkImageMemoryBarrier to_transfer_src = to_transfer_dst;
+      to_transfer_src.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      to_transfer_src.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      to_transfer_src.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      to_transfer_src.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      vk.vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &to_transfer_src
+      );
+
+      VkBufferImageCopy region = {};
+      region.bufferOffset = 0;
+      region.bufferRowLength = 0;   // Tightly packed
+      region.bufferImageHeight = 0;
+      region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.imageSubresource.layerCount = 1;
+      region.imageExtent.width = static_cast<std::uint32_t>(Constants::WIDTH);
+      region.imageExtent.height = static_cast<std::uint32_t>(Constants::HEIGHT);
+      region.imageExtent.depth = 1;
+      vk.vkCmdCopyImageToBuffer(
+        command_buffer,
+        offscreen.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        frame.readback_buffer,
+        1, &region
+      );
+
+      // Make the copy visible to host reads once the fence signals
+      VkBufferMemoryBarrier to_host = {};
+      to_host.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      to_host.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      to_host.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+      to_host.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      to_host.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      to_host.buffer = frame.readback_buffer;
+      to_host.size = VK_WHOLE_SIZE;
+      vk.vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 0, nullptr, 1, &to_host, 0, nullptr
+      );
+      profiler.endPass(command_buffer, readback_pass);
+
+      profiler.endPass(command_buffer, frame_pass);
+      endCommandBufferLabel(context, command_buffer);
+
+      if (vk.vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to record offscreen command buffer");
+      }
+    }
+
+    void renderOffscreenFrame(Context::Graphics &context)
+    {
+      Context::Graphics::Offscreen &offscreen = context.offscreen;
+      std::uint32_t frame_index = static_cast<std::uint32_t>(offscreen.frame_count % offscreen.frames.size());
+      Context::Graphics::Offscreen::Frame &frame = offscreen.frames[frame_index];
+
+      // Only blocks when the GPU is a whole frames_in_flight behind; otherwise recording overlaps its work
+      {
+        PROFILE_ZONE("Wait for frame");
+        context.graphics_submit->wait(frame.ticket);
+      }
+      // There is no draw list to record yet, but the frame's secondary buffers and descriptor sets are recycled
+      // all the same
+      context.command_recorder.beginFrame(frame_index);
+      context.descriptor_allocator.beginFrame(frame_index);
+      if (context.bindless_table.isEnabled())
+      {
+        context.bindless_table.beginFrame();
+      }
+      {
+        PROFILE_ZONE("Record");
+        recordOffscreenFrame(context, frame);
+      }
+
+      {
+        PROFILE_ZONE("Submit");
+        context.gpu_profiler.endFrame();
+        Submission submission;
+        submission.command_buffers.push_back(frame.command_buffer);
+        frame.ticket = context.graphics_submit->submit(std::move(submission));
+        frame.number = ++offscreen.frame_count;
+      }
+
+      // Whichever finished frame is newest, checked without waiting. Its slot can't be reused before the next
+      // call, so the pixels hold until then.
+      std::uint64_t newest = 0;
+      for (Context::Graphics::Offscreen::Frame const &finished : offscreen.frames)
+      {
+        if (finished.number > newest && context.graphics_submit->isComplete(finished.ticket))
+        {
+          newest = finished.number;
+          offscreen.pixels = finished.readback_memory->mapped;
+        }
+      }
+    }
+
+    void destroyOffscreenTarget(Context::Graphics &context)
+    {
+      DeviceDispatch const &vk = context.device_functions;
+      VkAllocationCallbacks const *allocator = context.host_allocator.callbacks();
+      Debug::Trace("Destroy offscreen render target");
+
+      Context::Graphics::Offscreen &offscreen = context.offscreen;
+
+      vk.vkDeviceWaitIdle(context.device);
+
+      for (Context::Graphics::Offscreen::Frame &frame : offscreen.frames)
+      {
+        vk.vkDestroyCommandPool(context.device, frame.command_pool, allocator);
+        vk.vkDestroyBuffer(context.device, frame.readback_buffer, allocator);
+        context.memory_allocator.free(frame.readback_memory);
+      }
+      vk.vkDestroyImage(context.device, offscreen.image, allocator);
+      context.memory_allocator.free(offscreen.image_memory);
+
+      offscreen = Context::Graphics::Offscreen();
+    }
+  }
+}
+
+#endif
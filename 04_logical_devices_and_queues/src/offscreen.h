@@ -0,0 +1,24 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include "context.h"
+
+namespace Graphics
+{
+
+#if defined(USING_VULKAN) && !defined(USING_GLFW)
+  namespace Vulkan
+  {
+    // The offscreen target stands in for the swap chain in headless builds. Each frame is rendered into
+    // a device local image and copied into a readback buffer of its own as tightly packed RGBA8 rows, which
+    // context.offscreen.pixels points at once the frame has finished. Up to context.frames_in_flight frames
+    // are on the GPU at once, and renderOffscreenFrame only waits when it needs a frame's resources back.
+    void createOffscreenTarget(Context::Graphics &context);
+    void renderOffscreenFrame(Context::Graphics &context);
+    void destroyOffscreenTarget(Context::Graphics &context);
+  }
+#endif
+
+}
+
+#endif // OFFSCREEN_H
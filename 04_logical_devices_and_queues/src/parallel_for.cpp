@@ -0,0 +1,153 @@
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <vector>
+
+namespace Jobs
+{
+  namespace
+  {
+    // [begin, end) packed into one word so the owner taking from the front and thieves splitting off the
+    // back both update it with a single compare and swap
+    struct alignas(64) Share
+    {
+      std::atomic<std::uint64_t> range{ 0 };
+    };
+
+    std::uint64_t pack(std::uint32_t begin, std::uint32_t end)
+    {
+      return (static_cast<std::uint64_t>(begin) << 32) | end;
+    }
+
+    std::uint32_t beginOf(std::uint64_t range) { return static_cast<std::uint32_t>(range >> 32); }
+    std::uint32_t endOf(std::uint64_t range) { return static_cast<std::uint32_t>(range); }
+
+    bool takeFront(Share &share, std::uint32_t &index)
+    {
+      std::uint64_t range = share.range.load(std::memory_order_relaxed);
+      while (beginOf(range) < endOf(range))
+      {
+        if (share.range.compare_exchange_weak(range, pack(beginOf(range) + 1, endOf(range))))
+        {
+          index = beginOf(range);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool stealBack(Share &victim, std::uint32_t &begin, std::uint32_t &end)
+    {
+      std::uint64_t range = victim.range.load(std::memory_order_relaxed);
+      while (beginOf(range) < endOf(range))
+      {
+        // Rounding up leaves the victim the single index it may be about to take
+        std::uint32_t middle = beginOf(range) + (endOf(range) - beginOf(range) + 1) / 2;
+        if (victim.range.compare_exchange_weak(range, pack(beginOf(range), middle)))
+        {
+          begin = middle;
+          end = endOf(range);
+          return begin < end;
+        }
+      }
+      return false;
+    }
+
+    void participate(
+      std::vector<Share> &shares,
+      std::uint32_t participant,
+      std::function<void(std::uint32_t, std::uint32_t)> const &body)
+    {
+      std::uint32_t const participant_count = static_cast<std::uint32_t>(shares.size());
+      Share &own = shares[participant];
+      for (;;)
+      {
+        std::uint32_t index = 0;
+        while (takeFront(own, index))
+        {
+          body(index, participant);
+        }
+
+        // Only this participant refills its own share, and only once it is empty, so a plain store is safe
+        bool stole = false;
+        for (std::uint32_t offset=1; offset<participant_count && !stole; ++offset)
+        {
+          std::uint32_t begin = 0;
+          std::uint32_t end = 0;
+          if (stealBack(shares[(participant + offset) % participant_count], begin, end))
+          {
+            own.range.store(pack(begin, end));
+            stole = true;
+          }
+        }
+        if (!stole)
+        {
+          return;
+        }
+      }
+    }
+  }
+
+  void parallelFor(
+    JobPool &job_pool,
+    std::uint32_t count,
+    std::uint32_t participants,
+    std::function<void(std::uint32_t index, std::uint32_t participant)> const &body)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+
+    participants = std::max(1u, std::min(participants, count));
+    std::vector<Share> shares(participants);
+    for (std::uint32_t i=0; i<participants; ++i)
+    {
+      std::uint64_t begin = static_cast<std::uint64_t>(count) * i / participants;
+      std::uint64_t end = static_cast<std::uint64_t>(count) * (i + 1) / participants;
+      shares[i].range.store(pack(static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end)));
+    }
+
+    std::vector<Handle> helpers;
+    for (std::uint32_t i=1; i<participants; ++i)
+    {
+      helpers.push_back(job_pool.submit(
+        [&shares, &body, i]() { participate(shares, i, body); }, {}, Priority::Critical
+      ));
+    }
+
+    // The helpers reference this frame, so they are waited for even when the caller's share throws
+    std::exception_ptr error;
+    try
+    {
+      participate(shares, 0, body);
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+
+    for (Handle const &helper : helpers)
+    {
+      try
+      {
+        job_pool.wait(helper);
+      }
+      catch (...)
+      {
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+      }
+    }
+
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+}
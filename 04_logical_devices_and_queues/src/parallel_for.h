@@ -0,0 +1,25 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include "job_pool.h"
+
+#include <cstdint>
+#include <functional>
+
+namespace Jobs
+{
+  // Runs body once for every index in [0, count), spread over up to participants jobs on the pool, the
+  // calling thread being participant 0. Each participant starts on an equal contiguous share of the indices
+  // and, once through it, steals the back half of another participant's remaining share, so uneven work
+  // still balances without a shared queue. A participant runs one body call at a time, which lets
+  // per-participant resources such as command pools go without locking. Returns once every index has run,
+  // rethrowing the first exception a body threw.
+  void parallelFor(
+    JobPool &job_pool,
+    std::uint32_t count,
+    std::uint32_t participants,
+    std::function<void(std::uint32_t index, std::uint32_t participant)> const &body
+  );
+}
+
+#endif // PARALLEL_FOR_H
@@ -0,0 +1,259 @@
+#include "pipeline_cache.h"
+#include "debug_utils.h"
+#include "file_io.h"
+#include "debug.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef USING_VULKAN
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    // Precedes the driver's data in the file. The driver version isn't part of the Vulkan header, and the
+    // size and hash catch truncated or corrupted files, which some drivers crash on rather than reject.
+    struct PipelineCacheFileHeader
+    {
+      char magic[8];
+      std::uint32_t version;
+      std::uint32_t driver_version;
+      std::uint64_t data_size;
+      std::uint64_t data_hash;
+    };
+
+    // The start of the data vkGetPipelineCacheData returns, as laid out by VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+    struct PipelineCacheHeaderVersionOne
+    {
+      std::uint32_t header_size;
+      std::uint32_t header_version;
+      std::uint32_t vendor_id;
+      std::uint32_t device_id;
+      std::uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+    };
+
+    static char const FILE_MAGIC[8] = { 'v', 't', 'i', 'p', 'c', 'a', 'c', 'h' };
+    static std::uint32_t constexpr FILE_VERSION = 1;
+
+    // FNV-1a
+    static std::uint64_t hashData(void const *data, size_t size)
+    {
+      std::uint8_t const *bytes = static_cast<std::uint8_t const *>(data);
+      std::uint64_t hash = 14695981039346656037ull;
+      for (size_t i=0; i<size; ++i)
+      {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+      }
+      return hash;
+    }
+
+    // Returns the driver's data within the file, or nullptr with the reason in why
+    static void const *validatePipelineCacheFile(
+      File::MappedFile const &file,
+      VkPhysicalDeviceProperties const &properties,
+      size_t &data_size,
+      char const *&why)
+    {
+      if (file.size() < sizeof(PipelineCacheFileHeader) + sizeof(PipelineCacheHeaderVersionOne))
+      {
+        why = "too small";
+        return nullptr;
+      }
+
+      PipelineCacheFileHeader file_header;
+      std::memcpy(&file_header, file.data(), sizeof(file_header));
+      if (std::memcmp(file_header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || file_header.version != FILE_VERSION)
+      {
+        why = "not a pipeline cache file of this version";
+        return nullptr;
+      }
+      if (file_header.data_size != file.size() - sizeof(PipelineCacheFileHeader))
+      {
+        why = "truncated";
+        return nullptr;
+      }
+      if (file_header.driver_version != properties.driverVersion)
+      {
+        why = "written by another driver version";
+        return nullptr;
+      }
+
+      void const *data = static_cast<char const *>(file.data()) + sizeof(PipelineCacheFileHeader);
+      data_size = static_cast<size_t>(file_header.data_size);
+
+      PipelineCacheHeaderVersionOne header;
+      std::memcpy(&header, data, sizeof(header));
+      if (header.header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+          header.header_size < sizeof(header) ||
+          header.header_size > data_size)
+      {
+        why = "unknown header";
+        return nullptr;
+      }
+      if (header.vendor_id != properties.vendorID || header.device_id != properties.deviceID)
+      {
+        why = "written for another device";
+        return nullptr;
+      }
+      if (std::memcmp(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+      {
+        why = "pipeline cache UUID mismatch";
+        return nullptr;
+      }
+
+      // Checked last, since it is the only check that reads the whole file
+      if (hashData(data, data_size) != file_header.data_hash)
+      {
+        why = "corrupted";
+        return nullptr;
+      }
+
+      return data;
+    }
+
+    void createPipelineCache(Context::Graphics &context)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      VkPhysicalDeviceProperties properties;
+      context.instance_functions.vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+
+      VkPipelineCacheCreateInfo create_info = {};
+      create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+      // Kept mapped until the driver has copied the data in vkCreatePipelineCache
+      File::MappedFile file;
+      context.pipeline_cache_hash = 0;
+      if (!context.pipeline_cache_path.empty() && file.open(context.pipeline_cache_path))
+      {
+        size_t data_size = 0;
+        char const *why = nullptr;
+        void const *data = validatePipelineCacheFile(file, properties, data_size, why);
+        if (data != nullptr)
+        {
+          create_info.initialDataSize = data_size;
+          create_info.pInitialData = data;
+          context.pipeline_cache_hash = hashData(data, data_size);
+        }
+        else
+        {
+          Debug::Info("Ignoring pipeline cache {}: {}", context.pipeline_cache_path, why);
+        }
+      }
+
+      VkAllocationCallbacks const *allocator = context.host_allocator.callbacks();
+      VkResult result = context.device_functions.vkCreatePipelineCache(
+        context.device, &create_info, allocator, &(context.pipeline_cache)
+      );
+      if (result != VK_SUCCESS && create_info.initialDataSize != 0)
+      {
+        Debug::Warning("Driver rejected pipeline cache {}, starting empty", context.pipeline_cache_path);
+        create_info.initialDataSize = 0;
+        create_info.pInitialData = nullptr;
+        context.pipeline_cache_hash = 0;
+        result = context.device_functions.vkCreatePipelineCache(
+          context.device, &create_info, allocator, &(context.pipeline_cache)
+        );
+      }
+      if (result != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create pipeline cache");
+      }
+
+      setObjectName(context, VK_OBJECT_TYPE_PIPELINE_CACHE, context.pipeline_cache, "Pipeline cache");
+
+      std::chrono::microseconds elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+      Debug::Trace("Pipeline cache created from {} bytes in {} us", create_info.initialDataSize, elapsed.count());
+    }
+
+    void savePipelineCache(Context::Graphics &context)
+    {
+      if (context.pipeline_cache == VK_NULL_HANDLE || context.pipeline_cache_path.empty())
+      {
+        return;
+      }
+
+      DeviceDispatch const &vk = context.device_functions;
+
+      // The cache can grow between the size query and the copy if other threads are creating pipelines
+      std::vector<char> data;
+      VkResult result;
+      do
+      {
+        size_t data_size = 0;
+        if (vk.vkGetPipelineCacheData(context.device, context.pipeline_cache, &data_size, nullptr) != VK_SUCCESS)
+        {
+          Debug::Warning("Failed to query pipeline cache size");
+          return;
+        }
+        data.resize(data_size);
+        result = vk.vkGetPipelineCacheData(context.device, context.pipeline_cache, &data_size, data.data());
+        data.resize(data_size);
+      } while (result == VK_INCOMPLETE);
+
+      if (result != VK_SUCCESS || data.size() < sizeof(PipelineCacheHeaderVersionOne))
+      {
+        Debug::Warning("Failed to read pipeline cache data");
+        return;
+      }
+
+      std::uint64_t hash = hashData(data.data(), data.size());
+      if (hash == context.pipeline_cache_hash)
+      {
+        Debug::Trace("Pipeline cache unchanged, not rewriting {}", context.pipeline_cache_path);
+        return;
+      }
+
+      VkPhysicalDeviceProperties properties;
+      context.instance_functions.vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+
+      PipelineCacheFileHeader file_header = {};
+      std::memcpy(file_header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+      file_header.version = FILE_VERSION;
+      file_header.driver_version = properties.driverVersion;
+      file_header.data_size = data.size();
+      file_header.data_hash = hash;
+
+      std::string const temporary_path = File::temporaryPath(context.pipeline_cache_path);
+      bool written;
+      {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const *>(&file_header), sizeof(file_header));
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        written = static_cast<bool>(file.flush());
+      }
+      if (!written)
+      {
+        std::remove(temporary_path.c_str());
+        Debug::Warning("Failed to write pipeline cache {}", temporary_path);
+        return;
+      }
+
+      if (!File::replaceFile(temporary_path, context.pipeline_cache_path))
+      {
+        Debug::Warning("Failed to replace pipeline cache {}", context.pipeline_cache_path);
+        return;
+      }
+
+      context.pipeline_cache_hash = hash;
+      Debug::Trace("Pipeline cache saved, {} bytes", data.size());
+    }
+
+    void destroyPipelineCache(Context::Graphics &context)
+    {
+      context.device_functions.vkDestroyPipelineCache(
+        context.device, context.pipeline_cache, context.host_allocator.callbacks()
+      );
+      context.pipeline_cache = VK_NULL_HANDLE;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include "context.h"
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Creates context.pipeline_cache, seeded from context.pipeline_cache_path when the file there was
+    // written for the same device and driver. Anything else starts the cache empty.
+    void createPipelineCache(Context::Graphics &context);
+    // Writes the cache back unless it is unchanged since it was loaded
+    void savePipelineCache(Context::Graphics &context);
+    void destroyPipelineCache(Context::Graphics &context);
+  }
+#endif
+
+}
+
+#endif // PIPELINE_CACHE_H
@@ -0,0 +1,259 @@
+#include "pipeline_library.h"
+#include "file_io.h"
+#include "debug.h"
+#include "clock.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    static std::uint32_t constexpr SPIRV_MAGIC = 0x07230203;
+
+    void PipelineLibrary::init(
+      DeviceDispatch const &vk,
+      VkDevice device,
+      VkPipelineCache pipeline_cache,
+      VkAllocationCallbacks const *allocator,
+      Jobs::JobPool &job_pool)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->pipeline_cache = pipeline_cache;
+      this->allocator = allocator;
+      this->job_pool = &job_pool;
+    }
+
+    void PipelineLibrary::destroy()
+    {
+      std::vector<Jobs::Handle> outstanding;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        outstanding.swap(jobs);
+      }
+      for (Jobs::Handle const &job : outstanding)
+      {
+        try
+        {
+          job_pool->wait(job);
+        }
+        catch (std::exception const &)
+        {
+          // Already reported by whoever waited on it, or nobody cares any more
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      Debug::Trace("Destroying {} pipelines and {} shader modules", pipelines.size(), shader_modules.size());
+      for (std::pair<std::string const, VkPipeline> const &entry : pipelines)
+      {
+        vk->vkDestroyPipeline(device, entry.second, allocator);
+      }
+      for (std::pair<std::string const, VkShaderModule> const &entry : shader_modules)
+      {
+        vk->vkDestroyShaderModule(device, entry.second, allocator);
+      }
+      pipelines.clear();
+      shader_modules.clear();
+      reflections.clear();
+    }
+
+    Jobs::Handle PipelineLibrary::addShaderModule(
+      std::string const &name,
+      std::string const &spirv_path,
+      Jobs::Priority priority)
+    {
+      Jobs::Handle job = job_pool->submit(
+        [this, name, spirv_path]()
+        {
+          // Mapped files start page aligned, which satisfies pCode's 4 byte alignment
+          File::MappedFile file;
+          if (!file.open(spirv_path))
+          {
+            throw std::runtime_error("ERROR: Failed to read shader " + spirv_path);
+          }
+          createShaderModule(name, static_cast<std::uint32_t const *>(file.data()), file.size());
+
+          ShaderReflection reflection;
+          char const *why = nullptr;
+          switch (loadShaderReflection(reflectionPath(spirv_path), reflection, why))
+          {
+            case ReflectionFileStatus::Loaded:
+            {
+              std::lock_guard<std::mutex> lock(mutex);
+              reflections[name] = std::move(reflection);
+              break;
+            }
+            case ReflectionFileStatus::Invalid:
+              Debug::Warning("Ignoring the reflection of shader {}: {}", spirv_path, why);
+              break;
+            case ReflectionFileStatus::Missing:
+              // Shaders built without the shader compiler have none
+              break;
+          }
+        },
+        {},
+        priority
+      );
+
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push_back(job);
+      return job;
+    }
+
+    Jobs::Handle PipelineLibrary::addShaderModule(
+      std::string const &name,
+      std::vector<std::uint32_t> code,
+      Jobs::Priority priority)
+    {
+      // std::function needs a copyable callable, so the code moves into a shared buffer
+      std::shared_ptr<std::vector<std::uint32_t>> shared_code =
+        std::make_shared<std::vector<std::uint32_t>>(std::move(code));
+      Jobs::Handle job = job_pool->submit(
+        [this, name, shared_code]()
+        {
+          createShaderModule(name, shared_code->data(), shared_code->size() * sizeof(std::uint32_t));
+        },
+        {},
+        priority
+      );
+
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push_back(job);
+      return job;
+    }
+
+    Jobs::Handle PipelineLibrary::addPipeline(
+      std::string const &name,
+      std::vector<Jobs::Handle> const &dependencies,
+      PipelineFactory factory,
+      Jobs::Priority priority)
+    {
+      Jobs::Handle job = job_pool->submit(
+        [this, name, factory]()
+        {
+          std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+          VkPipeline pipeline = factory(pipeline_cache);
+          if (pipeline == VK_NULL_HANDLE)
+          {
+            throw std::runtime_error("ERROR: Failed to create pipeline " + name);
+          }
+          Debug::Trace("Pipeline {} created in {} us", name, Clock::microsecondsSince(start));
+
+          std::lock_guard<std::mutex> lock(mutex);
+          VkPipeline &slot = pipelines[name];
+          if (slot != VK_NULL_HANDLE)
+          {
+            vk->vkDestroyPipeline(device, slot, allocator);
+          }
+          slot = pipeline;
+        },
+        dependencies,
+        priority
+      );
+
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push_back(job);
+      return job;
+    }
+
+    Jobs::Handle PipelineLibrary::addComputePipeline(
+      std::string const &name,
+      std::string const &shader_name,
+      std::string const &entry_point,
+      Jobs::Handle const &shader_job,
+      VkPipelineLayout layout,
+      Jobs::Priority priority)
+    {
+      return addPipeline(
+        name,
+        { shader_job },
+        [this, shader_name, entry_point, layout](VkPipelineCache cache)
+        {
+          VkComputePipelineCreateInfo create_info = {};
+          create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+          create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+          create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+          create_info.stage.module = shaderModule(shader_name);
+          create_info.stage.pName = entry_point.c_str();
+          create_info.layout = layout;
+
+          VkPipeline pipeline = VK_NULL_HANDLE;
+          if (vk->vkCreateComputePipelines(device, cache, 1, &create_info, allocator, &pipeline) != VK_SUCCESS)
+          {
+            return VkPipeline(VK_NULL_HANDLE);
+          }
+          return pipeline;
+        },
+        priority
+      );
+    }
+
+    VkShaderModule PipelineLibrary::shaderModule(std::string const &name) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<std::string, VkShaderModule>::const_iterator it = shader_modules.find(name);
+      return it != shader_modules.end() ? it->second : VK_NULL_HANDLE;
+    }
+
+    VkPipeline PipelineLibrary::pipeline(std::string const &name) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<std::string, VkPipeline>::const_iterator it = pipelines.find(name);
+      return it != pipelines.end() ? it->second : VK_NULL_HANDLE;
+    }
+
+    bool PipelineLibrary::shaderReflection(std::string const &name, ShaderReflection &reflection) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<std::string, ShaderReflection>::const_iterator it = reflections.find(name);
+      if (it == reflections.end())
+      {
+        return false;
+      }
+      reflection = it->second;
+      return true;
+    }
+
+    VkShaderModule PipelineLibrary::createShaderModule(
+      std::string const &name,
+      std::uint32_t const *code,
+      size_t size)
+    {
+      if (size < sizeof(std::uint32_t) || size % sizeof(std::uint32_t) != 0 || code[0] != SPIRV_MAGIC)
+      {
+        throw std::runtime_error("ERROR: Shader " + name + " is not SPIR-V");
+      }
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      VkShaderModuleCreateInfo create_info = {};
+      create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+      create_info.codeSize = size;
+      create_info.pCode = code;
+
+      VkShaderModule module = VK_NULL_HANDLE;
+      if (vk->vkCreateShaderModule(device, &create_info, allocator, &module) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create shader module " + name);
+      }
+      Debug::Trace("Shader module {} created in {} us", name, Clock::microsecondsSince(start));
+
+      std::lock_guard<std::mutex> lock(mutex);
+      VkShaderModule &slot = shader_modules[name];
+      if (slot != VK_NULL_HANDLE)
+      {
+        vk->vkDestroyShaderModule(device, slot, allocator);
+      }
+      slot = module;
+      return module;
+    }
+  }
+#endif
+
+}
@@ -0,0 +1,99 @@
+#ifndef PIPELINE_LIBRARY_H
+#define PIPELINE_LIBRARY_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "job_pool.h"
+#include "shader_reflection.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Shader modules and pipelines created by name on the job pool. Vulkan lets any number of threads create
+    // them at once, and the pipeline cache synchronizes itself, so they all share the one cache. A pipeline
+    // job depends on the jobs making its shader modules. Anything the first frame needs is submitted as
+    // Critical and waited for; the rest can finish while frames are already being drawn.
+    class PipelineLibrary
+    {
+    public:
+      // Runs on a worker, and throws on failure
+      using PipelineFactory = std::function<VkPipeline(VkPipelineCache pipeline_cache)>;
+
+      void init(
+        DeviceDispatch const &vk,
+        VkDevice device,
+        VkPipelineCache pipeline_cache,
+        VkAllocationCallbacks const *allocator,
+        Jobs::JobPool &job_pool
+      );
+      // Waits for every job still running, then destroys everything that was created
+      void destroy();
+
+      // SPIR-V read from spirv_path on the worker, along with the reflection the shader compiler left beside it
+      Jobs::Handle addShaderModule(
+        std::string const &name,
+        std::string const &spirv_path,
+        Jobs::Priority priority = Jobs::Priority::Background
+      );
+      Jobs::Handle addShaderModule(
+        std::string const &name,
+        std::vector<std::uint32_t> code,
+        Jobs::Priority priority = Jobs::Priority::Background
+      );
+      // dependencies should include the jobs making the shader modules factory looks up
+      Jobs::Handle addPipeline(
+        std::string const &name,
+        std::vector<Jobs::Handle> const &dependencies,
+        PipelineFactory factory,
+        Jobs::Priority priority = Jobs::Priority::Background
+      );
+      // entry_point names the compute function in the shader module, "main" for most compilers
+      Jobs::Handle addComputePipeline(
+        std::string const &name,
+        std::string const &shader_name,
+        std::string const &entry_point,
+        Jobs::Handle const &shader_job,
+        VkPipelineLayout layout,
+        Jobs::Priority priority = Jobs::Priority::Background
+      );
+
+      // VK_NULL_HANDLE until the job making it has finished
+      VkShaderModule shaderModule(std::string const &name) const;
+      VkPipeline pipeline(std::string const &name) const;
+      // False until the job making the module has finished, and for modules with no reflection file
+      bool shaderReflection(std::string const &name, ShaderReflection &reflection) const;
+
+      DeviceDispatch const &functions() const { return *vk; }
+      VkDevice deviceHandle() const { return device; }
+
+    private:
+      VkShaderModule createShaderModule(std::string const &name, std::uint32_t const *code, size_t size);
+
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+      Jobs::JobPool *job_pool = nullptr;
+
+      mutable std::mutex mutex;
+      std::map<std::string, VkShaderModule> shader_modules;
+      std::map<std::string, VkPipeline> pipelines;
+      std::map<std::string, ShaderReflection> reflections;
+      std::vector<Jobs::Handle> jobs;
+    };
+  }
+#endif
+
+}
+
+#endif // PIPELINE_LIBRARY_H
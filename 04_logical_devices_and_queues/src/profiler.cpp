@@ -0,0 +1,224 @@
+#include "profiler.h"
+
+#ifdef PROFILING
+
+#include "debug.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace Profiling
+{
+  namespace
+  {
+    struct Event
+    {
+      char const *name;
+      std::uint64_t start;
+      std::uint64_t end;
+    };
+
+    // Only the owning thread appends. count is published with release so the exporter sees whole events,
+    // and chunks are never moved or freed, so reading needs no lock on the recording side.
+    struct Chunk
+    {
+      static size_t constexpr CAPACITY = 4096;
+
+      Event events[CAPACITY];
+      std::atomic<size_t> count{ 0 };
+      std::atomic<Chunk *> next{ nullptr };
+    };
+
+  }
+
+  // Each thread records onto a track of its own
+  struct Track
+  {
+    std::uint32_t id = 0;
+    std::string name;   // Guarded by Registry::mutex
+    Chunk first;
+    Chunk *last = &first;
+    std::vector<std::unique_ptr<Chunk>> owned;
+  };
+
+  namespace
+  {
+    // Tracks outlive their threads so zones from finished workers still make it into the trace
+    struct Registry
+    {
+      std::mutex mutex;
+      std::vector<std::unique_ptr<Track>> tracks;
+      std::unordered_set<std::string> names;
+      std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+    };
+
+    Registry &registry()
+    {
+      static Registry instance;
+      return instance;
+    }
+
+    Track *createTrack(std::string name)
+    {
+      Registry &shared = registry();
+      std::lock_guard<std::mutex> lock(shared.mutex);
+      shared.tracks.push_back(std::make_unique<Track>());
+      Track *track = shared.tracks.back().get();
+      track->id = static_cast<std::uint32_t>(shared.tracks.size());
+      track->name = std::move(name);
+      return track;
+    }
+
+    Track &threadTrack()
+    {
+      thread_local Track *track = createTrack(std::string());
+      return *track;
+    }
+
+    void append(Track &track, char const *name, std::uint64_t start, std::uint64_t end)
+    {
+      Chunk *chunk = track.last;
+      size_t count = chunk->count.load(std::memory_order_relaxed);
+      if (count == Chunk::CAPACITY)
+      {
+        track.owned.push_back(std::make_unique<Chunk>());
+        Chunk *next = track.owned.back().get();
+        chunk->next.store(next, std::memory_order_release);
+        track.last = chunk = next;
+        count = 0;
+      }
+
+      chunk->events[count] = Event{ name, start, end };
+      chunk->count.store(count + 1, std::memory_order_release);
+    }
+
+    void writeEscaped(std::FILE *file, char const *text)
+    {
+      for (; *text != '\0'; ++text)
+      {
+        unsigned char c = static_cast<unsigned char>(*text);
+        if (c == '"' || c == '\\')
+        {
+          std::fprintf(file, "\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+          std::fprintf(file, "\\u%04x", c);
+        }
+        else
+        {
+          std::fputc(c, file);
+        }
+      }
+    }
+
+    // Trace event timestamps are in microseconds; the fraction keeps nanosecond precision
+    void writeMicroseconds(std::FILE *file, std::uint64_t nanoseconds)
+    {
+      std::fprintf(
+        file, "%llu.%03llu",
+        static_cast<unsigned long long>(nanoseconds / 1000),
+        static_cast<unsigned long long>(nanoseconds % 1000)
+      );
+    }
+  }
+
+  std::uint64_t now()
+  {
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - registry().start;
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+  void record(char const *name, std::uint64_t start, std::uint64_t end)
+  {
+    append(threadTrack(), name, start, end);
+  }
+
+  void setThreadName(std::string name)
+  {
+    Track &track = threadTrack();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    track.name = std::move(name);
+  }
+
+  char const *intern(std::string const &name)
+  {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    return shared.names.insert(name).first->c_str();
+  }
+
+  Track *addTrack(std::string name)
+  {
+    return createTrack(std::move(name));
+  }
+
+  void record(Track *track, char const *name, std::uint64_t start, std::uint64_t end)
+  {
+    append(*track, name, start, end);
+  }
+
+  bool writeChromeTrace(char const *path)
+  {
+    std::FILE *file = std::fopen(path, "wb");
+    if (file == nullptr)
+    {
+      Debug::Warning("Could not write the trace to {}", path);
+      return false;
+    }
+
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    size_t event_count = 0;
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    std::fputs("{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"", file);
+    std::fputs("04_logical_devices_and_queues\"}}", file);
+    for (std::unique_ptr<Track> const &track : shared.tracks)
+    {
+      if (!track->name.empty())
+      {
+        std::fprintf(file, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",", track->id);
+        std::fputs("\"args\":{\"name\":\"", file);
+        writeEscaped(file, track->name.c_str());
+        std::fputs("\"}}", file);
+      }
+
+      for (Chunk const *chunk = &track->first; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire))
+      {
+        size_t count = chunk->count.load(std::memory_order_acquire);
+        for (size_t i=0; i<count; ++i)
+        {
+          Event const &event = chunk->events[i];
+          std::fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"", track->id);
+          writeEscaped(file, event.name);
+          std::fputs("\",\"ts\":", file);
+          writeMicroseconds(file, event.start);
+          std::fputs(",\"dur\":", file);
+          writeMicroseconds(file, event.end - event.start);
+          std::fputs("}", file);
+        }
+        event_count += count;
+      }
+    }
+    std::fputs("\n]}\n", file);
+
+    bool written = std::fclose(file) == 0;
+    if (written)
+    {
+      Debug::Info("Wrote {} trace events on {} tracks to {}", event_count, shared.tracks.size(), path);
+    }
+    else
+    {
+      Debug::Warning("Could not write the trace to {}", path);
+    }
+    return written;
+  }
+}
+
+#endif
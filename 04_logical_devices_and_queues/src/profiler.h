@@ -0,0 +1,60 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+// Scoped zones recorded into per-thread buffers and written out as Chrome trace event JSON, which
+// chrome://tracing and ui.perfetto.dev both open. Configure with -DVTI_PROFILING=ON to record them;
+// otherwise every macro below compiles to nothing, arguments included.
+//
+//   PROFILE_ZONE("createInstance");     // Times the rest of the enclosing scope
+//   PROFILE_THREAD_NAME("Job worker");  // Labels the calling thread's track
+
+#ifdef PROFILING
+  #define PROFILE_CONCAT_INNER(a, b) a##b
+  #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+  #define PROFILE_ZONE(name) ::Profiling::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+  #define PROFILE_THREAD_NAME(name) ::Profiling::setThreadName(name)
+#else
+  #define PROFILE_ZONE(name) ((void)0)
+  #define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
+
+namespace Profiling
+{
+#ifdef PROFILING
+  std::uint64_t now();
+  // The name must outlive the export; string literals and intern() results do
+  void record(char const *name, std::uint64_t start, std::uint64_t end);
+  void setThreadName(std::string name);
+  // A stable copy of name, for zones named at run time
+  char const *intern(std::string const &name);
+
+  // A track of its own in the trace, for timings that don't come from a CPU thread, such as GPU work.
+  // Tracks live until exit, and only one thread at a time may record onto each.
+  struct Track;
+  Track *addTrack(std::string name);
+  void record(Track *track, char const *name, std::uint64_t start, std::uint64_t end);
+
+  class Zone
+  {
+  public:
+    explicit Zone(char const *name) : name(name), start(now()) {}
+    ~Zone() { record(name, start, now()); }
+    Zone(Zone const &) = delete;
+    Zone &operator=(Zone const &) = delete;
+
+  private:
+    char const *name;
+    std::uint64_t start;
+  };
+
+  // Writes every zone recorded so far. Zones still open on other threads are left out.
+  bool writeChromeTrace(char const *path);
+#else
+  inline bool writeChromeTrace(char const *) { return false; }
+#endif
+}
+
+#endif // PROFILER_H
@@ -0,0 +1,129 @@
+#include "queue_families.h"
+#include "debug.h"
+#include "profiler.h"
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    static QueueFamily makeQueueFamily(
+      std::vector<VkQueueFamilyProperties> const &queue_families,
+      std::uint32_t index)
+    {
+      QueueFamily family;
+      family.index = static_cast<int>(index);
+      family.queue_count = queue_families[index].queueCount;
+      family.timestamp_valid_bits = queue_families[index].timestampValidBits;
+      return family;
+    }
+
+    bool QueueFamily::isValid() const
+    {
+      return index >= 0;
+    }
+
+    bool QueueFamilyIndices::isComplete() const
+    {
+      #ifdef USING_GLFW
+        return graphics.isValid() && present.isValid();
+      #else
+        return graphics.isValid();
+      #endif
+    }
+
+    QueueFamilyIndices findQueueFamilies(InstanceDispatch const &vk, VkInstance instance, VkPhysicalDevice device)
+    {
+      PROFILE_ZONE("findQueueFamilies");
+      Debug::Trace("Finding Vulkan queue families from device");
+
+      std::uint32_t queue_family_count = 0;
+      vk.vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, nullptr);
+
+      std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+      vk.vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, queue_families.data());
+
+      return findQueueFamilies(queue_families, queryPresentSupport(instance, device, queue_family_count));
+    }
+
+    QueueFamilyIndices findQueueFamilies(
+      std::vector<VkQueueFamilyProperties> const &queue_families,
+      std::vector<VkBool32> const &present_support)
+    {
+      QueueFamilyIndices indices;
+
+      std::uint32_t queue_family_count = static_cast<std::uint32_t>(queue_families.size());
+      for (std::uint32_t i=0; i<queue_family_count; ++i)
+      {
+        VkQueueFamilyProperties const &queue_family = queue_families[i];
+        if (queue_family.queueCount == 0)
+        {
+          continue;
+        }
+
+        VkQueueFlags flags = queue_family.queueFlags;
+        bool can_present = i < present_support.size() && present_support[i];
+
+        // Graphics and present from one family saves an ownership transfer per frame, so such a family
+        // replaces a graphics family found earlier that can't present
+        if (flags & VK_QUEUE_GRAPHICS_BIT)
+        {
+          bool present_on_graphics = indices.present.isValid() && indices.present.index == indices.graphics.index;
+          if (!indices.graphics.isValid() || (can_present && !present_on_graphics))
+          {
+            indices.graphics = makeQueueFamily(queue_families, i);
+            if (can_present)
+            {
+              indices.present = indices.graphics;
+            }
+          }
+        }
+        else if (flags & VK_QUEUE_COMPUTE_BIT)
+        {
+          if (!indices.compute.isValid())
+          {
+            indices.compute = makeQueueFamily(queue_families, i);
+          }
+        }
+        else if (flags & VK_QUEUE_TRANSFER_BIT)
+        {
+          if (!indices.transfer.isValid())
+          {
+            indices.transfer = makeQueueFamily(queue_families, i);
+          }
+        }
+
+        if (can_present && !indices.present.isValid())
+        {
+          indices.present = makeQueueFamily(queue_families, i);
+        }
+      }
+
+      Debug::Trace(
+        "Found Vulkan queue families: graphics {}, transfer {}, compute {}, present {}",
+        indices.graphics.index,
+        indices.transfer.index,
+        indices.compute.index,
+        indices.present.index
+      );
+      return indices;
+    }
+
+    std::vector<VkBool32> queryPresentSupport(
+      [[maybe_unused]] VkInstance instance,
+      [[maybe_unused]] VkPhysicalDevice device,
+      std::uint32_t queue_family_count)
+    {
+      std::vector<VkBool32> present_support(queue_family_count, VK_FALSE);
+
+      // GLFW answers without a surface, so the device can be chosen before the window has one
+      #ifdef USING_GLFW
+        for (std::uint32_t i=0; i<queue_family_count; ++i)
+        {
+          present_support[i] = glfwGetPhysicalDevicePresentationSupport(instance, device, i) ? VK_TRUE : VK_FALSE;
+        }
+      #endif
+
+      return present_support;
+    }
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef QUEUE_FAMILIES_H
+#define QUEUE_FAMILIES_H
+
+#include "init.h"
+#include "dispatch.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    struct QueueFamily
+    {
+      int index = -1;
+      std::uint32_t queue_count = 0;
+      // 0 when the family's queues can't write timestamps
+      std::uint32_t timestamp_valid_bits = 0;
+
+      bool isValid() const;
+    };
+
+    struct QueueFamilyIndices
+    {
+      QueueFamily graphics;
+      // Transfer without graphics or compute, usually the GPU's DMA engines. Invalid when the device has none.
+      QueueFamily transfer;
+      // Compute without graphics, so compute work can overlap rendering. Invalid when the device has none.
+      QueueFamily compute;
+      // Can present to the window. Always invalid in headless builds.
+      QueueFamily present;
+
+      bool isComplete() const;
+    };
+
+    QueueFamilyIndices findQueueFamilies(InstanceDispatch const &vk, VkInstance instance, VkPhysicalDevice device);
+    QueueFamilyIndices findQueueFamilies(
+      std::vector<VkQueueFamilyProperties> const &queue_families,
+      std::vector<VkBool32> const &present_support
+    );
+    std::vector<VkBool32> queryPresentSupport(
+      VkInstance instance,
+      VkPhysicalDevice device,
+      std::uint32_t queue_family_count
+    );
+  }
+#endif
+
+}
+
+#endif // QUEUE_FAMILIES_H
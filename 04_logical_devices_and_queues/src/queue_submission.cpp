@@ -0,0 +1,388 @@
+#include "queue_submission.h"
+#include "debug.h"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef USING_VULKAN
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    void SyncPool::init(DeviceDispatch const &vk, VkDevice device, VkAllocationCallbacks const *allocator)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->allocator = allocator;
+    }
+
+    void SyncPool::destroy()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      Debug::Trace("Destroying {} pooled fences and {} pooled semaphores", fences.size(), semaphores.size());
+      if (free_fences.size() != fences.size() || free_semaphores.size() != semaphores.size())
+      {
+        Debug::Warning(
+          "{} fences and {} semaphores were still in use when the sync pool was destroyed",
+          fences.size() - free_fences.size(),
+          semaphores.size() - free_semaphores.size()
+        );
+      }
+
+      for (VkFence fence : fences)
+      {
+        vk->vkDestroyFence(device, fence, allocator);
+      }
+      for (VkSemaphore semaphore : semaphores)
+      {
+        vk->vkDestroySemaphore(device, semaphore, allocator);
+      }
+
+      fences.clear();
+      free_fences.clear();
+      semaphores.clear();
+      free_semaphores.clear();
+    }
+
+    VkFence SyncPool::acquireFence()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (!free_fences.empty())
+      {
+        VkFence fence = free_fences.back();
+        free_fences.pop_back();
+        return fence;
+      }
+
+      VkFenceCreateInfo fence_info = {};
+      fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+      VkFence fence = VK_NULL_HANDLE;
+      if (vk->vkCreateFence(device, &fence_info, allocator, &fence) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create pooled fence");
+      }
+      fences.push_back(fence);
+      return fence;
+    }
+
+    void SyncPool::releaseFence(VkFence fence)
+    {
+      vk->vkResetFences(device, 1, &fence);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      free_fences.push_back(fence);
+    }
+
+    VkSemaphore SyncPool::acquireSemaphore()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (!free_semaphores.empty())
+      {
+        VkSemaphore semaphore = free_semaphores.back();
+        free_semaphores.pop_back();
+        return semaphore;
+      }
+
+      VkSemaphoreCreateInfo semaphore_info = {};
+      semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+      VkSemaphore semaphore = VK_NULL_HANDLE;
+      if (vk->vkCreateSemaphore(device, &semaphore_info, allocator, &semaphore) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create pooled semaphore");
+      }
+      semaphores.push_back(semaphore);
+      return semaphore;
+    }
+
+    void SyncPool::releaseSemaphore(VkSemaphore semaphore)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      free_semaphores.push_back(semaphore);
+    }
+
+    size_t SyncPool::fenceCount() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return fences.size();
+    }
+
+    size_t SyncPool::semaphoreCount() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return semaphores.size();
+    }
+
+    void SubmitQueue::init(
+      InstanceDispatch const &instance_functions,
+      DeviceDispatch const &vk,
+      VkDevice device,
+      SyncPool &sync_pool,
+      VkQueue queue,
+      std::uint32_t family,
+      char const *name)
+    {
+      this->instance_functions = &instance_functions;
+      this->vk = &vk;
+      this->device = device;
+      this->sync_pool = &sync_pool;
+      this->queue = queue;
+      this->queue_family = family;
+      this->queue_name = name;
+    }
+
+    void SubmitQueue::destroy()
+    {
+      waitIdle();
+
+      std::lock_guard<std::mutex> lock(mutex);
+      size_t unflushed = 0;
+      for (auto const &thread_pending : pending)
+      {
+        unflushed += thread_pending.second.size();
+      }
+      if (unflushed > 0)
+      {
+        Debug::Warning("Dropping {} submissions never flushed to the {}", unflushed, queue_name);
+      }
+      pending.clear();
+
+      Debug::Trace("{}: {} submissions in {} batches", queue_name, submission_count, last_serial);
+    }
+
+    void SubmitQueue::enqueue(Submission submission)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending[std::this_thread::get_id()].push_back(std::move(submission));
+    }
+
+    SubmitTicket SubmitQueue::flush()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return flushLocked(std::this_thread::get_id());
+    }
+
+    SubmitTicket SubmitQueue::submit(Submission submission)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::thread::id const thread = std::this_thread::get_id();
+      pending[thread].push_back(std::move(submission));
+      return flushLocked(thread);
+    }
+
+    SubmitTicket SubmitQueue::flushLocked(std::thread::id thread)
+    {
+      collectLocked();
+
+      // Nothing of the caller's own to wait for, so the ticket is one that is already complete
+      auto const thread_pending = pending.find(thread);
+      if (thread_pending == pending.end())
+      {
+        return SubmitTicket{};
+      }
+      // The entry goes once flushed, so threads that have come and gone don't pile up in pending
+      std::vector<Submission> submissions = std::move(thread_pending->second);
+      pending.erase(thread_pending);
+
+      std::vector<VkSubmitInfo> submit_infos(submissions.size());
+      std::vector<VkTimelineSemaphoreSubmitInfoKHR> timeline_infos(submissions.size());
+      for (size_t i=0; i<submissions.size(); ++i)
+      {
+        Submission &submission = submissions[i];
+        VkSubmitInfo &submit_info = submit_infos[i];
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        if (!submission.wait_values.empty() || !submission.signal_values.empty())
+        {
+          submission.wait_values.resize(submission.wait_semaphores.size(), 0);
+          submission.signal_values.resize(submission.signal_semaphores.size(), 0);
+
+          VkTimelineSemaphoreSubmitInfoKHR &timeline_info = timeline_infos[i];
+          timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+          timeline_info.waitSemaphoreValueCount = static_cast<std::uint32_t>(submission.wait_values.size());
+          timeline_info.pWaitSemaphoreValues = submission.wait_values.data();
+          timeline_info.signalSemaphoreValueCount = static_cast<std::uint32_t>(submission.signal_values.size());
+          timeline_info.pSignalSemaphoreValues = submission.signal_values.data();
+          submit_info.pNext = &timeline_info;
+        }
+        submit_info.waitSemaphoreCount = static_cast<std::uint32_t>(submission.wait_semaphores.size());
+        submit_info.pWaitSemaphores = submission.wait_semaphores.data();
+        submit_info.pWaitDstStageMask = submission.wait_stages.data();
+        submit_info.commandBufferCount = static_cast<std::uint32_t>(submission.command_buffers.size());
+        submit_info.pCommandBuffers = submission.command_buffers.data();
+        submit_info.signalSemaphoreCount = static_cast<std::uint32_t>(submission.signal_semaphores.size());
+        submit_info.pSignalSemaphores = submission.signal_semaphores.data();
+      }
+
+      VkFence fence = sync_pool->acquireFence();
+
+      // Labelled here rather than by the caller, since the queue must not be touched outside the lock
+      if (instance_functions->vkQueueBeginDebugUtilsLabelEXT != nullptr)
+      {
+        VkDebugUtilsLabelEXT label = {};
+        label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+        label.pLabelName = queue_name;
+        instance_functions->vkQueueBeginDebugUtilsLabelEXT(queue, &label);
+      }
+
+      VkResult result = vk->vkQueueSubmit(
+        queue, static_cast<std::uint32_t>(submit_infos.size()), submit_infos.data(), fence
+      );
+
+      if (instance_functions->vkQueueEndDebugUtilsLabelEXT != nullptr)
+      {
+        instance_functions->vkQueueEndDebugUtilsLabelEXT(queue);
+      }
+
+      if (result != VK_SUCCESS)
+      {
+        sync_pool->releaseFence(fence);
+        throw std::runtime_error(std::string("ERROR: Failed to submit to the ") + queue_name);
+      }
+
+      Batch batch;
+      batch.fence = fence;
+      batch.serial = ++last_serial;
+      for (Submission const &submission : submissions)
+      {
+        batch.release_semaphores.insert(
+          batch.release_semaphores.end(),
+          submission.release_semaphores.begin(),
+          submission.release_semaphores.end()
+        );
+      }
+      in_flight.push_back(std::move(batch));
+
+      submission_count += submissions.size();
+
+      return SubmitTicket{ last_serial };
+    }
+
+    bool SubmitQueue::isComplete(SubmitTicket ticket)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      collectLocked();
+      return isCompleteLocked(ticket.serial);
+    }
+
+    void SubmitQueue::wait(SubmitTicket ticket)
+    {
+      waitFor(ticket.serial, ticket.serial);
+    }
+
+    void SubmitQueue::waitIdle()
+    {
+      std::uint64_t last;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        last = last_serial;
+      }
+      waitFor(1, last);
+    }
+
+    void SubmitQueue::waitFor(std::uint64_t first_serial, std::uint64_t last_serial)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      // Batches being waited on keep their fences out of the pool, so none is reset and reused mid-wait
+      std::vector<VkFence> fences;
+      for (Batch &batch : in_flight)
+      {
+        if (batch.serial >= first_serial && batch.serial <= last_serial)
+        {
+          ++batch.waiters;
+          fences.push_back(batch.fence);
+        }
+      }
+
+      if (!fences.empty())
+      {
+        // Other threads go on submitting to the queue while this one waits for the GPU
+        lock.unlock();
+        vk->vkWaitForFences(
+          device,
+          static_cast<std::uint32_t>(fences.size()),
+          fences.data(),
+          VK_TRUE,
+          std::numeric_limits<std::uint64_t>::max()
+        );
+        lock.lock();
+
+        for (Batch &batch : in_flight)
+        {
+          if (batch.serial >= first_serial && batch.serial <= last_serial)
+          {
+            --batch.waiters;
+          }
+        }
+      }
+
+      collectLocked();
+    }
+
+    void SubmitQueue::collect()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      collectLocked();
+    }
+
+    std::uint64_t SubmitQueue::submissionCount() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return submission_count;
+    }
+
+    std::uint64_t SubmitQueue::batchCount() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return last_serial;
+    }
+
+    void SubmitQueue::collectLocked()
+    {
+      size_t kept = 0;
+      for (size_t i=0; i<in_flight.size(); ++i)
+      {
+        Batch &batch = in_flight[i];
+        if (batch.waiters == 0 && vk->vkGetFenceStatus(device, batch.fence) == VK_SUCCESS)
+        {
+          sync_pool->releaseFence(batch.fence);
+          for (VkSemaphore semaphore : batch.release_semaphores)
+          {
+            sync_pool->releaseSemaphore(semaphore);
+          }
+        }
+        else
+        {
+          if (kept != i)
+          {
+            in_flight[kept] = std::move(batch);
+          }
+          ++kept;
+        }
+      }
+      in_flight.resize(kept);
+    }
+
+    bool SubmitQueue::isCompleteLocked(std::uint64_t serial) const
+    {
+      for (Batch const &batch : in_flight)
+      {
+        if (batch.serial == serial)
+        {
+          // Still here despite having finished when a thread is yet to return from waiting on it
+          return vk->vkGetFenceStatus(device, batch.fence) == VK_SUCCESS;
+        }
+      }
+      return true;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef QUEUE_SUBMISSION_H
+#define QUEUE_SUBMISSION_H
+
+#include "init.h"
+#include "dispatch.h"
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Fences and binary semaphores handed out and taken back instead of being created for every submit.
+    // Everything the pool ever created is destroyed with it.
+    class SyncPool
+    {
+    public:
+      void init(DeviceDispatch const &vk, VkDevice device, VkAllocationCallbacks const *allocator);
+      void destroy();
+
+      // Unsignaled
+      VkFence acquireFence();
+      // Takes a fence that is signaled or was never submitted, and resets it
+      void releaseFence(VkFence fence);
+      VkSemaphore acquireSemaphore();
+      // Only once no pending submission waits on or signals it
+      void releaseSemaphore(VkSemaphore semaphore);
+
+      size_t fenceCount() const;
+      size_t semaphoreCount() const;
+
+    private:
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+
+      mutable std::mutex mutex;
+      std::vector<VkFence> fences;
+      std::vector<VkFence> free_fences;
+      std::vector<VkSemaphore> semaphores;
+      std::vector<VkSemaphore> free_semaphores;
+    };
+
+    // One VkSubmitInfo worth of work
+    struct Submission
+    {
+      std::vector<VkCommandBuffer> command_buffers;
+      std::vector<VkSemaphore> wait_semaphores;
+      std::vector<VkPipelineStageFlags> wait_stages; // One per wait semaphore
+      std::vector<VkSemaphore> signal_semaphores;
+      // Timeline semaphore values, one per wait or signal semaphore, once any of them is a timeline semaphore.
+      // Binary semaphores ignore theirs; missing trailing values count as 0.
+      std::vector<std::uint64_t> wait_values;
+      std::vector<std::uint64_t> signal_values;
+      // Pooled semaphores to give back once the batch completes, typically the ones waited on
+      std::vector<VkSemaphore> release_semaphores;
+    };
+
+    // Completes when every submission in the batch it was returned for has finished on the GPU. A default
+    // constructed ticket belongs to no batch and is always complete.
+    struct SubmitTicket
+    {
+      std::uint64_t serial = 0;
+    };
+
+    // All submissions to one VkQueue go through one of these, which also provides the external
+    // synchronization Vulkan requires for the queue. Each thread enqueues into a batch of its own, and a flush
+    // submits the calling thread's batch as a single vkQueueSubmit with a single pooled fence, so one thread
+    // flushing never submits work another thread is still putting together. Waiting on a ticket doesn't hold
+    // the queue's lock, so other threads keep submitting meanwhile.
+    class SubmitQueue
+    {
+    public:
+      void init(
+        InstanceDispatch const &instance_functions,
+        DeviceDispatch const &vk,
+        VkDevice device,
+        SyncPool &sync_pool,
+        VkQueue queue,
+        std::uint32_t family,
+        char const *name
+      );
+      // Waits for everything in flight and returns its fences and semaphores to the pool
+      void destroy();
+
+      VkQueue handle() const { return queue; }
+      std::uint32_t family() const { return queue_family; }
+      char const *name() const { return queue_name; }
+
+      // Into the calling thread's batch
+      void enqueue(Submission submission);
+      // Submits everything the calling thread enqueued since its last flush. With nothing enqueued, the ticket
+      // is already complete.
+      SubmitTicket flush();
+      // Adds submission to the calling thread's batch and flushes it
+      SubmitTicket submit(Submission submission);
+
+      bool isComplete(SubmitTicket ticket);
+      void wait(SubmitTicket ticket);
+      void waitIdle();
+      // Recycles the fences and semaphores of batches that have finished. flush() also does this.
+      void collect();
+
+      std::uint64_t submissionCount() const;
+      std::uint64_t batchCount() const;
+
+    private:
+      struct Batch
+      {
+        VkFence fence;
+        std::uint64_t serial;
+        std::vector<VkSemaphore> release_semaphores;
+        std::uint32_t waiters = 0; // Threads waiting on fence, which is kept out of the pool until they're done
+      };
+
+      SubmitTicket flushLocked(std::thread::id thread);
+      // For the batches with serials from first_serial to last_serial
+      void waitFor(std::uint64_t first_serial, std::uint64_t last_serial);
+      void collectLocked();
+      bool isCompleteLocked(std::uint64_t serial) const;
+
+      InstanceDispatch const *instance_functions = nullptr;
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      SyncPool *sync_pool = nullptr;
+      VkQueue queue = VK_NULL_HANDLE;
+      std::uint32_t queue_family = 0;
+      char const *queue_name = "";
+
+      mutable std::mutex mutex;
+      std::unordered_map<std::thread::id, std::vector<Submission>> pending; // By the thread that enqueued them
+      std::vector<Batch> in_flight;
+      std::uint64_t last_serial = 0;
+      std::uint64_t submission_count = 0;
+    };
+  }
+#endif
+
+}
+
+#endif // QUEUE_SUBMISSION_H
@@ -0,0 +1,209 @@
+#include "shader_reflection.h"
+#include "file_io.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Fixed size records, so loading is a copy out of the mapped file
+    struct ReflectionFileHeader
+    {
+      char magic[8];
+      std::uint32_t version;
+      std::uint32_t stages;
+      std::uint32_t binding_count;
+      std::uint32_t push_constant_count;
+    };
+
+    struct ReflectionFileBinding
+    {
+      std::uint32_t set;
+      std::uint32_t binding;
+      std::uint32_t type;
+      std::uint32_t count;
+      std::uint32_t stages;
+    };
+
+    static char const FILE_MAGIC[8] = { 'v', 't', 'i', 'r', 'e', 'f', 'l', '\0' };
+    static std::uint32_t constexpr FILE_VERSION = 1;
+
+    void ShaderReflection::merge(ShaderReflection const &other)
+    {
+      for (ShaderBinding const &incoming : other.bindings)
+      {
+        auto found = std::find_if(bindings.begin(), bindings.end(), [&incoming](ShaderBinding const &binding)
+        {
+          return binding.set == incoming.set && binding.binding == incoming.binding;
+        });
+        if (found == bindings.end())
+        {
+          bindings.push_back(incoming);
+          continue;
+        }
+        if (found->type != incoming.type || found->count != incoming.count)
+        {
+          throw std::runtime_error(
+            "ERROR: Shader stages disagree on set " + std::to_string(incoming.set) +
+            " binding " + std::to_string(incoming.binding)
+          );
+        }
+        found->stages |= incoming.stages;
+      }
+      std::sort(bindings.begin(), bindings.end(), [](ShaderBinding const &a, ShaderBinding const &b)
+      {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+      });
+
+      // Stages reading the same block share a range
+      for (VkPushConstantRange const &incoming : other.push_constants)
+      {
+        auto found = std::find_if(
+          push_constants.begin(), push_constants.end(), [&incoming](VkPushConstantRange const &range)
+          {
+            return range.offset == incoming.offset && range.size == incoming.size;
+          }
+        );
+        if (found != push_constants.end())
+        {
+          found->stageFlags |= incoming.stageFlags;
+        }
+        else
+        {
+          push_constants.push_back(incoming);
+        }
+      }
+
+      stages |= other.stages;
+    }
+
+    std::uint32_t ShaderReflection::setCount() const
+    {
+      return bindings.empty() ? 0 : bindings.back().set + 1;
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::setBindings(std::uint32_t set) const
+    {
+      std::vector<VkDescriptorSetLayoutBinding> layout_bindings;
+      for (ShaderBinding const &binding : bindings)
+      {
+        if (binding.set == set)
+        {
+          VkDescriptorSetLayoutBinding layout_binding = {};
+          layout_binding.binding = binding.binding;
+          layout_binding.descriptorType = binding.type;
+          layout_binding.descriptorCount = binding.count;
+          layout_binding.stageFlags = binding.stages;
+          layout_bindings.push_back(layout_binding);
+        }
+      }
+      return layout_bindings;
+    }
+
+    std::string reflectionPath(std::string const &spirv_path)
+    {
+      size_t const size = spirv_path.size();
+      if (size > 4 && spirv_path.compare(size - 4, 4, ".spv") == 0)
+      {
+        return spirv_path.substr(0, size - 4) + ".refl";
+      }
+      return spirv_path + ".refl";
+    }
+
+    ReflectionFileStatus loadShaderReflection(std::string const &path, ShaderReflection &reflection, char const *&why)
+    {
+      File::MappedFile file;
+      if (!file.open(path))
+      {
+        why = "missing";
+        return ReflectionFileStatus::Missing;
+      }
+
+      ReflectionFileHeader header;
+      if (file.size() < sizeof(header))
+      {
+        why = "too small";
+        return ReflectionFileStatus::Invalid;
+      }
+      std::memcpy(&header, file.data(), sizeof(header));
+      if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION)
+      {
+        why = "not a reflection file of this version";
+        return ReflectionFileStatus::Invalid;
+      }
+      if (file.size() != sizeof(header) +
+        std::uint64_t(header.binding_count) * sizeof(ReflectionFileBinding) +
+        std::uint64_t(header.push_constant_count) * sizeof(VkPushConstantRange))
+      {
+        why = "truncated";
+        return ReflectionFileStatus::Invalid;
+      }
+
+      std::uint8_t const *next = static_cast<std::uint8_t const *>(file.data()) + sizeof(header);
+      reflection = ShaderReflection();
+      reflection.stages = header.stages;
+      reflection.bindings.resize(header.binding_count);
+      for (ShaderBinding &binding : reflection.bindings)
+      {
+        ReflectionFileBinding record;
+        std::memcpy(&record, next, sizeof(record));
+        next += sizeof(record);
+        binding.set = record.set;
+        binding.binding = record.binding;
+        binding.type = static_cast<VkDescriptorType>(record.type);
+        binding.count = record.count;
+        binding.stages = record.stages;
+      }
+      reflection.push_constants.resize(header.push_constant_count);
+      if (header.push_constant_count > 0)
+      {
+        std::memcpy(reflection.push_constants.data(), next, header.push_constant_count * sizeof(VkPushConstantRange));
+      }
+      return ReflectionFileStatus::Loaded;
+    }
+
+    bool saveShaderReflection(std::string const &path, ShaderReflection const &reflection)
+    {
+      ReflectionFileHeader header = {};
+      std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+      header.version = FILE_VERSION;
+      header.stages = reflection.stages;
+      header.binding_count = static_cast<std::uint32_t>(reflection.bindings.size());
+      header.push_constant_count = static_cast<std::uint32_t>(reflection.push_constants.size());
+
+      std::string const temporary_path = File::temporaryPath(path);
+      bool written;
+      {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        for (ShaderBinding const &binding : reflection.bindings)
+        {
+          ReflectionFileBinding const record = {
+            binding.set, binding.binding, static_cast<std::uint32_t>(binding.type), binding.count, binding.stages
+          };
+          file.write(reinterpret_cast<char const *>(&record), sizeof(record));
+        }
+        file.write(
+          reinterpret_cast<char const *>(reflection.push_constants.data()),
+          reflection.push_constants.size() * sizeof(VkPushConstantRange)
+        );
+        written = static_cast<bool>(file.flush());
+      }
+      if (!written)
+      {
+        std::remove(temporary_path.c_str());
+        return false;
+      }
+      return File::replaceFile(temporary_path, path);
+    }
+  }
+#endif
+
+}
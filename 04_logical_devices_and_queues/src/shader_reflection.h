@@ -0,0 +1,65 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include "init.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    struct ShaderBinding
+    {
+      std::uint32_t set = 0;
+      std::uint32_t binding = 0;
+      VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+      // 0 for a runtime sized array, whose length the pipeline layout decides
+      std::uint32_t count = 1;
+      VkShaderStageFlags stages = 0;
+    };
+
+    // The resource interface of one or more shader stages, as the shader compiler records it beside each
+    // SPIR-V file, so pipeline layouts come from a file read rather than from parsing SPIR-V at runtime
+    struct ShaderReflection
+    {
+      VkShaderStageFlags stages = 0;
+      // Sorted by set, then binding
+      std::vector<ShaderBinding> bindings;
+      // At most one range per stage, as vkCreatePipelineLayout requires
+      std::vector<VkPushConstantRange> push_constants;
+
+      // Adds other's stages, throwing where the two declare one binding with different types or counts
+      void merge(ShaderReflection const &other);
+      // One past the highest set used
+      std::uint32_t setCount() const;
+      std::vector<VkDescriptorSetLayoutBinding> setBindings(std::uint32_t set) const;
+    };
+
+    // Where the reflection of the SPIR-V at spirv_path is kept: the same path with .refl for .spv
+    std::string reflectionPath(std::string const &spirv_path);
+    enum class ReflectionFileStatus
+    {
+      Loaded,
+      Missing,
+      Invalid // Not a reflection file of this version, or cut short
+    };
+
+    // Invalid comes with the reason in why, for logging
+    ReflectionFileStatus loadShaderReflection(
+      std::string const &path,
+      ShaderReflection &reflection,
+      char const *&why
+    );
+    // Written to a temporary file first and moved over path
+    bool saveShaderReflection(std::string const &path, ShaderReflection const &reflection);
+  }
+#endif
+
+}
+
+#endif // SHADER_REFLECTION_H
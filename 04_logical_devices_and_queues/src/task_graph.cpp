@@ -0,0 +1,270 @@
+#include "task_graph.h"
+#include "debug.h"
+#include "profiler.h"
+#include "clock.h"
+
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace Jobs
+{
+  TaskGraph::Node TaskGraph::add(
+    std::string name,
+    std::vector<Node> const &dependencies,
+    std::function<void()> function,
+    Affinity affinity)
+  {
+    Node node = tasks.size();
+    for (Node dependency : dependencies)
+    {
+      if (dependency >= node)
+      {
+        throw std::runtime_error("ERROR: Task " + name + " depends on a task added after it");
+      }
+    }
+
+    Task task;
+    task.name = std::move(name);
+    task.dependencies = dependencies;
+    #ifdef PROFILING
+      // Each task also shows up as a zone of its own in the trace
+      char const *zone_name = Profiling::intern(task.name);
+      task.function = [zone_name, function = std::move(function)]()
+      {
+        PROFILE_ZONE(zone_name);
+        function();
+      };
+    #else
+      task.function = std::move(function);
+    #endif
+    task.affinity = affinity;
+    task.timing = Timing{ task.name, 0, 0, affinity, false };
+    tasks.push_back(std::move(task));
+    return node;
+  }
+
+  void TaskGraph::run(JobPool &job_pool)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::exception_ptr first_error;
+
+    // Submits every worker task whose caller dependencies have run; worker dependencies are left to the pool
+    auto submitReady = [&]()
+    {
+      for (Task &task : tasks)
+      {
+        if (task.affinity != Affinity::Worker || task.submitted || task.failed)
+        {
+          continue;
+        }
+
+        std::vector<Handle> handles;
+        bool ready = true;
+        for (Node dependency : task.dependencies)
+        {
+          Task const &required = tasks[dependency];
+          if (required.failed)
+          {
+            task.failed = true;
+            ready = false;
+            break;
+          }
+          if (!required.submitted)
+          {
+            ready = false;
+            break;
+          }
+          handles.push_back(required.handle);
+        }
+        if (!ready)
+        {
+          continue;
+        }
+
+        Timing *timing = &task.timing;
+        std::function<void()> *function = &task.function;
+        task.handle = job_pool.submit(
+          [timing, function, start]()
+          {
+            timing->start_us = Clock::microsecondsSince(start);
+            timing->ran = true;
+            try
+            {
+              (*function)();
+            }
+            catch (...)
+            {
+              timing->end_us = Clock::microsecondsSince(start);
+              throw;
+            }
+            timing->end_us = Clock::microsecondsSince(start);
+          },
+          handles,
+          Priority::Critical
+        );
+        task.submitted = true;
+      }
+    };
+
+    submitReady();
+    for (Task &task : tasks)
+    {
+      if (task.affinity != Affinity::Caller)
+      {
+        continue;
+      }
+
+      for (Node dependency : task.dependencies)
+      {
+        Task const &required = tasks[dependency];
+        if (required.failed)
+        {
+          task.failed = true;
+          break;
+        }
+        try
+        {
+          job_pool.wait(required.handle);
+        }
+        catch (...)
+        {
+          task.failed = true;
+          break;
+        }
+      }
+
+      if (!task.failed)
+      {
+        task.timing.start_us = Clock::microsecondsSince(start);
+        task.timing.ran = true;
+        try
+        {
+          task.function();
+        }
+        catch (...)
+        {
+          task.failed = true;
+          if (!first_error)
+          {
+            first_error = std::current_exception();
+          }
+        }
+        task.timing.end_us = Clock::microsecondsSince(start);
+      }
+      // Caller tasks count as submitted once done, so worker tasks depending on them can go
+      task.submitted = true;
+
+      submitReady();
+    }
+
+    for (Task &task : tasks)
+    {
+      try
+      {
+        job_pool.wait(task.handle);
+      }
+      catch (...)
+      {
+        if (!first_error)
+        {
+          first_error = std::current_exception();
+        }
+      }
+      task.function = nullptr;
+    }
+
+    total_us = Clock::microsecondsSince(start);
+
+    if (first_error)
+    {
+      std::rethrow_exception(first_error);
+    }
+  }
+
+  std::vector<TaskGraph::Timing> TaskGraph::timings() const
+  {
+    std::vector<Timing> result;
+    for (Task const &task : tasks)
+    {
+      result.push_back(task.timing);
+    }
+    return result;
+  }
+
+  std::vector<TaskGraph::Node> TaskGraph::criticalPath() const
+  {
+    std::vector<Node> path;
+    if (tasks.empty())
+    {
+      return path;
+    }
+
+    Node last = 0;
+    for (Node node=1; node<tasks.size(); ++node)
+    {
+      if (tasks[node].timing.end_us > tasks[last].timing.end_us)
+      {
+        last = node;
+      }
+    }
+
+    // Walks back through whichever dependency held each task up the longest
+    for (Node node = last;;)
+    {
+      path.insert(path.begin(), node);
+      std::vector<Node> const &dependencies = tasks[node].dependencies;
+      if (dependencies.empty())
+      {
+        break;
+      }
+      Node latest = dependencies.front();
+      for (Node dependency : dependencies)
+      {
+        if (tasks[dependency].timing.end_us > tasks[latest].timing.end_us)
+        {
+          latest = dependency;
+        }
+      }
+      node = latest;
+    }
+    return path;
+  }
+
+  void TaskGraph::logTimings() const
+  {
+    std::int64_t busy_us = 0;
+    for (Task const &task : tasks)
+    {
+      if (!task.timing.ran)
+      {
+        Debug::Trace("  {}: skipped", task.name);
+        continue;
+      }
+      std::int64_t duration_us = task.timing.end_us - task.timing.start_us;
+      busy_us += duration_us;
+      Debug::Trace(
+        "  {}: {} us, from {} us{}",
+        task.name,
+        duration_us,
+        task.timing.start_us,
+        task.affinity == Affinity::Caller ? " on the calling thread" : ""
+      );
+    }
+
+    std::string path;
+    for (Node node : criticalPath())
+    {
+      if (!path.empty())
+      {
+        path += " -> ";
+      }
+      path += tasks[node].name;
+    }
+
+    Debug::Info("{} tasks took {} us, {} us if run one after another", tasks.size(), total_us, busy_us);
+    Debug::Info("Critical path: {}", path);
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include "job_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Jobs
+{
+  // A one-shot set of named tasks with dependencies, run on a job pool so independent tasks overlap.
+  // Each task's wall time is recorded, along with the chain of tasks that decided the total time.
+  class TaskGraph
+  {
+  public:
+    using Node = size_t;
+
+    enum class Affinity : std::uint8_t
+    {
+      Worker,
+      Caller // Runs on the thread calling run(), for APIs tied to the main thread such as GLFW
+    };
+
+    struct Timing
+    {
+      std::string name;
+      std::int64_t start_us; // From the start of run()
+      std::int64_t end_us;
+      Affinity affinity;
+      bool ran;
+    };
+
+    // Dependencies must have been added before, which keeps the graph acyclic
+    Node add(
+      std::string name,
+      std::vector<Node> const &dependencies,
+      std::function<void()> function,
+      Affinity affinity = Affinity::Worker
+    );
+
+    // Caller tasks run in the order they were added, each once its dependencies are done. Returns once
+    // every task has finished or been skipped because a dependency failed, rethrowing the first failure.
+    void run(JobPool &job_pool);
+
+    std::vector<Timing> timings() const;
+    // The tasks, first to last, on the dependency chain that finished last
+    std::vector<Node> criticalPath() const;
+    void logTimings() const;
+
+  private:
+    struct Task
+    {
+      std::string name;
+      std::vector<Node> dependencies;
+      std::function<void()> function;
+      Affinity affinity;
+      Handle handle;
+      bool submitted = false;
+      bool failed = false;  // Caller tasks only; worker failures travel through the job pool
+      Timing timing;
+    };
+
+    std::vector<Task> tasks;
+    std::int64_t total_us = 0;
+  };
+}
+
+#endif // TASK_GRAPH_H
@@ -0,0 +1,697 @@
+#include "transfer_engine.h"
+#include "profiler.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    double TransferEngine::Stats::throughputMBps() const
+    {
+      return busy_seconds > 0.0 ? static_cast<double>(bytes_completed) / busy_seconds / 1.0e6 : 0.0;
+    }
+
+    void TransferEngine::init(
+      DeviceDispatch const &vk,
+      VkDevice device,
+      VkAllocationCallbacks const *allocator,
+      DeviceMemoryAllocator &memory_allocator,
+      SubmitQueue &transfer_queue,
+      VkPhysicalDeviceLimits const &limits,
+      std::uint32_t consumer_family,
+      bool timeline_semaphores,
+      VkDeviceSize staging_size)
+    {
+      this->vk = &vk;
+      this->device = device;
+      this->allocator = allocator;
+      this->transfer_queue = &transfer_queue;
+      this->consumer_family = consumer_family;
+      transfer_family = transfer_queue.family();
+      // Buffer to image copies also want offsets in multiples of 4 and of the texel block size, which 16
+      // covers for every format with a power of two block size
+      copy_alignment = std::max<VkDeviceSize>(limits.optimalBufferCopyOffsetAlignment, 16);
+
+      VkBufferCreateInfo buffer_info = {};
+      buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      buffer_info.size = staging_size;
+      buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+      buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      if (vk.vkCreateBuffer(device, &buffer_info, allocator, &staging_buffer) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to create the staging buffer");
+      }
+
+      VkMemoryRequirements requirements;
+      vk.vkGetBufferMemoryRequirements(device, staging_buffer, &requirements);
+      // Coherent, so writes through the mapping need no flush before the copy is submitted
+      staging.init(
+        memory_allocator,
+        std::max(staging_size, requirements.size),
+        requirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+      );
+      DeviceAllocation const *memory = staging.allocation();
+      if (memory == nullptr || memory->mapped == nullptr)
+      {
+        throw std::runtime_error("ERROR: Failed to allocate mapped staging memory");
+      }
+      if (vk.vkBindBufferMemory(device, staging_buffer, memory->memory, memory->offset) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to bind the staging buffer memory");
+      }
+
+      if (timeline_semaphores && vk.vkWaitSemaphoresKHR != nullptr && vk.vkGetSemaphoreCounterValueKHR != nullptr)
+      {
+        VkSemaphoreTypeCreateInfoKHR type_info = {};
+        type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+        type_info.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphore_info = {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext = &type_info;
+        if (vk.vkCreateSemaphore(device, &semaphore_info, allocator, &timeline) != VK_SUCCESS)
+        {
+          throw std::runtime_error("ERROR: Failed to create the transfer timeline semaphore");
+        }
+      }
+
+      Debug::Trace(
+        "Transfer engine on queue family {} for family {}: {} MiB staging ring, {}",
+        transfer_family,
+        consumer_family,
+        staging.capacity() / (1024 * 1024),
+        timeline != VK_NULL_HANDLE ? "timeline semaphore" : "host waits without timeline semaphores"
+      );
+    }
+
+    void TransferEngine::destroy()
+    {
+      if (vk == nullptr)
+      {
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      flushLocked();
+      while (!in_flight.empty())
+      {
+        waitOldestLocked();
+      }
+
+      if (!pending_acquires.empty())
+      {
+        Debug::Warning(
+          "{} uploads were released to another queue family and never acquired", pending_acquires.size()
+        );
+        pending_acquires.clear();
+      }
+
+      for (Batch const &batch : free_batches)
+      {
+        vk->vkDestroyCommandPool(device, batch.command_pool, allocator);
+      }
+      free_batches.clear();
+      if (open.command_pool != VK_NULL_HANDLE)
+      {
+        vk->vkDestroyCommandPool(device, open.command_pool, allocator);
+      }
+      open = Batch();
+
+      if (timeline != VK_NULL_HANDLE)
+      {
+        vk->vkDestroySemaphore(device, timeline, allocator);
+        timeline = VK_NULL_HANDLE;
+      }
+      vk->vkDestroyBuffer(device, staging_buffer, allocator);
+      staging_buffer = VK_NULL_HANDLE;
+      staging.destroy();
+      vk = nullptr;
+    }
+
+    UploadTicket TransferEngine::upload(BufferUpload const &upload)
+    {
+      PROFILE_ZONE("Stage buffer upload");
+
+      std::uint32_t const family = resolveFamily(upload.dst_family);
+      char const *data = static_cast<char const *>(upload.data);
+      if (upload.size > 0 && data == nullptr && upload.src_buffer == VK_NULL_HANDLE)
+      {
+        throw std::runtime_error(
+          "ERROR: Buffer upload of " + std::to_string(upload.size) + " bytes has no data or source buffer"
+        );
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (upload.size == 0)
+      {
+        return UploadTicket{ open_recording ? open.value : submitted_value };
+      }
+
+      if (upload.src_buffer != VK_NULL_HANDLE)
+      {
+        Batch &batch = openBatchLocked();
+        VkBufferCopy region = {};
+        region.srcOffset = upload.src_offset;
+        region.dstOffset = upload.offset;
+        region.size = upload.size;
+        vk->vkCmdCopyBuffer(batch.command_buffer, upload.src_buffer, upload.buffer, 1, &region);
+        batch.bytes += upload.size;
+      }
+      else
+      {
+        VkDeviceSize const max_chunk = std::max(staging.capacity() / MAX_CHUNK_FRACTION, copy_alignment);
+        for (VkDeviceSize done=0; done<upload.size; )
+        {
+          VkDeviceSize chunk = std::min(upload.size - done, max_chunk);
+          RingAllocator::Range range = stageLocked(chunk, copy_alignment);
+          std::memcpy(range.mapped, data + done, static_cast<size_t>(chunk));
+
+          Batch &batch = openBatchLocked();
+          VkBufferCopy region = {};
+          region.srcOffset = range.offset - staging.allocation()->offset;
+          region.dstOffset = upload.offset + done;
+          region.size = chunk;
+          vk->vkCmdCopyBuffer(batch.command_buffer, staging_buffer, upload.buffer, 1, &region);
+
+          batch.bytes += chunk;
+          done += chunk;
+        }
+      }
+      ++open.uploads;
+      ++totals.uploads;
+
+      // Within one family the timeline semaphore alone orders the copy before its consumers
+      if (family != transfer_family)
+      {
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = transfer_family;
+        barrier.dstQueueFamilyIndex = family;
+        barrier.buffer = upload.buffer;
+        barrier.offset = upload.offset;
+        barrier.size = upload.size;
+        release_buffer_barriers.push_back(barrier);
+
+        PendingAcquire acquire = {};
+        acquire.value = open.value;
+        acquire.family = family;
+        acquire.dst_stages = upload.dst_stages;
+        acquire.is_image = false;
+        acquire.buffer_barrier = barrier;
+        acquire.buffer_barrier.srcAccessMask = 0;
+        acquire.buffer_barrier.dstAccessMask = upload.dst_access;
+        pending_acquires.push_back(acquire);
+      }
+
+      return UploadTicket{ open.value };
+    }
+
+    UploadTicket TransferEngine::upload(ImageUpload const &upload)
+    {
+      PROFILE_ZONE("Stage image upload");
+
+      std::uint32_t const family = resolveFamily(upload.dst_family);
+      if (upload.size > 0 && upload.data == nullptr && upload.src_buffer == VK_NULL_HANDLE)
+      {
+        throw std::runtime_error(
+          "ERROR: Image upload of " + std::to_string(upload.size) + " bytes has no data or source buffer"
+        );
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (upload.size == 0)
+      {
+        return UploadTicket{ open_recording ? open.value : submitted_value };
+      }
+      VkBuffer source = upload.src_buffer;
+      VkDeviceSize source_offset = upload.src_offset;
+      if (source == VK_NULL_HANDLE)
+      {
+        if (upload.size > staging.capacity())
+        {
+          throw std::runtime_error(
+            "ERROR: Image upload of " + std::to_string(upload.size) + " bytes is larger than the staging ring"
+          );
+        }
+
+        RingAllocator::Range range = stageLocked(upload.size, copy_alignment);
+        std::memcpy(range.mapped, upload.data, static_cast<size_t>(upload.size));
+        source = staging_buffer;
+        source_offset = range.offset - staging.allocation()->offset;
+      }
+
+      Batch &batch = openBatchLocked();
+
+      VkImageSubresourceRange subresource_range = {};
+      subresource_range.aspectMask = upload.subresource.aspectMask;
+      subresource_range.baseMipLevel = upload.subresource.mipLevel;
+      subresource_range.levelCount = 1;
+      subresource_range.baseArrayLayer = upload.subresource.baseArrayLayer;
+      subresource_range.layerCount = upload.subresource.layerCount;
+
+      VkImageMemoryBarrier to_transfer_dst = {};
+      to_transfer_dst.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      to_transfer_dst.srcAccessMask = 0;
+      to_transfer_dst.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      to_transfer_dst.oldLayout = upload.old_layout;
+      to_transfer_dst.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      to_transfer_dst.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      to_transfer_dst.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      to_transfer_dst.image = upload.image;
+      to_transfer_dst.subresourceRange = subresource_range;
+      vk->vkCmdPipelineBarrier(
+        batch.command_buffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &to_transfer_dst
+      );
+
+      VkBufferImageCopy region = {};
+      region.bufferOffset = source_offset;
+      region.imageSubresource = upload.subresource;
+      region.imageOffset = upload.offset;
+      region.imageExtent = upload.extent;
+      vk->vkCmdCopyBufferToImage(
+        batch.command_buffer, source, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region
+      );
+
+      batch.bytes += upload.size;
+      ++batch.uploads;
+      ++totals.uploads;
+
+      // The final layout transition doubles as the release when the consumer is in another family
+      bool const transfers_ownership = family != transfer_family;
+      VkImageMemoryBarrier release = {};
+      release.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      release.dstAccessMask = 0;
+      release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      release.newLayout = upload.final_layout;
+      release.srcQueueFamilyIndex = transfers_ownership ? transfer_family : VK_QUEUE_FAMILY_IGNORED;
+      release.dstQueueFamilyIndex = transfers_ownership ? family : VK_QUEUE_FAMILY_IGNORED;
+      release.image = upload.image;
+      release.subresourceRange = subresource_range;
+      release_image_barriers.push_back(release);
+
+      if (transfers_ownership)
+      {
+        PendingAcquire acquire = {};
+        acquire.value = batch.value;
+        acquire.family = family;
+        acquire.dst_stages = upload.dst_stages;
+        acquire.is_image = true;
+        acquire.image_barrier = release;
+        acquire.image_barrier.srcAccessMask = 0;
+        acquire.image_barrier.dstAccessMask = upload.dst_access;
+        pending_acquires.push_back(acquire);
+      }
+
+      return UploadTicket{ batch.value };
+    }
+
+    UploadTicket TransferEngine::flush()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      UploadTicket ticket = flushLocked();
+      collectLocked();
+      return ticket;
+    }
+
+    bool TransferEngine::isComplete(UploadTicket ticket)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      collectLocked();
+      return ticket.value <= completed_value;
+    }
+
+    void TransferEngine::wait(UploadTicket ticket)
+    {
+      SubmitTicket submit_ticket;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ticket.value > submitted_value)
+        {
+          flushLocked();
+        }
+        collectLocked();
+        if (ticket.value <= completed_value)
+        {
+          return;
+        }
+
+        for (Batch const &batch : in_flight)
+        {
+          if (batch.value == ticket.value)
+          {
+            submit_ticket = batch.submit_ticket;
+            break;
+          }
+        }
+      }
+
+      // Outside the lock, so other threads can keep staging uploads meanwhile
+      waitBatch(ticket.value, submit_ticket);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      collectLocked();
+    }
+
+    void TransferEngine::addWait(Submission &submission, UploadTicket ticket, VkPipelineStageFlags stages)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ticket.value > submitted_value)
+        {
+          flushLocked();
+        }
+        collectLocked();
+        if (ticket.value <= completed_value)
+        {
+          return;
+        }
+
+        if (timeline != VK_NULL_HANDLE)
+        {
+          submission.wait_values.resize(submission.wait_semaphores.size(), 0);
+          submission.wait_semaphores.push_back(timeline);
+          submission.wait_stages.push_back(stages);
+          submission.wait_values.push_back(ticket.value);
+          return;
+        }
+      }
+
+      wait(ticket);
+    }
+
+    void TransferEngine::recordAcquire(VkCommandBuffer command_buffer, std::uint32_t family, UploadTicket ticket)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      // The release has to be submitted by the time the acquire executes
+      if (ticket.value > submitted_value)
+      {
+        flushLocked();
+      }
+
+      std::vector<VkBufferMemoryBarrier> buffer_barriers;
+      std::vector<VkImageMemoryBarrier> image_barriers;
+      VkPipelineStageFlags dst_stages = 0;
+      size_t kept = 0;
+      for (size_t i=0; i<pending_acquires.size(); ++i)
+      {
+        PendingAcquire const &acquire = pending_acquires[i];
+        if (acquire.value <= ticket.value && acquire.family == family)
+        {
+          if (acquire.is_image)
+          {
+            image_barriers.push_back(acquire.image_barrier);
+          }
+          else
+          {
+            buffer_barriers.push_back(acquire.buffer_barrier);
+          }
+          dst_stages |= acquire.dst_stages;
+        }
+        else
+        {
+          pending_acquires[kept++] = acquire;
+        }
+      }
+      pending_acquires.resize(kept);
+
+      if (dst_stages == 0)
+      {
+        return;
+      }
+
+      // The semaphore wait already orders the acquire after the release
+      vk->vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        dst_stages,
+        0,
+        0, nullptr,
+        static_cast<std::uint32_t>(buffer_barriers.size()), buffer_barriers.data(),
+        static_cast<std::uint32_t>(image_barriers.size()), image_barriers.data()
+      );
+    }
+
+    void TransferEngine::collect()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      collectLocked();
+    }
+
+    TransferEngine::Stats TransferEngine::stats() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      Stats stats = totals;
+      stats.queue_depth = static_cast<std::uint32_t>(in_flight.size());
+      stats.pending_uploads = open_recording ? open.uploads : 0;
+      stats.pending_acquires = static_cast<std::uint32_t>(pending_acquires.size());
+      stats.staging_used = staging.usedBytes();
+      stats.staging_peak = staging.peakBytes();
+      stats.staging_capacity = staging.capacity();
+      if (!in_flight.empty())
+      {
+        stats.busy_seconds += std::chrono::duration<double>(Clock::now() - busy_since).count();
+      }
+      return stats;
+    }
+
+    void TransferEngine::logStats() const
+    {
+      Stats const stats = this->stats();
+      if (stats.uploads == 0)
+      {
+        return;
+      }
+
+      Debug::Info(
+        "Transfer queue: {} uploads in {} batches, {} bytes at {} MB/s, queue depth peaked at {}, "
+        "staging peaked at {} of {} bytes, {} stalls waiting for staging space",
+        stats.uploads,
+        stats.batches,
+        stats.bytes_completed,
+        stats.throughputMBps(),
+        stats.peak_queue_depth,
+        stats.staging_peak,
+        stats.staging_capacity,
+        stats.staging_stalls
+      );
+    }
+
+    RingAllocator::Range TransferEngine::stageLocked(VkDeviceSize size, VkDeviceSize alignment)
+    {
+      RingAllocator::Range range;
+      bool stalled = false;
+      while (!staging.allocate(size, alignment, range))
+      {
+        // Always fits once every earlier batch has finished, since the ring is then empty
+        if (size > staging.capacity() || (!open_recording && in_flight.empty()))
+        {
+          throw std::runtime_error("ERROR: Upload doesn't fit into the staging ring");
+        }
+        if (!stalled)
+        {
+          ++totals.staging_stalls;
+          stalled = true;
+        }
+
+        PROFILE_ZONE("Wait for staging space");
+        if (open_recording)
+        {
+          flushLocked();
+        }
+        waitOldestLocked();
+      }
+      return range;
+    }
+
+    TransferEngine::Batch &TransferEngine::openBatchLocked()
+    {
+      if (open_recording)
+      {
+        return open;
+      }
+
+      if (open.command_pool == VK_NULL_HANDLE)
+      {
+        if (!free_batches.empty())
+        {
+          open = free_batches.back();
+          free_batches.pop_back();
+        }
+        else
+        {
+          // A pool per batch, reset wholesale once the batch finishes
+          VkCommandPoolCreateInfo pool_info = {};
+          pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+          pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+          pool_info.queueFamilyIndex = transfer_family;
+          if (vk->vkCreateCommandPool(device, &pool_info, allocator, &(open.command_pool)) != VK_SUCCESS)
+          {
+            throw std::runtime_error("ERROR: Failed to create a transfer command pool");
+          }
+
+          VkCommandBufferAllocateInfo allocate_info = {};
+          allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+          allocate_info.commandPool = open.command_pool;
+          allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+          allocate_info.commandBufferCount = 1;
+          if (vk->vkAllocateCommandBuffers(device, &allocate_info, &(open.command_buffer)) != VK_SUCCESS)
+          {
+            throw std::runtime_error("ERROR: Failed to allocate a transfer command buffer");
+          }
+        }
+      }
+
+      VkCommandBufferBeginInfo begin_info = {};
+      begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      vk->vkBeginCommandBuffer(open.command_buffer, &begin_info);
+
+      open.value = submitted_value + 1;
+      open.bytes = 0;
+      open.uploads = 0;
+      open_recording = true;
+      return open;
+    }
+
+    std::uint32_t TransferEngine::resolveFamily(std::uint32_t family) const
+    {
+      return family == VK_QUEUE_FAMILY_IGNORED ? consumer_family : family;
+    }
+
+    UploadTicket TransferEngine::flushLocked()
+    {
+      if (!open_recording)
+      {
+        return UploadTicket{ submitted_value };
+      }
+
+      PROFILE_ZONE("Flush transfer batch");
+
+      if (!release_buffer_barriers.empty() || !release_image_barriers.empty())
+      {
+        vk->vkCmdPipelineBarrier(
+          open.command_buffer,
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+          0,
+          0, nullptr,
+          static_cast<std::uint32_t>(release_buffer_barriers.size()), release_buffer_barriers.data(),
+          static_cast<std::uint32_t>(release_image_barriers.size()), release_image_barriers.data()
+        );
+        release_buffer_barriers.clear();
+        release_image_barriers.clear();
+      }
+
+      if (vk->vkEndCommandBuffer(open.command_buffer) != VK_SUCCESS)
+      {
+        throw std::runtime_error("ERROR: Failed to record a transfer batch");
+      }
+
+      Submission submission;
+      submission.command_buffers.push_back(open.command_buffer);
+      if (timeline != VK_NULL_HANDLE)
+      {
+        submission.signal_semaphores.push_back(timeline);
+        submission.signal_values.push_back(open.value);
+      }
+      open.submit_ticket = transfer_queue->submit(std::move(submission));
+      staging.endFrame();
+
+      if (in_flight.empty())
+      {
+        busy_since = Clock::now();
+      }
+      submitted_value = open.value;
+      ++totals.batches;
+      totals.bytes_submitted += open.bytes;
+      in_flight.push_back(open);
+      totals.peak_queue_depth = std::max(totals.peak_queue_depth, static_cast<std::uint32_t>(in_flight.size()));
+
+      open = Batch();
+      open_recording = false;
+      return UploadTicket{ submitted_value };
+    }
+
+    void TransferEngine::collectLocked()
+    {
+      std::uint64_t reached = completed_value;
+      if (timeline != VK_NULL_HANDLE)
+      {
+        vk->vkGetSemaphoreCounterValueKHR(device, timeline, &reached);
+      }
+
+      // Batches on one queue finish in order, as does the staging ring's space
+      while (!in_flight.empty())
+      {
+        Batch &batch = in_flight.front();
+        bool finished = timeline != VK_NULL_HANDLE
+          ? batch.value <= reached
+          : transfer_queue->isComplete(batch.submit_ticket);
+        if (!finished)
+        {
+          break;
+        }
+
+        staging.retireFrame();
+        completed_value = batch.value;
+        totals.bytes_completed += batch.bytes;
+        vk->vkResetCommandPool(device, batch.command_pool, 0);
+        free_batches.push_back(batch);
+        in_flight.pop_front();
+
+        if (in_flight.empty())
+        {
+          totals.busy_seconds += std::chrono::duration<double>(Clock::now() - busy_since).count();
+        }
+      }
+    }
+
+    void TransferEngine::waitOldestLocked()
+    {
+      if (!in_flight.empty())
+      {
+        waitBatch(in_flight.front().value, in_flight.front().submit_ticket);
+        collectLocked();
+      }
+    }
+
+    void TransferEngine::waitBatch(std::uint64_t value, SubmitTicket submit_ticket)
+    {
+      if (timeline == VK_NULL_HANDLE)
+      {
+        transfer_queue->wait(submit_ticket);
+        return;
+      }
+
+      VkSemaphoreWaitInfoKHR wait_info = {};
+      wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+      wait_info.semaphoreCount = 1;
+      wait_info.pSemaphores = &timeline;
+      wait_info.pValues = &value;
+      vk->vkWaitSemaphoresKHR(device, &wait_info, std::numeric_limits<std::uint64_t>::max());
+    }
+  }
+#endif
+
+}
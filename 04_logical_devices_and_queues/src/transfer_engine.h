@@ -0,0 +1,203 @@
+#ifndef TRANSFER_ENGINE_H
+#define TRANSFER_ENGINE_H
+
+#include "init.h"
+#include "dispatch.h"
+#include "device_memory.h"
+#include "queue_submission.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Completes once the transfer batch an upload went into has finished. Later tickets complete later.
+    struct UploadTicket
+    {
+      std::uint64_t value = 0;
+    };
+
+    struct BufferUpload
+    {
+      VkBuffer buffer = VK_NULL_HANDLE;
+      VkDeviceSize offset = 0;
+      void const *data = nullptr;
+      VkDeviceSize size = 0;
+      // Copied from instead of data when set, skipping the staging ring. It must outlive the upload's ticket.
+      // An upload with neither throws.
+      VkBuffer src_buffer = VK_NULL_HANDLE;
+      VkDeviceSize src_offset = 0;
+      // The family that uses the buffer afterwards, and how it first does. VK_QUEUE_FAMILY_IGNORED stands for
+      // the engine's consumer family.
+      std::uint32_t dst_family = VK_QUEUE_FAMILY_IGNORED;
+      VkPipelineStageFlags dst_stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+      VkAccessFlags dst_access = VK_ACCESS_MEMORY_READ_BIT;
+    };
+
+    struct ImageUpload
+    {
+      VkImage image = VK_NULL_HANDLE;
+      VkImageSubresourceLayers subresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+      VkOffset3D offset = {};
+      VkExtent3D extent = {};
+      // Tightly packed texels for the region
+      void const *data = nullptr;
+      VkDeviceSize size = 0;
+      // As for BufferUpload. The offset must be a multiple of 4 and of the format's texel block size.
+      VkBuffer src_buffer = VK_NULL_HANDLE;
+      VkDeviceSize src_offset = 0;
+      // UNDEFINED discards whatever the subresources held before
+      VkImageLayout old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+      VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      std::uint32_t dst_family = VK_QUEUE_FAMILY_IGNORED;
+      VkPipelineStageFlags dst_stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      VkAccessFlags dst_access = VK_ACCESS_SHADER_READ_BIT;
+    };
+
+    // Uploads through a persistently mapped staging ring on the transfer queue, so streaming data never
+    // stalls the graphics queue. Uploads from any thread are recorded into one open batch, which goes out as
+    // a single submission on flush. Each batch signals the next value of a timeline semaphore, so a consumer
+    // waits on the GPU for just the uploads it needs, and staging space comes back as batches finish.
+    //
+    // When the consumer is in another queue family, the copy ends with the releasing half of a queue family
+    // ownership transfer, and the consumer records the acquiring half with recordAcquire before first use.
+    class TransferEngine
+    {
+    public:
+      static VkDeviceSize constexpr DEFAULT_STAGING_SIZE = 32ull * 1024 * 1024;
+      // Large buffer uploads are split so the ring can take the next piece while the GPU copies the last
+      static VkDeviceSize constexpr MAX_CHUNK_FRACTION = 4;
+
+      struct Stats
+      {
+        std::uint64_t uploads = 0;
+        std::uint64_t batches = 0;
+        std::uint64_t bytes_submitted = 0;
+        std::uint64_t bytes_completed = 0;
+        std::uint32_t queue_depth = 0;      // Batches submitted and not finished yet
+        std::uint32_t peak_queue_depth = 0;
+        std::uint32_t pending_uploads = 0;  // Recorded into the open batch
+        std::uint32_t pending_acquires = 0; // Released to another family and not acquired yet
+        std::uint64_t staging_stalls = 0;   // Times an upload waited for staging space
+        VkDeviceSize staging_used = 0;
+        VkDeviceSize staging_peak = 0;
+        VkDeviceSize staging_capacity = 0;
+        double busy_seconds = 0.0;          // With at least one batch in flight
+
+        // Completed bytes over the time the queue was busy
+        double throughputMBps() const;
+      };
+
+      // Without timeline semaphores, addWait falls back to waiting on the host
+      void init(
+        DeviceDispatch const &vk,
+        VkDevice device,
+        VkAllocationCallbacks const *allocator,
+        DeviceMemoryAllocator &memory_allocator,
+        SubmitQueue &transfer_queue,
+        VkPhysicalDeviceLimits const &limits,
+        std::uint32_t consumer_family,
+        bool timeline_semaphores,
+        VkDeviceSize staging_size = DEFAULT_STAGING_SIZE
+      );
+      // Waits for every batch, submitting the open one first
+      void destroy();
+
+      // Copies the data into staging memory and records the upload into the open batch, waiting for earlier
+      // batches to free up staging space when the ring is full. The data may be freed on return.
+      UploadTicket upload(BufferUpload const &upload);
+      // Throws when the image data is larger than the staging ring and has no src_buffer
+      UploadTicket upload(ImageUpload const &upload);
+      // Submits the open batch, if it has anything, and returns its ticket
+      UploadTicket flush();
+
+      bool isComplete(UploadTicket ticket);
+      void wait(UploadTicket ticket);
+      // Makes submission wait on the GPU, at stages, for ticket's uploads, flushing them first if needed
+      void addWait(Submission &submission, UploadTicket ticket, VkPipelineStageFlags stages);
+      // Records the acquiring half of the ownership transfers to family for uploads up to ticket. The command
+      // buffer must go into a submission given addWait for ticket or a later one.
+      void recordAcquire(VkCommandBuffer command_buffer, std::uint32_t family, UploadTicket ticket);
+      // Recycles the command buffers and staging space of finished batches
+      void collect();
+
+      bool usesTimelineSemaphore() const { return timeline != VK_NULL_HANDLE; }
+      std::uint32_t transferFamily() const { return transfer_family; }
+      Stats stats() const;
+      void logStats() const;
+
+    private:
+      using Clock = std::chrono::steady_clock;
+
+      struct Batch
+      {
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        std::uint64_t value = 0; // Its UploadTicket, and the timeline value it signals
+        SubmitTicket submit_ticket;
+        std::uint64_t bytes = 0;
+        std::uint32_t uploads = 0;
+      };
+
+      // The acquiring half of an ownership transfer, recorded by the consumer
+      struct PendingAcquire
+      {
+        std::uint64_t value;
+        std::uint32_t family;
+        VkPipelineStageFlags dst_stages;
+        bool is_image;
+        VkBufferMemoryBarrier buffer_barrier;
+        VkImageMemoryBarrier image_barrier;
+      };
+
+      // Staging space for size bytes, flushing and waiting on earlier batches until the ring has room
+      RingAllocator::Range stageLocked(VkDeviceSize size, VkDeviceSize alignment);
+      // Begins the open batch's command buffer if this is its first upload
+      Batch &openBatchLocked();
+      std::uint32_t resolveFamily(std::uint32_t family) const;
+      UploadTicket flushLocked();
+      void collectLocked();
+      void waitOldestLocked();
+      // Waits on the host for the batch with the value, which must be in flight
+      void waitBatch(std::uint64_t value, SubmitTicket submit_ticket);
+
+      DeviceDispatch const *vk = nullptr;
+      VkDevice device = VK_NULL_HANDLE;
+      VkAllocationCallbacks const *allocator = nullptr;
+      SubmitQueue *transfer_queue = nullptr;
+      std::uint32_t transfer_family = 0;
+      std::uint32_t consumer_family = 0;
+      VkDeviceSize copy_alignment = 1;
+      VkSemaphore timeline = VK_NULL_HANDLE;
+
+      VkBuffer staging_buffer = VK_NULL_HANDLE;
+      RingAllocator staging;
+
+      mutable std::mutex mutex;
+      Batch open;
+      bool open_recording = false;
+      std::deque<Batch> in_flight;      // Oldest first
+      std::vector<Batch> free_batches;  // Finished, with their command pools reset
+      // The releasing halves of ownership transfers and final layout transitions, recorded at flush
+      std::vector<VkBufferMemoryBarrier> release_buffer_barriers;
+      std::vector<VkImageMemoryBarrier> release_image_barriers;
+      std::vector<PendingAcquire> pending_acquires;
+      std::uint64_t submitted_value = 0;
+      std::uint64_t completed_value = 0;
+
+      Stats totals;
+      Clock::time_point busy_since;
+    };
+  }
+#endif
+
+}
+
+#endif // TRANSFER_ENGINE_H
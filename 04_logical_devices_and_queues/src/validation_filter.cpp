@@ -0,0 +1,216 @@
+#include "validation_filter.h"
+#include "debug.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(USING_VULKAN) && !defined(NDEBUG)
+
+namespace Graphics
+{
+  namespace Vulkan
+  {
+    static std::uint64_t hashMessage(
+      char const *layer_prefix,
+      std::int32_t code,
+      std::uint32_t object_type,
+      std::uint64_t object)
+    {
+      // FNV-1a
+      std::uint64_t hash = 14695981039346656037ull;
+      auto mix = [&hash](std::uint64_t value)
+      {
+        for (int i=0; i<8; ++i)
+        {
+          hash ^= (value >> (i * 8)) & 0xff;
+          hash *= 1099511628211ull;
+        }
+      };
+
+      for (char const *c = layer_prefix; c != nullptr && *c != '\0'; ++c)
+      {
+        hash ^= static_cast<unsigned char>(*c);
+        hash *= 1099511628211ull;
+      }
+      mix(static_cast<std::uint32_t>(code));
+      mix(object_type);
+      mix(object);
+
+      // Zero marks an empty slot
+      return hash != 0 ? hash : 1;
+    }
+
+    // Writes 12345 as "12,345"
+    static void formatCount(std::uint64_t value, char (&out)[32])
+    {
+      char digits[32];
+      int digit_count = std::snprintf(digits, sizeof(digits), "%llu", static_cast<unsigned long long>(value));
+
+      int position = 0;
+      for (int i=0; i<digit_count; ++i)
+      {
+        if (i > 0 && (digit_count - i) % 3 == 0)
+        {
+          out[position++] = ',';
+        }
+        out[position++] = digits[i];
+      }
+      out[position] = '\0';
+    }
+
+    ValidationFilter::ValidationFilter()
+      : total(0), suppressed(0), unique(0), untracked(0)
+    {
+      for (Entry &entry : entries)
+      {
+        entry.key.store(0, std::memory_order_relaxed);
+        entry.count.store(0, std::memory_order_relaxed);
+        entry.ready.store(false, std::memory_order_relaxed);
+      }
+    }
+
+    ValidationFilter::Action ValidationFilter::record(
+      char const *layer_prefix,
+      std::int32_t code,
+      std::uint32_t object_type,
+      std::uint64_t object,
+      std::uint64_t &occurrences)
+    {
+      total.fetch_add(1, std::memory_order_relaxed);
+      std::uint64_t key = hashMessage(layer_prefix, code, object_type, object);
+
+      // Linear probing; entries are never removed so a claimed slot keeps its key for good
+      for (size_t probe=0; probe<TABLE_SIZE; ++probe)
+      {
+        Entry &entry = entries[(key + probe) & (TABLE_SIZE - 1)];
+        std::uint64_t existing = entry.key.load(std::memory_order_acquire);
+
+        if (existing == 0)
+        {
+          if (entry.key.compare_exchange_strong(existing, key, std::memory_order_acq_rel))
+          {
+            entry.code = code;
+            entry.object_type = object_type;
+            entry.object = object;
+            std::snprintf(entry.layer_prefix, PREFIX_SIZE, "%s", layer_prefix != nullptr ? layer_prefix : "");
+            entry.ready.store(true, std::memory_order_release);
+            unique.fetch_add(1, std::memory_order_relaxed);
+            existing = key;
+          }
+        }
+
+        if (existing != key)
+        {
+          continue;
+        }
+
+        occurrences = entry.count.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (occurrences <= FIRST_OCCURRENCES)
+        {
+          return Action::Report;
+        }
+
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return occurrences % SUMMARY_INTERVAL == 0 ? Action::Summarize : Action::Suppress;
+      }
+
+      // The table is full, so new messages are counted together rather than let through unlimited. The first
+      // one held back says so straight away.
+      occurrences = untracked.fetch_add(1, std::memory_order_relaxed) + 1;
+      if (occurrences <= FIRST_OCCURRENCES)
+      {
+        return Action::Report;
+      }
+
+      suppressed.fetch_add(1, std::memory_order_relaxed);
+      bool const summarize = occurrences == FIRST_OCCURRENCES + 1 || occurrences % SUMMARY_INTERVAL == 0;
+      return summarize ? Action::SummarizeUntracked : Action::Suppress;
+    }
+
+    ValidationFilter::Entry const *ValidationFilter::find(std::uint64_t key) const
+    {
+      for (size_t probe=0; probe<TABLE_SIZE; ++probe)
+      {
+        Entry const &entry = entries[(key + probe) & (TABLE_SIZE - 1)];
+        std::uint64_t existing = entry.key.load(std::memory_order_acquire);
+        if (existing == key)
+        {
+          return &entry;
+        }
+        if (existing == 0)
+        {
+          break;
+        }
+      }
+
+      return nullptr;
+    }
+
+    std::uint64_t ValidationFilter::occurrences(
+      char const *layer_prefix,
+      std::int32_t code,
+      std::uint32_t object_type,
+      std::uint64_t object) const
+    {
+      Entry const *entry = find(hashMessage(layer_prefix, code, object_type, object));
+      return entry != nullptr ? entry->count.load(std::memory_order_relaxed) : 0;
+    }
+
+    void ValidationFilter::logSummary() const
+    {
+      for (Entry const &entry : entries)
+      {
+        if (!entry.ready.load(std::memory_order_acquire))
+        {
+          continue;
+        }
+
+        std::uint64_t count = entry.count.load(std::memory_order_relaxed);
+        if (count > FIRST_OCCURRENCES)
+        {
+          char formatted[32];
+          formatCount(count, formatted);
+          Debug::Warning(
+            "Validation message {} (code {}, object {}) repeated {} times",
+            entry.layer_prefix,
+            entry.code,
+            reinterpret_cast<void const *>(static_cast<std::uintptr_t>(entry.object)),
+            formatted
+          );
+        }
+      }
+
+      std::uint64_t untracked_count = untracked.load(std::memory_order_relaxed);
+      if (untracked_count > 0)
+      {
+        char formatted[32];
+        formatCount(untracked_count, formatted);
+        Debug::Warning(
+          "{} validation messages found the {} entry table full and were rate limited together",
+          formatted,
+          TABLE_SIZE
+        );
+      }
+    }
+
+    void ValidationFilter::logRepeated(char const *layer_prefix, std::int32_t code, std::uint64_t occurrences)
+    {
+      char formatted[32];
+      formatCount(occurrences, formatted);
+      Debug::Warning("Validation message {} (code {}) repeated {} times so far", layer_prefix, code, formatted);
+    }
+
+    void ValidationFilter::logUntracked(std::uint64_t occurrences)
+    {
+      char formatted[32];
+      formatCount(occurrences, formatted);
+      Debug::Warning(
+        "Validation message table is full, {} new messages so far and only the first {} were reported",
+        formatted,
+        FIRST_OCCURRENCES
+      );
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef VALIDATION_FILTER_H
+#define VALIDATION_FILTER_H
+
+#include "init.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Graphics
+{
+
+#if defined(USING_VULKAN) && !defined(NDEBUG)
+  namespace Vulkan
+  {
+    // Deduplicates validation messages by (source, code, object type, object), where the source is the
+    // debug_utils message id name or the debug_report layer prefix. The first
+    // FIRST_OCCURRENCES of each are reported, after that only a summary every SUMMARY_INTERVAL repeats.
+    // Messages that arrive once the table is full share a single overflow count, limited the same way.
+    // Lock free, since the debug report callback can run on any driver thread.
+    class ValidationFilter
+    {
+    public:
+      static size_t constexpr TABLE_SIZE = 1024; // Must be a power of two
+      static std::uint64_t constexpr FIRST_OCCURRENCES = 5;
+      static std::uint64_t constexpr SUMMARY_INTERVAL = 1000;
+
+      enum class Action
+      {
+        Report,
+        Summarize,
+        SummarizeUntracked, // Like Summarize, for the shared count of messages the table had no room for
+        Suppress
+      };
+
+      ValidationFilter();
+
+      // Counts the message and returns what the caller should do with it, along with its running count
+      Action record(
+        char const *layer_prefix,
+        std::int32_t code,
+        std::uint32_t object_type,
+        std::uint64_t object,
+        std::uint64_t &occurrences
+      );
+
+      std::uint64_t occurrences(
+        char const *layer_prefix,
+        std::int32_t code,
+        std::uint32_t object_type,
+        std::uint64_t object
+      ) const;
+
+      std::uint64_t totalCount() const { return total.load(std::memory_order_relaxed); }
+      std::uint64_t suppressedCount() const { return suppressed.load(std::memory_order_relaxed); }
+      std::uint64_t uniqueCount() const { return unique.load(std::memory_order_relaxed); }
+      // Messages that arrived after the table filled up
+      std::uint64_t untrackedCount() const { return untracked.load(std::memory_order_relaxed); }
+
+      // Logs a final count for every message that was suppressed at least once
+      void logSummary() const;
+      static void logRepeated(char const *layer_prefix, std::int32_t code, std::uint64_t occurrences);
+      static void logUntracked(std::uint64_t occurrences);
+
+    private:
+      static size_t constexpr PREFIX_SIZE = 32;
+
+      struct Entry
+      {
+        std::atomic<std::uint64_t> key;
+        std::atomic<std::uint64_t> count;
+        std::atomic<bool> ready;
+        std::int32_t code;
+        std::uint32_t object_type;
+        std::uint64_t object;
+        char layer_prefix[PREFIX_SIZE];
+      };
+
+      Entry const *find(std::uint64_t key) const;
+
+      Entry entries[TABLE_SIZE];
+      std::atomic<std::uint64_t> total;
+      std::atomic<std::uint64_t> suppressed;
+      std::atomic<std::uint64_t> unique;
+      std::atomic<std::uint64_t> untracked;
+    };
+  }
+#endif
+
+}
+
+#endif // VALIDATION_FILTER_H
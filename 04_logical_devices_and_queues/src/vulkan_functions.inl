@@ -0,0 +1,142 @@
+// Every Vulkan function chapter 04 calls, expanded into the dispatch tables in dispatch.h.
+// Include after defining the macros you need; undefined ones expand to nothing.
+//
+// VULKAN_GLOBAL_FUNCTION      loaded with vkGetInstanceProcAddr(VK_NULL_HANDLE, ...), required
+// VULKAN_GLOBAL_EXTENSION     loaded with vkGetInstanceProcAddr(VK_NULL_HANDLE, ...), may be null
+// VULKAN_INSTANCE_FUNCTION    loaded with vkGetInstanceProcAddr(instance, ...), required
+// VULKAN_INSTANCE_EXTENSION   loaded with vkGetInstanceProcAddr(instance, ...), may be null
+// VULKAN_DEVICE_FUNCTION      loaded with vkGetDeviceProcAddr(device, ...), required
+// VULKAN_DEVICE_EXTENSION     loaded with vkGetDeviceProcAddr(device, ...), may be null
+//
+// Functions from core versions newer than 1.0 are listed as extensions, since a 1.0 loader or driver lacks them.
+
+#ifndef VULKAN_GLOBAL_FUNCTION
+  #define VULKAN_GLOBAL_FUNCTION(name)
+#endif
+#ifndef VULKAN_GLOBAL_EXTENSION
+  #define VULKAN_GLOBAL_EXTENSION(name)
+#endif
+#ifndef VULKAN_INSTANCE_FUNCTION
+  #define VULKAN_INSTANCE_FUNCTION(name)
+#endif
+#ifndef VULKAN_INSTANCE_EXTENSION
+  #define VULKAN_INSTANCE_EXTENSION(name)
+#endif
+#ifndef VULKAN_DEVICE_FUNCTION
+  #define VULKAN_DEVICE_FUNCTION(name)
+#endif
+#ifndef VULKAN_DEVICE_EXTENSION
+  #define VULKAN_DEVICE_EXTENSION(name)
+#endif
+
+VULKAN_GLOBAL_FUNCTION(vkCreateInstance)
+VULKAN_GLOBAL_FUNCTION(vkEnumerateInstanceExtensionProperties)
+VULKAN_GLOBAL_FUNCTION(vkEnumerateInstanceLayerProperties)
+
+VULKAN_GLOBAL_EXTENSION(vkEnumerateInstanceVersion)
+
+VULKAN_INSTANCE_FUNCTION(vkDestroyInstance)
+VULKAN_INSTANCE_FUNCTION(vkEnumeratePhysicalDevices)
+VULKAN_INSTANCE_FUNCTION(vkEnumerateDeviceExtensionProperties)
+VULKAN_INSTANCE_FUNCTION(vkGetPhysicalDeviceProperties)
+VULKAN_INSTANCE_FUNCTION(vkGetPhysicalDeviceFeatures)
+VULKAN_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)
+VULKAN_INSTANCE_FUNCTION(vkGetPhysicalDeviceMemoryProperties)
+VULKAN_INSTANCE_FUNCTION(vkCreateDevice)
+VULKAN_INSTANCE_FUNCTION(vkGetDeviceProcAddr)
+
+VULKAN_INSTANCE_EXTENSION(vkGetPhysicalDeviceProperties2)
+VULKAN_INSTANCE_EXTENSION(vkGetPhysicalDeviceFeatures2)
+
+VULKAN_INSTANCE_EXTENSION(vkCreateDebugReportCallbackEXT)
+VULKAN_INSTANCE_EXTENSION(vkDestroyDebugReportCallbackEXT)
+VULKAN_INSTANCE_EXTENSION(vkCreateDebugUtilsMessengerEXT)
+VULKAN_INSTANCE_EXTENSION(vkDestroyDebugUtilsMessengerEXT)
+VULKAN_INSTANCE_EXTENSION(vkSetDebugUtilsObjectNameEXT)
+VULKAN_INSTANCE_EXTENSION(vkQueueBeginDebugUtilsLabelEXT)
+VULKAN_INSTANCE_EXTENSION(vkQueueEndDebugUtilsLabelEXT)
+VULKAN_INSTANCE_EXTENSION(vkQueueInsertDebugUtilsLabelEXT)
+VULKAN_INSTANCE_EXTENSION(vkCmdBeginDebugUtilsLabelEXT)
+VULKAN_INSTANCE_EXTENSION(vkCmdEndDebugUtilsLabelEXT)
+VULKAN_INSTANCE_EXTENSION(vkCmdInsertDebugUtilsLabelEXT)
+
+VULKAN_DEVICE_FUNCTION(vkDestroyDevice)
+VULKAN_DEVICE_FUNCTION(vkGetDeviceQueue)
+VULKAN_DEVICE_FUNCTION(vkDeviceWaitIdle)
+VULKAN_DEVICE_FUNCTION(vkQueueSubmit)
+VULKAN_DEVICE_FUNCTION(vkQueueWaitIdle)
+
+VULKAN_DEVICE_FUNCTION(vkAllocateMemory)
+VULKAN_DEVICE_FUNCTION(vkFreeMemory)
+VULKAN_DEVICE_FUNCTION(vkMapMemory)
+VULKAN_DEVICE_FUNCTION(vkUnmapMemory)
+VULKAN_DEVICE_FUNCTION(vkFlushMappedMemoryRanges)
+VULKAN_DEVICE_FUNCTION(vkInvalidateMappedMemoryRanges)
+VULKAN_DEVICE_FUNCTION(vkBindBufferMemory)
+VULKAN_DEVICE_FUNCTION(vkBindImageMemory)
+VULKAN_DEVICE_FUNCTION(vkGetBufferMemoryRequirements)
+VULKAN_DEVICE_FUNCTION(vkGetImageMemoryRequirements)
+VULKAN_DEVICE_FUNCTION(vkCreateBuffer)
+VULKAN_DEVICE_FUNCTION(vkDestroyBuffer)
+VULKAN_DEVICE_FUNCTION(vkCreateImage)
+VULKAN_DEVICE_FUNCTION(vkDestroyImage)
+
+VULKAN_DEVICE_FUNCTION(vkCreatePipelineCache)
+VULKAN_DEVICE_FUNCTION(vkDestroyPipelineCache)
+VULKAN_DEVICE_FUNCTION(vkGetPipelineCacheData)
+VULKAN_DEVICE_FUNCTION(vkCreateShaderModule)
+VULKAN_DEVICE_FUNCTION(vkDestroyShaderModule)
+VULKAN_DEVICE_FUNCTION(vkCreateGraphicsPipelines)
+VULKAN_DEVICE_FUNCTION(vkCreateComputePipelines)
+VULKAN_DEVICE_FUNCTION(vkDestroyPipeline)
+VULKAN_DEVICE_FUNCTION(vkCreatePipelineLayout)
+VULKAN_DEVICE_FUNCTION(vkDestroyPipelineLayout)
+
+VULKAN_DEVICE_FUNCTION(vkCreateDescriptorSetLayout)
+VULKAN_DEVICE_FUNCTION(vkDestroyDescriptorSetLayout)
+VULKAN_DEVICE_FUNCTION(vkCreateDescriptorPool)
+VULKAN_DEVICE_FUNCTION(vkDestroyDescriptorPool)
+VULKAN_DEVICE_FUNCTION(vkResetDescriptorPool)
+VULKAN_DEVICE_FUNCTION(vkAllocateDescriptorSets)
+VULKAN_DEVICE_FUNCTION(vkUpdateDescriptorSets)
+
+VULKAN_DEVICE_FUNCTION(vkCreateFence)
+VULKAN_DEVICE_FUNCTION(vkDestroyFence)
+VULKAN_DEVICE_FUNCTION(vkResetFences)
+VULKAN_DEVICE_FUNCTION(vkGetFenceStatus)
+VULKAN_DEVICE_FUNCTION(vkWaitForFences)
+VULKAN_DEVICE_FUNCTION(vkCreateSemaphore)
+VULKAN_DEVICE_FUNCTION(vkDestroySemaphore)
+
+VULKAN_DEVICE_EXTENSION(vkGetSemaphoreCounterValueKHR)
+VULKAN_DEVICE_EXTENSION(vkWaitSemaphoresKHR)
+
+VULKAN_DEVICE_FUNCTION(vkCreateQueryPool)
+VULKAN_DEVICE_FUNCTION(vkDestroyQueryPool)
+VULKAN_DEVICE_FUNCTION(vkGetQueryPoolResults)
+
+VULKAN_DEVICE_FUNCTION(vkCreateCommandPool)
+VULKAN_DEVICE_FUNCTION(vkDestroyCommandPool)
+VULKAN_DEVICE_FUNCTION(vkResetCommandPool)
+VULKAN_DEVICE_FUNCTION(vkAllocateCommandBuffers)
+VULKAN_DEVICE_FUNCTION(vkFreeCommandBuffers)
+VULKAN_DEVICE_FUNCTION(vkBeginCommandBuffer)
+VULKAN_DEVICE_FUNCTION(vkEndCommandBuffer)
+VULKAN_DEVICE_FUNCTION(vkResetCommandBuffer)
+
+VULKAN_DEVICE_FUNCTION(vkCmdPipelineBarrier)
+VULKAN_DEVICE_FUNCTION(vkCmdClearColorImage)
+VULKAN_DEVICE_FUNCTION(vkCmdCopyBuffer)
+VULKAN_DEVICE_FUNCTION(vkCmdCopyBufferToImage)
+VULKAN_DEVICE_FUNCTION(vkCmdCopyImageToBuffer)
+VULKAN_DEVICE_FUNCTION(vkCmdExecuteCommands)
+VULKAN_DEVICE_FUNCTION(vkCmdBindDescriptorSets)
+VULKAN_DEVICE_FUNCTION(vkCmdResetQueryPool)
+VULKAN_DEVICE_FUNCTION(vkCmdWriteTimestamp)
+
+#undef VULKAN_GLOBAL_FUNCTION
+#undef VULKAN_GLOBAL_EXTENSION
+#undef VULKAN_INSTANCE_FUNCTION
+#undef VULKAN_INSTANCE_EXTENSION
+#undef VULKAN_DEVICE_FUNCTION
+#undef VULKAN_DEVICE_EXTENSION
@@ -4,25 +4,65 @@
 #include "constants.h"
 #include "debug.h"
 
-void initWindow(Context::Window const &context)
+#include <stdexcept>
+
+void initWindowSystem([[maybe_unused]] Context::Window &context)
+{
+  Debug::Trace("Init window system");
+
+  #ifdef USING_GLFW
+    if (glfwInit() == GLFW_FALSE)
+    {
+      throw std::runtime_error("ERROR: Failed to initialize GLFW");
+    }
+
+    #ifdef USING_VULKAN
+      // Tell GLFW not to create on OpenGL Context
+      glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+      // For now, we disable window resizing since it will become complicated
+      glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    #endif
+  #endif
+}
+
+void createWindow([[maybe_unused]] Context::Window &context)
 {
-  Debug::Log("TRACE", "Init window");
+  Debug::Trace("Init window");
 
-  glfwInit();
+  #ifdef USING_GLFW
+    context.window = glfwCreateWindow(
+      Constants::WIDTH, Constants::HEIGHT,
+      "Logical Devices and Queues",
+      nullptr, // Monitor
+      nullptr  // OpenGL specific
+    );
+    if (context.window == nullptr)
+    {
+      throw std::runtime_error("ERROR: Failed to create window");
+    }
 
-  #ifdef USING_VULKAN
-    // Tell GLFW not to create on OpenGL Context
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    // For now, we disable window resizing since it will become complicated
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    Debug::Trace("Window created");
+  #else
+    Debug::Trace("Headless build, no window created");
   #endif
+}
 
-  context.window = glfwCreateWindow(
-    Constants::WIDTH, Constants::HEIGHT,
-    "Logical Devices and Queues",
-    nullptr, // Monitor
-    nullptr  // OpenGL specific
-  );
+bool isWindowVisible([[maybe_unused]] Context::Window const &context)
+{
+  #ifdef USING_GLFW
+    return glfwGetWindowAttrib(context.window, GLFW_ICONIFIED) == 0;
+  #else
+    return false;
+  #endif
+}
 
-  Debug::Log("TRACE", "Window created");
+void cleanupWindow([[maybe_unused]] Context::Window &context)
+{
+  Debug::Trace("Clean up window");
+
+  #ifdef USING_GLFW
+    glfwDestroyWindow(context.window);
+    context.window = nullptr;
+    glfwTerminate();
+  #endif
 }
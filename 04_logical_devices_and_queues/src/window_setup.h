@@ -3,6 +3,12 @@
 
 #include "context.h"
 
-void initWindow(Context::Window const &context);
+// Window setup comes in two steps, both throwing on failure. Both must run on the main thread, and once
+// initWindowSystem has returned the graphics setup can query GLFW from any thread.
+void initWindowSystem(Context::Window &context);
+void createWindow(Context::Window &context);
+// False while minimized, when there is no point rendering
+bool isWindowVisible(Context::Window const &context);
+void cleanupWindow(Context::Window &context);
 
 #endif // WINDOW_SETUP_H
@@ -0,0 +1,365 @@
+#include "asset_pack.h"
+#include "file_io.h"
+#include "texture_compression.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Packs the assets a manifest lists into one file, laid out so the runtime can upload straight from a
+// mapping of it. Meant to run as a build step.
+//
+//   04_logical_devices_and_queues_asset_packer <manifest> <output.pack>
+//
+// Each manifest line names one asset, with paths relative to the manifest. # starts a comment.
+//
+//   buffer   <name> <file>
+//   vertices <name> <file> <stride>      vertex data, interleaved as the vertex input state reads it
+//   indices  <name> <file> <16|32>       narrowed to 16 bits when every index fits
+//   texture  <name> <file> <width> <height> <format> [nomips]
+//
+// Texture files hold tightly packed 8-bit RGBA texels. Formats are rgba8, bc1 and bc3, each with an _srgb
+// variant. A full mip chain is generated unless nomips is given.
+
+namespace
+{
+  struct PackedAsset
+  {
+    std::string name;
+    Assets::PackEntry entry = {};
+    // Each level's data, for buffers just the one
+    std::vector<std::vector<std::uint8_t>> levels;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> extents;
+  };
+
+  std::vector<std::uint8_t> readFile(std::string const &path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+      throw std::runtime_error("ERROR: Failed to open " + path);
+    }
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.empty())
+    {
+      throw std::runtime_error("ERROR: " + path + " is empty");
+    }
+    return data;
+  }
+
+  void packBuffer(PackedAsset &asset, std::vector<std::uint8_t> data, Assets::EntryKind kind, std::uint32_t stride)
+  {
+    asset.entry.kind = kind;
+    asset.entry.stride = stride;
+    asset.entry.width = static_cast<std::uint32_t>(stride != 0 ? data.size() / stride : data.size());
+    asset.entry.height = 1;
+    asset.extents.push_back({ asset.entry.width, 1 });
+    asset.levels.push_back(std::move(data));
+  }
+
+  void packIndices(PackedAsset &asset, std::vector<std::uint8_t> data, std::uint32_t bits)
+  {
+    std::uint32_t const size = bits / 8;
+    if ((bits != 16 && bits != 32) || data.size() % size != 0)
+    {
+      throw std::runtime_error("ERROR: " + asset.name + " needs 16 or 32 bit indices filling its file");
+    }
+
+    // 32 bit indices below 0xffff, and the restart index, fit in 16 bits and halve the index fetch
+    bool narrow = bits == 32;
+    std::vector<std::uint32_t> indices(data.size() / size);
+    for (size_t i=0; i<indices.size(); ++i)
+    {
+      std::uint32_t index = 0;
+      std::memcpy(&index, &data[i * size], size);
+      indices[i] = index;
+      narrow = narrow && (index < 0xffff || index == 0xffffffff);
+    }
+
+    if (narrow)
+    {
+      data.resize(indices.size() * 2);
+      for (size_t i=0; i<indices.size(); ++i)
+      {
+        std::uint16_t const index = indices[i] == 0xffffffff ? 0xffff : static_cast<std::uint16_t>(indices[i]);
+        std::memcpy(&data[i * 2], &index, 2);
+      }
+      bits = 16;
+    }
+
+    packBuffer(asset, std::move(data), Assets::EntryKind::IndexBuffer, 0);
+    asset.entry.format = bits == 16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    asset.entry.width = static_cast<std::uint32_t>(indices.size());
+    asset.extents.back().first = asset.entry.width;
+  }
+
+  void packTexture(
+    PackedAsset &asset,
+    std::vector<std::uint8_t> data,
+    std::uint32_t width,
+    std::uint32_t height,
+    std::string const &format,
+    bool mips)
+  {
+    if (width == 0 || height == 0 || data.size() != size_t(width) * height * 4)
+    {
+      throw std::runtime_error(
+        "ERROR: " + asset.name + " should be " + std::to_string(width) + "x" + std::to_string(height) + " RGBA texels"
+      );
+    }
+
+    bool const srgb = format.size() > 5 && format.compare(format.size() - 5, 5, "_srgb") == 0;
+    std::string const base_format = srgb ? format.substr(0, format.size() - 5) : format;
+    VkFormat vk_format;
+    if (base_format == "rgba8")
+    {
+      vk_format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+    else if (base_format == "bc1")
+    {
+      vk_format = srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    }
+    else if (base_format == "bc3")
+    {
+      vk_format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    }
+    else
+    {
+      throw std::runtime_error("ERROR: Unknown texture format " + format + " for " + asset.name);
+    }
+
+    asset.entry.kind = Assets::EntryKind::Texture;
+    asset.entry.format = vk_format;
+    asset.entry.width = width;
+    asset.entry.height = height;
+
+    Assets::Image image;
+    image.width = width;
+    image.height = height;
+    image.texels = std::move(data);
+    while (true)
+    {
+      if (base_format == "bc1")
+      {
+        asset.levels.push_back(Assets::compressBC1(image));
+      }
+      else if (base_format == "bc3")
+      {
+        asset.levels.push_back(Assets::compressBC3(image));
+      }
+      else
+      {
+        asset.levels.push_back(image.texels);
+      }
+      asset.extents.push_back({ image.width, image.height });
+
+      if (!mips || (image.width == 1 && image.height == 1))
+      {
+        break;
+      }
+      image = Assets::downsample(image, srgb);
+    }
+  }
+
+  PackedAsset parseLine(std::string const &line, std::string const &directory, size_t line_number)
+  {
+    std::istringstream words(line);
+    std::string kind;
+    std::string path;
+    PackedAsset asset;
+    words >> kind >> asset.name >> path;
+    if (asset.name.empty() || path.empty())
+    {
+      throw std::runtime_error("ERROR: Line " + std::to_string(line_number) + " needs a kind, a name and a file");
+    }
+    std::vector<std::uint8_t> data = readFile(directory + path);
+
+    if (kind == "buffer")
+    {
+      packBuffer(asset, std::move(data), Assets::EntryKind::Buffer, 0);
+    }
+    else if (kind == "vertices")
+    {
+      std::uint32_t stride = 0;
+      if (!(words >> stride) || stride == 0 || data.size() % stride != 0)
+      {
+        throw std::runtime_error("ERROR: " + asset.name + " needs a stride dividing its size");
+      }
+      packBuffer(asset, std::move(data), Assets::EntryKind::VertexBuffer, stride);
+    }
+    else if (kind == "indices")
+    {
+      std::uint32_t bits = 0;
+      words >> bits;
+      packIndices(asset, std::move(data), bits);
+    }
+    else if (kind == "texture")
+    {
+      std::uint32_t width = 0;
+      std::uint32_t height = 0;
+      std::string format;
+      std::string option;
+      words >> width >> height >> format >> option;
+      packTexture(asset, std::move(data), width, height, format, option != "nomips");
+    }
+    else
+    {
+      throw std::runtime_error("ERROR: Unknown asset kind " + kind + " on line " + std::to_string(line_number));
+    }
+    return asset;
+  }
+
+  std::vector<PackedAsset> readManifest(std::string const &manifest_path)
+  {
+    std::ifstream manifest(manifest_path);
+    if (!manifest)
+    {
+      throw std::runtime_error("ERROR: Failed to open " + manifest_path);
+    }
+    size_t const slash = manifest_path.find_last_of("/\\");
+    std::string const directory = slash == std::string::npos ? "" : manifest_path.substr(0, slash + 1);
+
+    std::vector<PackedAsset> assets;
+    std::string line;
+    for (size_t line_number=1; std::getline(manifest, line); ++line_number)
+    {
+      line = line.substr(0, line.find('#'));
+      if (line.find_first_not_of(" \t\r") != std::string::npos)
+      {
+        assets.push_back(parseLine(line, directory, line_number));
+      }
+    }
+    return assets;
+  }
+
+  std::uint64_t alignUp(std::uint64_t value)
+  {
+    return (value + Assets::PACK_ALIGNMENT - 1) / Assets::PACK_ALIGNMENT * Assets::PACK_ALIGNMENT;
+  }
+
+  void writePack(std::vector<PackedAsset> &assets, std::string const &output_path)
+  {
+    for (PackedAsset &asset : assets)
+    {
+      asset.entry.name_hash = Assets::hashName(asset.name.data(), asset.name.size());
+    }
+    std::sort(assets.begin(), assets.end(), [](PackedAsset const &a, PackedAsset const &b)
+    {
+      return a.entry.name_hash != b.entry.name_hash ? a.entry.name_hash < b.entry.name_hash : a.name < b.name;
+    });
+
+    std::string names;
+    std::vector<Assets::PackMip> mips;
+    for (size_t i=0; i<assets.size(); ++i)
+    {
+      PackedAsset &asset = assets[i];
+      if (i > 0 && asset.name == assets[i - 1].name)
+      {
+        throw std::runtime_error("ERROR: " + asset.name + " is listed twice");
+      }
+      asset.entry.name_offset = static_cast<std::uint32_t>(names.size());
+      asset.entry.name_size = static_cast<std::uint32_t>(asset.name.size());
+      asset.entry.first_mip = static_cast<std::uint32_t>(mips.size());
+      asset.entry.mip_count = static_cast<std::uint32_t>(asset.levels.size());
+      names += asset.name;
+      for (std::pair<std::uint32_t, std::uint32_t> const &extent : asset.extents)
+      {
+        mips.push_back({ 0, 0, extent.first, extent.second });
+      }
+    }
+
+    Assets::PackHeader header = {};
+    std::memcpy(header.magic, Assets::PACK_MAGIC, sizeof(header.magic));
+    header.version = Assets::PACK_VERSION;
+    header.entry_count = static_cast<std::uint32_t>(assets.size());
+    header.mip_count = static_cast<std::uint32_t>(mips.size());
+    header.names_size = static_cast<std::uint32_t>(names.size());
+    header.names_offset = sizeof(header) + assets.size() * sizeof(Assets::PackEntry) +
+      mips.size() * sizeof(Assets::PackMip);
+
+    std::uint64_t offset = alignUp(header.names_offset + names.size());
+    size_t mip_index = 0;
+    for (PackedAsset const &asset : assets)
+    {
+      for (std::vector<std::uint8_t> const &level : asset.levels)
+      {
+        mips[mip_index].offset = offset;
+        mips[mip_index].size = level.size();
+        offset = alignUp(offset + level.size());
+        ++mip_index;
+      }
+    }
+    header.file_size = mips.empty() ? header.names_offset + names.size() : mips.back().offset + mips.back().size;
+
+    // Written beside the output and moved over it, so a failed build never leaves a half written pack
+    std::string const temporary_path = File::temporaryPath(output_path);
+    bool written;
+    {
+      std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+      for (PackedAsset const &asset : assets)
+      {
+        file.write(reinterpret_cast<char const *>(&asset.entry), sizeof(asset.entry));
+      }
+      file.write(reinterpret_cast<char const *>(mips.data()), mips.size() * sizeof(Assets::PackMip));
+      file.write(names.data(), names.size());
+
+      std::vector<char> const padding(Assets::PACK_ALIGNMENT, 0);
+      mip_index = 0;
+      for (PackedAsset const &asset : assets)
+      {
+        for (std::vector<std::uint8_t> const &level : asset.levels)
+        {
+          std::uint64_t const position = static_cast<std::uint64_t>(file.tellp());
+          file.write(padding.data(), static_cast<std::streamsize>(mips[mip_index].offset - position));
+          file.write(reinterpret_cast<char const *>(level.data()), static_cast<std::streamsize>(level.size()));
+          ++mip_index;
+        }
+      }
+      // A failed write leaves the stream failed, so every later write is skipped and this catches them all
+      written = static_cast<bool>(file.flush());
+    }
+    if (!written)
+    {
+      std::remove(temporary_path.c_str());
+      throw std::runtime_error("ERROR: Failed to write " + temporary_path);
+    }
+    if (!File::replaceFile(temporary_path, output_path))
+    {
+      throw std::runtime_error("ERROR: Failed to replace " + output_path);
+    }
+
+    std::printf(
+      "Packed %zu assets into %s, %llu bytes\n",
+      assets.size(), output_path.c_str(), static_cast<unsigned long long>(header.file_size)
+    );
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 3)
+  {
+    std::fprintf(stderr, "Usage: %s <manifest> <output.pack>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    std::vector<PackedAsset> assets = readManifest(argv[1]);
+    writePack(assets, argv[2]);
+  }
+  catch (std::exception const &e)
+  {
+    std::fprintf(stderr, "%s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,381 @@
+#include "shader_reflection.h"
+#include "spirv_reflection.h"
+#include "file_io.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Compiles a GLSL or HLSL shader to SPIR-V with glslc or glslangValidator and writes its reflection beside
+// it, going through a content addressed cache so unchanged shaders never reach the compiler again.
+//
+//   04_logical_devices_and_queues_shader_compiler --compiler <glslc> --cache <directory>
+//     [--stage <vert|tesc|tese|geom|frag|comp>] [--entry <name>] [-I <directory>]... [-D <NAME[=VALUE]>]...
+//     [--depfile <file>] <source> <output.spv>
+//
+// The stage defaults to the source's extension, as in mesh.vert or mesh.vert.hlsl; .hlsl sources are
+// compiled as HLSL. The cache key covers the source, every file it includes, the stage, entry point and
+// defines, and the compiler's version, so a key never outlives anything that could change the output.
+
+namespace Vulkan = ::Graphics::Vulkan;
+
+namespace
+{
+  struct Options
+  {
+    std::string compiler;
+    std::string cache_directory;
+    std::string stage;
+    std::string entry = "main";
+    std::vector<std::string> include_directories;
+    std::vector<std::string> defines;
+    std::string depfile;
+    std::string source;
+    std::string output;
+    bool hlsl = false;
+  };
+
+  std::string const STAGES[] = { "vert", "tesc", "tese", "geom", "frag", "comp" };
+
+  bool parseArguments(int argc, char **argv, Options &options)
+  {
+    std::vector<std::string> positional;
+    for (int i=1; i<argc; ++i)
+    {
+      std::string argument = argv[i];
+      bool has_value = i + 1 < argc;
+      if (argument == "--compiler" && has_value)
+      {
+        options.compiler = argv[++i];
+      }
+      else if (argument == "--cache" && has_value)
+      {
+        options.cache_directory = argv[++i];
+      }
+      else if (argument == "--stage" && has_value)
+      {
+        options.stage = argv[++i];
+      }
+      else if (argument == "--entry" && has_value)
+      {
+        options.entry = argv[++i];
+      }
+      else if (argument == "-I" && has_value)
+      {
+        options.include_directories.push_back(argv[++i]);
+      }
+      else if (argument == "-D" && has_value)
+      {
+        options.defines.push_back(argv[++i]);
+      }
+      else if (argument == "--depfile" && has_value)
+      {
+        options.depfile = argv[++i];
+      }
+      else if (!argument.empty() && argument[0] != '-')
+      {
+        positional.push_back(argument);
+      }
+      else
+      {
+        return false;
+      }
+    }
+    if (positional.size() != 2 || options.compiler.empty() || options.cache_directory.empty())
+    {
+      return false;
+    }
+    options.source = positional[0];
+    options.output = positional[1];
+
+    std::filesystem::path source_path(options.source);
+    options.hlsl = source_path.extension() == ".hlsl";
+    if (options.stage.empty())
+    {
+      // mesh.vert, mesh.vert.glsl or mesh.vert.hlsl
+      std::filesystem::path stem = source_path;
+      if (stem.extension() == ".hlsl" || stem.extension() == ".glsl")
+      {
+        stem = stem.stem();
+      }
+      options.stage = stem.extension().string().substr(std::min<size_t>(1, stem.extension().string().size()));
+    }
+    if (std::find(std::begin(STAGES), std::end(STAGES), options.stage) == std::end(STAGES))
+    {
+      std::fprintf(stderr, "Unknown shader stage '%s' for %s\n", options.stage.c_str(), options.source.c_str());
+      return false;
+    }
+
+    std::sort(options.defines.begin(), options.defines.end());
+    return true;
+  }
+
+  std::string readText(std::filesystem::path const &path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+      throw std::runtime_error("ERROR: Failed to open " + path.string());
+    }
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  }
+
+  std::string quote(std::string const &argument)
+  {
+    return "\"" + argument + "\"";
+  }
+
+  // cmd.exe strips the outermost pair of quotes from a command line, so the whole line gets a pair to spare
+  std::string shellCommand(std::string const &command)
+  {
+    #ifdef _WIN32
+      return quote(command);
+    #else
+      return command;
+    #endif
+  }
+
+  std::string runAndCapture(std::string const &command)
+  {
+    #ifdef _WIN32
+      std::FILE *pipe = _popen(shellCommand(command).c_str(), "r");
+    #else
+      std::FILE *pipe = popen(shellCommand(command).c_str(), "r");
+    #endif
+    if (pipe == nullptr)
+    {
+      throw std::runtime_error("ERROR: Failed to run " + command);
+    }
+    std::string output;
+    char buffer[256];
+    while (std::fgets(buffer, sizeof(buffer), pipe) != nullptr)
+    {
+      output += buffer;
+    }
+    #ifdef _WIN32
+      _pclose(pipe);
+    #else
+      pclose(pipe);
+    #endif
+    return output;
+  }
+
+  std::uint64_t hashText(std::uint64_t hash, std::string const &text)
+  {
+    for (char c : text)
+    {
+      hash = (hash ^ static_cast<std::uint8_t>(c)) * 1099511628211ull;
+    }
+    // Separates consecutive fields, so "ab" + "c" and "a" + "bc" hash differently
+    return (hash ^ 0xff) * 1099511628211ull;
+  }
+
+  // Follows #include directives from path, hashing each file once and collecting it for the depfile. Includes
+  // that can't be found are hashed by name and left for the compiler to report.
+  std::uint64_t hashIncludeGraph(
+    std::uint64_t hash,
+    std::filesystem::path const &path,
+    Options const &options,
+    std::set<std::filesystem::path> &visited,
+    std::vector<std::string> &dependencies)
+  {
+    std::string const text = readText(path);
+    hash = hashText(hash, text);
+
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+      size_t const directive = line.find_first_not_of(" \t");
+      if (directive == std::string::npos || line.compare(directive, 1, "#") != 0)
+      {
+        continue;
+      }
+      size_t const keyword = line.find_first_not_of(" \t", directive + 1);
+      if (keyword == std::string::npos || line.compare(keyword, 7, "include") != 0)
+      {
+        continue;
+      }
+      size_t const open = line.find_first_of("\"<", keyword + 7);
+      size_t const close = open == std::string::npos ? open : line.find_first_of("\">", open + 1);
+      if (close == std::string::npos)
+      {
+        continue;
+      }
+      std::string const name = line.substr(open + 1, close - open - 1);
+      hash = hashText(hash, name);
+
+      std::vector<std::filesystem::path> candidates = { path.parent_path() / name };
+      for (std::string const &directory : options.include_directories)
+      {
+        candidates.push_back(std::filesystem::path(directory) / name);
+      }
+      for (std::filesystem::path const &candidate : candidates)
+      {
+        if (std::filesystem::is_regular_file(candidate))
+        {
+          std::filesystem::path const resolved = std::filesystem::weakly_canonical(candidate);
+          if (visited.insert(resolved).second)
+          {
+            dependencies.push_back(resolved.string());
+            hash = hashIncludeGraph(hash, resolved, options, visited, dependencies);
+          }
+          break;
+        }
+      }
+    }
+    return hash;
+  }
+
+  std::string compileCommand(Options const &options, std::string const &output)
+  {
+    // Vulkan 1.1 is the newest API version the device is created for
+    bool const glslc = std::filesystem::path(options.compiler).stem() == "glslc";
+    std::string command = quote(options.compiler);
+    if (glslc)
+    {
+      command += " --target-env=vulkan1.1 -fshader-stage=" + options.stage;
+      command += options.hlsl ? " -x hlsl -fentry-point=" + options.entry : "";
+    }
+    else
+    {
+      command += " -V --target-env vulkan1.1 -S " + options.stage;
+      command += options.hlsl ? " -D -e " + options.entry : "";
+    }
+    for (std::string const &define : options.defines)
+    {
+      command += " " + quote("-D" + define);
+    }
+    for (std::string const &directory : options.include_directories)
+    {
+      command += " " + quote("-I" + directory);
+    }
+    return command + " -o " + quote(output) + " " + quote(options.source);
+  }
+
+  void createParentDirectory(std::string const &path)
+  {
+    std::filesystem::path const parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+      std::filesystem::create_directories(parent);
+    }
+  }
+
+  void copyAtomically(std::string const &from, std::string const &to)
+  {
+    createParentDirectory(to);
+    std::string const temporary_path = File::temporaryPath(to);
+    std::filesystem::copy_file(from, temporary_path, std::filesystem::copy_options::overwrite_existing);
+    if (!File::replaceFile(temporary_path, to))
+    {
+      throw std::runtime_error("ERROR: Failed to replace " + to);
+    }
+  }
+
+  void writeDepfile(Options const &options, std::vector<std::string> const &dependencies)
+  {
+    createParentDirectory(options.depfile);
+    std::ofstream depfile(options.depfile, std::ios::trunc);
+    auto escape = [](std::string text)
+    {
+      for (size_t at=text.find(' '); at!=std::string::npos; at=text.find(' ', at + 2))
+      {
+        text.insert(at, "\\");
+      }
+      return text;
+    };
+    depfile << escape(options.output) << ":";
+    for (std::string const &dependency : dependencies)
+    {
+      depfile << " \\\n  " << escape(dependency);
+    }
+    depfile << "\n";
+  }
+
+  void compile(Options const &options)
+  {
+    std::uint64_t key = 14695981039346656037ull;
+    key = hashText(key, runAndCapture(quote(options.compiler) + " --version"));
+    key = hashText(key, options.stage);
+    key = hashText(key, options.entry);
+    key = hashText(key, options.hlsl ? "hlsl" : "glsl");
+    for (std::string const &define : options.defines)
+    {
+      key = hashText(key, define);
+    }
+    std::set<std::filesystem::path> visited = { std::filesystem::weakly_canonical(options.source) };
+    std::vector<std::string> dependencies = { options.source };
+    key = hashIncludeGraph(key, options.source, options, visited, dependencies);
+
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    std::filesystem::create_directories(options.cache_directory);
+    std::string const cached_spirv = (std::filesystem::path(options.cache_directory) / name).string() + ".spv";
+    std::string const cached_reflection = Vulkan::reflectionPath(cached_spirv);
+
+    bool const hit = std::filesystem::exists(cached_spirv) && std::filesystem::exists(cached_reflection);
+    if (!hit)
+    {
+      std::string const temporary_spirv = File::temporaryPath(cached_spirv);
+      if (std::system(shellCommand(compileCommand(options, temporary_spirv)).c_str()) != 0)
+      {
+        std::remove(temporary_spirv.c_str());
+        throw std::runtime_error("ERROR: Failed to compile " + options.source);
+      }
+
+      std::string const spirv = readText(temporary_spirv);
+      std::vector<std::uint32_t> code(spirv.size() / sizeof(std::uint32_t));
+      std::memcpy(code.data(), spirv.data(), code.size() * sizeof(std::uint32_t));
+      // Reflection goes in first, since a cached SPIR-V file is only trusted with its reflection beside it
+      if (!Vulkan::saveShaderReflection(cached_reflection, Vulkan::reflectSpirv(code.data(), code.size())) ||
+          !File::replaceFile(temporary_spirv, cached_spirv))
+      {
+        throw std::runtime_error("ERROR: Failed to write " + cached_spirv);
+      }
+    }
+
+    copyAtomically(cached_spirv, options.output);
+    copyAtomically(cached_reflection, Vulkan::reflectionPath(options.output));
+    if (!options.depfile.empty())
+    {
+      writeDepfile(options, dependencies);
+    }
+    std::printf("%s %s -> %s\n", hit ? "Cached" : "Compiled", options.source.c_str(), options.output.c_str());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parseArguments(argc, argv, options))
+  {
+    std::fprintf(
+      stderr,
+      "Usage: %s --compiler <glslc> --cache <directory> [--stage <stage>] [--entry <name>] [-I <directory>]... "
+      "[-D <NAME[=VALUE]>]... [--depfile <file>] <source> <output.spv>\n",
+      argv[0]
+    );
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    compile(options);
+  }
+  catch (std::exception const &e)
+  {
+    std::fprintf(stderr, "%s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
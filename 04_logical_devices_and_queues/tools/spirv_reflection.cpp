@@ -0,0 +1,347 @@
+#include "spirv_reflection.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // The few parts of the SPIR-V grammar reflection needs, numbered as in the specification
+    namespace Spirv
+    {
+      std::uint32_t constexpr MAGIC = 0x07230203;
+
+      std::uint32_t constexpr OP_ENTRY_POINT = 15;
+      std::uint32_t constexpr OP_TYPE_INT = 21;
+      std::uint32_t constexpr OP_TYPE_FLOAT = 22;
+      std::uint32_t constexpr OP_TYPE_VECTOR = 23;
+      std::uint32_t constexpr OP_TYPE_MATRIX = 24;
+      std::uint32_t constexpr OP_TYPE_IMAGE = 25;
+      std::uint32_t constexpr OP_TYPE_SAMPLER = 26;
+      std::uint32_t constexpr OP_TYPE_SAMPLED_IMAGE = 27;
+      std::uint32_t constexpr OP_TYPE_ARRAY = 28;
+      std::uint32_t constexpr OP_TYPE_RUNTIME_ARRAY = 29;
+      std::uint32_t constexpr OP_TYPE_STRUCT = 30;
+      std::uint32_t constexpr OP_TYPE_POINTER = 32;
+      std::uint32_t constexpr OP_CONSTANT = 43;
+      std::uint32_t constexpr OP_SPEC_CONSTANT = 50;
+      std::uint32_t constexpr OP_VARIABLE = 59;
+      std::uint32_t constexpr OP_DECORATE = 71;
+      std::uint32_t constexpr OP_MEMBER_DECORATE = 72;
+
+      std::uint32_t constexpr DECORATION_BUFFER_BLOCK = 3;
+      std::uint32_t constexpr DECORATION_ROW_MAJOR = 4;
+      std::uint32_t constexpr DECORATION_ARRAY_STRIDE = 6;
+      std::uint32_t constexpr DECORATION_MATRIX_STRIDE = 7;
+      std::uint32_t constexpr DECORATION_BINDING = 33;
+      std::uint32_t constexpr DECORATION_DESCRIPTOR_SET = 34;
+      std::uint32_t constexpr DECORATION_OFFSET = 35;
+
+      std::uint32_t constexpr STORAGE_UNIFORM_CONSTANT = 0;
+      std::uint32_t constexpr STORAGE_UNIFORM = 2;
+      std::uint32_t constexpr STORAGE_PUSH_CONSTANT = 9;
+      std::uint32_t constexpr STORAGE_STORAGE_BUFFER = 12;
+
+      std::uint32_t constexpr DIM_BUFFER = 5;
+      std::uint32_t constexpr DIM_SUBPASS_DATA = 6;
+    }
+
+    namespace
+    {
+      struct Decorations
+      {
+        std::uint32_t set = ~0u;
+        std::uint32_t binding = ~0u;
+        std::uint32_t array_stride = 0;
+        bool buffer_block = false;
+      };
+
+      struct MemberDecorations
+      {
+        std::uint32_t offset = 0;
+        std::uint32_t matrix_stride = 0;
+        bool row_major = false;
+      };
+
+      struct Module
+      {
+        // Each type's opcode followed by its operands after the result id
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> types;
+        std::unordered_map<std::uint32_t, std::uint32_t> constants;
+        std::unordered_map<std::uint32_t, Decorations> decorations;
+        std::map<std::pair<std::uint32_t, std::uint32_t>, MemberDecorations> member_decorations;
+        // Pointer type, result id and storage class of each global variable
+        std::vector<std::vector<std::uint32_t>> variables;
+        VkShaderStageFlags stages = 0;
+
+        std::vector<std::uint32_t> const &type(std::uint32_t id) const
+        {
+          auto found = types.find(id);
+          if (found == types.end())
+          {
+            throw std::runtime_error("ERROR: SPIR-V refers to undefined type " + std::to_string(id));
+          }
+          return found->second;
+        }
+
+        std::uint32_t constant(std::uint32_t id) const
+        {
+          auto found = constants.find(id);
+          if (found == constants.end())
+          {
+            throw std::runtime_error("ERROR: SPIR-V array length " + std::to_string(id) + " isn't a constant");
+          }
+          return found->second;
+        }
+      };
+
+      VkShaderStageFlags executionModelStage(std::uint32_t model)
+      {
+        switch (model)
+        {
+          case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+          case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+          case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+          case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+          case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+          case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+          default: return 0;
+        }
+      }
+
+      Module parse(std::uint32_t const *code, size_t word_count)
+      {
+        if (word_count < 5 || code[0] != Spirv::MAGIC)
+        {
+          throw std::runtime_error("ERROR: Not SPIR-V");
+        }
+
+        Module module;
+        for (size_t at=5; at<word_count;)
+        {
+          std::uint32_t const length = code[at] >> 16;
+          std::uint32_t const opcode = code[at] & 0xffff;
+          if (length == 0 || at + length > word_count)
+          {
+            throw std::runtime_error("ERROR: Truncated SPIR-V instruction");
+          }
+          std::uint32_t const *operands = code + at + 1;
+          std::uint32_t const operand_count = length - 1;
+          at += length;
+
+          if (opcode == Spirv::OP_ENTRY_POINT && operand_count >= 1)
+          {
+            module.stages |= executionModelStage(operands[0]);
+          }
+          else if ((opcode >= Spirv::OP_TYPE_INT && opcode <= Spirv::OP_TYPE_POINTER) && operand_count >= 1)
+          {
+            std::vector<std::uint32_t> &type = module.types[operands[0]];
+            type.push_back(opcode);
+            type.insert(type.end(), operands + 1, operands + operand_count);
+          }
+          else if ((opcode == Spirv::OP_CONSTANT || opcode == Spirv::OP_SPEC_CONSTANT) && operand_count >= 3)
+          {
+            module.constants[operands[1]] = operands[2];
+          }
+          else if (opcode == Spirv::OP_VARIABLE && operand_count >= 3)
+          {
+            module.variables.push_back({ operands[0], operands[1], operands[2] });
+          }
+          else if (opcode == Spirv::OP_DECORATE && operand_count >= 2)
+          {
+            Decorations &decorations = module.decorations[operands[0]];
+            std::uint32_t const value = operand_count >= 3 ? operands[2] : 0;
+            switch (operands[1])
+            {
+              case Spirv::DECORATION_BUFFER_BLOCK: decorations.buffer_block = true; break;
+              case Spirv::DECORATION_ARRAY_STRIDE: decorations.array_stride = value; break;
+              case Spirv::DECORATION_BINDING: decorations.binding = value; break;
+              case Spirv::DECORATION_DESCRIPTOR_SET: decorations.set = value; break;
+              default: break;
+            }
+          }
+          else if (opcode == Spirv::OP_MEMBER_DECORATE && operand_count >= 3)
+          {
+            MemberDecorations &decorations = module.member_decorations[{ operands[0], operands[1] }];
+            std::uint32_t const value = operand_count >= 4 ? operands[3] : 0;
+            switch (operands[2])
+            {
+              case Spirv::DECORATION_OFFSET: decorations.offset = value; break;
+              case Spirv::DECORATION_MATRIX_STRIDE: decorations.matrix_stride = value; break;
+              case Spirv::DECORATION_ROW_MAJOR: decorations.row_major = true; break;
+              default: break;
+            }
+          }
+        }
+        return module;
+      }
+
+      // Bytes the type takes in a block laid out by its offset and stride decorations
+      std::uint32_t typeSize(Module const &module, std::uint32_t id, MemberDecorations const &member)
+      {
+        std::vector<std::uint32_t> const &type = module.type(id);
+        switch (type[0])
+        {
+          case Spirv::OP_TYPE_INT:
+          case Spirv::OP_TYPE_FLOAT:
+            return type.at(1) / 8;
+          case Spirv::OP_TYPE_VECTOR:
+            return type.at(2) * typeSize(module, type.at(1), member);
+          case Spirv::OP_TYPE_MATRIX:
+          {
+            std::uint32_t const columns = type.at(2);
+            std::vector<std::uint32_t> const &column = module.type(type.at(1));
+            if (member.matrix_stride == 0)
+            {
+              return columns * typeSize(module, type.at(1), member);
+            }
+            // Row major matrices are stored as one stride per row, and a column has a component per row
+            return (member.row_major ? column.at(2) : columns) * member.matrix_stride;
+          }
+          case Spirv::OP_TYPE_ARRAY:
+          {
+            auto found = module.decorations.find(id);
+            std::uint32_t const stride = found != module.decorations.end() && found->second.array_stride != 0
+              ? found->second.array_stride
+              : typeSize(module, type.at(1), member);
+            return module.constant(type.at(2)) * stride;
+          }
+          case Spirv::OP_TYPE_STRUCT:
+          {
+            std::uint32_t size = 0;
+            for (std::uint32_t index=0; index+1<type.size(); ++index)
+            {
+              auto found = module.member_decorations.find({ id, index });
+              MemberDecorations const decorations = found != module.member_decorations.end()
+                ? found->second
+                : MemberDecorations();
+              size = std::max(size, decorations.offset + typeSize(module, type[index + 1], decorations));
+            }
+            return size;
+          }
+          default:
+            return 0;
+        }
+      }
+
+      VkDescriptorType descriptorType(Module const &module, std::uint32_t type_id, std::uint32_t storage_class)
+      {
+        std::vector<std::uint32_t> const &type = module.type(type_id);
+        auto found = module.decorations.find(type_id);
+        bool const buffer_block = found != module.decorations.end() && found->second.buffer_block;
+
+        if (storage_class == Spirv::STORAGE_STORAGE_BUFFER)
+        {
+          return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        if (storage_class == Spirv::STORAGE_UNIFORM)
+        {
+          return buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        }
+
+        switch (type[0])
+        {
+          case Spirv::OP_TYPE_SAMPLER:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+          case Spirv::OP_TYPE_SAMPLED_IMAGE:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+          case Spirv::OP_TYPE_IMAGE:
+          {
+            // Operands: sampled type, dim, depth, arrayed, multisampled, sampled (1 sampled, 2 storage)
+            std::uint32_t const dim = type.at(2);
+            bool const storage = type.at(6) == 2;
+            if (dim == Spirv::DIM_BUFFER)
+            {
+              return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            }
+            if (dim == Spirv::DIM_SUBPASS_DATA)
+            {
+              return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            }
+            return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+          }
+          default:
+            throw std::runtime_error("ERROR: Unsupported SPIR-V descriptor type " + std::to_string(type[0]));
+        }
+      }
+    }
+
+    ShaderReflection reflectSpirv(std::uint32_t const *code, size_t word_count)
+    {
+      Module const module = parse(code, word_count);
+
+      ShaderReflection reflection;
+      reflection.stages = module.stages;
+      for (std::vector<std::uint32_t> const &variable : module.variables)
+      {
+        std::uint32_t const storage_class = variable[2];
+        std::vector<std::uint32_t> const &pointer = module.type(variable[0]);
+        if (pointer[0] != Spirv::OP_TYPE_POINTER)
+        {
+          throw std::runtime_error("ERROR: SPIR-V variable " + std::to_string(variable[1]) + " isn't a pointer");
+        }
+        std::uint32_t type_id = pointer.at(2);
+
+        if (storage_class == Spirv::STORAGE_PUSH_CONSTANT)
+        {
+          std::vector<std::uint32_t> const &block = module.type(type_id);
+          std::uint32_t begin = ~0u;
+          for (std::uint32_t index=0; index+1<block.size(); ++index)
+          {
+            auto found = module.member_decorations.find({ type_id, index });
+            begin = std::min(begin, found != module.member_decorations.end() ? found->second.offset : 0u);
+          }
+          std::uint32_t const end = typeSize(module, type_id, MemberDecorations());
+          if (end > 0)
+          {
+            reflection.push_constants.push_back({ module.stages, begin, end - begin });
+          }
+          continue;
+        }
+        if (storage_class != Spirv::STORAGE_UNIFORM_CONSTANT &&
+            storage_class != Spirv::STORAGE_UNIFORM &&
+            storage_class != Spirv::STORAGE_STORAGE_BUFFER)
+        {
+          continue;
+        }
+
+        auto decorations = module.decorations.find(variable[1]);
+        if (decorations == module.decorations.end() ||
+            decorations->second.set == ~0u ||
+            decorations->second.binding == ~0u)
+        {
+          continue;
+        }
+
+        ShaderBinding binding;
+        binding.set = decorations->second.set;
+        binding.binding = decorations->second.binding;
+        binding.stages = module.stages;
+        // Arrays of descriptors multiply the count, and runtime sized ones leave it to the layout
+        for (std::vector<std::uint32_t> const *type = &module.type(type_id);
+          (*type)[0] == Spirv::OP_TYPE_ARRAY || (*type)[0] == Spirv::OP_TYPE_RUNTIME_ARRAY;
+          type = &module.type(type_id))
+        {
+          binding.count = (*type)[0] == Spirv::OP_TYPE_ARRAY ? binding.count * module.constant(type->at(2)) : 0;
+          type_id = type->at(1);
+        }
+        binding.type = descriptorType(module, type_id, storage_class);
+        reflection.bindings.push_back(binding);
+      }
+
+      // Sorted the way merge() leaves them, by merging into an empty reflection
+      ShaderReflection sorted;
+      sorted.merge(reflection);
+      return sorted;
+    }
+  }
+#endif
+
+}
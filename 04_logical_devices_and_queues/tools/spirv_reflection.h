@@ -0,0 +1,23 @@
+#ifndef SPIRV_REFLECTION_H
+#define SPIRV_REFLECTION_H
+
+#include "shader_reflection.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Graphics
+{
+
+#ifdef USING_VULKAN
+  namespace Vulkan
+  {
+    // Reads the descriptor bindings and push constant block the module declares. Throws on anything that
+    // isn't well formed SPIR-V.
+    ShaderReflection reflectSpirv(std::uint32_t const *code, size_t word_count);
+  }
+#endif
+
+}
+
+#endif // SPIRV_REFLECTION_H
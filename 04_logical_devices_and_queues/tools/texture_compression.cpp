@@ -0,0 +1,254 @@
+#include "texture_compression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+
+namespace Assets
+{
+  static float srgbToLinear(std::uint8_t value)
+  {
+    float const c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+  }
+
+  static std::uint8_t linearToSrgb(float value)
+  {
+    float const c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<std::uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+  }
+
+  Image downsample(Image const &image, bool srgb)
+  {
+    std::array<float, 256> to_linear;
+    for (int i=0; i<256; ++i)
+    {
+      to_linear[i] = srgb ? srgbToLinear(static_cast<std::uint8_t>(i)) : i / 255.0f;
+    }
+
+    Image mip;
+    mip.width = std::max(image.width / 2, 1u);
+    mip.height = std::max(image.height / 2, 1u);
+    mip.texels.resize(size_t(mip.width) * mip.height * 4);
+    for (std::uint32_t y=0; y<mip.height; ++y)
+    {
+      // Odd sizes leave the last row or column without a partner, so it averages with itself
+      std::uint32_t const y0 = std::min(y * 2, image.height - 1);
+      std::uint32_t const y1 = std::min(y * 2 + 1, image.height - 1);
+      for (std::uint32_t x=0; x<mip.width; ++x)
+      {
+        std::uint32_t const x0 = std::min(x * 2, image.width - 1);
+        std::uint32_t const x1 = std::min(x * 2 + 1, image.width - 1);
+        std::uint8_t const *samples[4] = {
+          &image.texels[(size_t(y0) * image.width + x0) * 4],
+          &image.texels[(size_t(y0) * image.width + x1) * 4],
+          &image.texels[(size_t(y1) * image.width + x0) * 4],
+          &image.texels[(size_t(y1) * image.width + x1) * 4]
+        };
+
+        std::uint8_t *texel = &mip.texels[(size_t(y) * mip.width + x) * 4];
+        for (int channel=0; channel<4; ++channel)
+        {
+          // Alpha is linear either way
+          bool const linear = !srgb || channel == 3;
+          float sum = 0.0f;
+          for (std::uint8_t const *sample : samples)
+          {
+            sum += linear ? sample[channel] / 255.0f : to_linear[sample[channel]];
+          }
+          texel[channel] = linear
+            ? static_cast<std::uint8_t>(sum / 4.0f * 255.0f + 0.5f)
+            : linearToSrgb(sum / 4.0f);
+        }
+      }
+    }
+    return mip;
+  }
+
+  // The 4x4 texels of the block at bx, by, as RGBA
+  static std::array<std::uint8_t, 64> loadBlock(Image const &image, std::uint32_t bx, std::uint32_t by)
+  {
+    std::array<std::uint8_t, 64> block;
+    for (std::uint32_t y=0; y<4; ++y)
+    {
+      std::uint32_t const source_y = std::min(by * 4 + y, image.height - 1);
+      for (std::uint32_t x=0; x<4; ++x)
+      {
+        std::uint32_t const source_x = std::min(bx * 4 + x, image.width - 1);
+        std::uint8_t const *texel = &image.texels[(size_t(source_y) * image.width + source_x) * 4];
+        std::copy(texel, texel + 4, &block[(y * 4 + x) * 4]);
+      }
+    }
+    return block;
+  }
+
+  static std::uint16_t packRgb565(int r, int g, int b)
+  {
+    int const r5 = (r * 31 + 127) / 255;
+    int const g6 = (g * 63 + 127) / 255;
+    int const b5 = (b * 31 + 127) / 255;
+    return static_cast<std::uint16_t>(r5 << 11 | g6 << 5 | b5);
+  }
+
+  static std::array<int, 3> unpackRgb565(std::uint16_t colour)
+  {
+    int const r = colour >> 11 & 31;
+    int const g = colour >> 5 & 63;
+    int const b = colour & 31;
+    return { r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2 };
+  }
+
+  static void writeLittleEndian(std::uint8_t *out, std::uint64_t value, int bytes)
+  {
+    for (int i=0; i<bytes; ++i)
+    {
+      out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+  }
+
+  // Endpoints from the block's colour bounding box, inset by a sixteenth of its extent so outliers don't
+  // pull the palette away from the bulk of the texels, then the nearest of the four palette colours per
+  // texel. Always the four colour mode, which BC3 requires and opaque BC1 wants.
+  static void compressColourBlock(std::array<std::uint8_t, 64> const &block, std::uint8_t *out)
+  {
+    int low[3] = { 255, 255, 255 };
+    int high[3] = { 0, 0, 0 };
+    for (int i=0; i<16; ++i)
+    {
+      for (int channel=0; channel<3; ++channel)
+      {
+        low[channel] = std::min<int>(low[channel], block[i * 4 + channel]);
+        high[channel] = std::max<int>(high[channel], block[i * 4 + channel]);
+      }
+    }
+    for (int channel=0; channel<3; ++channel)
+    {
+      int const inset = (high[channel] - low[channel]) / 16;
+      low[channel] += inset;
+      high[channel] -= inset;
+    }
+
+    std::uint16_t colour0 = packRgb565(high[0], high[1], high[2]);
+    std::uint16_t colour1 = packRgb565(low[0], low[1], low[2]);
+    if (colour0 < colour1)
+    {
+      std::swap(colour0, colour1);
+    }
+
+    std::uint32_t indices = 0;
+    // Equal endpoints would select the three colour mode, where every index but 3 still gives colour0
+    if (colour0 != colour1)
+    {
+      std::array<int, 3> const c0 = unpackRgb565(colour0);
+      std::array<int, 3> const c1 = unpackRgb565(colour1);
+      int palette[4][3];
+      for (int channel=0; channel<3; ++channel)
+      {
+        palette[0][channel] = c0[channel];
+        palette[1][channel] = c1[channel];
+        palette[2][channel] = (2 * c0[channel] + c1[channel]) / 3;
+        palette[3][channel] = (c0[channel] + 2 * c1[channel]) / 3;
+      }
+
+      for (int i=0; i<16; ++i)
+      {
+        int best = 0;
+        int best_distance = 0x7fffffff;
+        for (int candidate=0; candidate<4; ++candidate)
+        {
+          int distance = 0;
+          for (int channel=0; channel<3; ++channel)
+          {
+            int const delta = block[i * 4 + channel] - palette[candidate][channel];
+            distance += delta * delta;
+          }
+          if (distance < best_distance)
+          {
+            best = candidate;
+            best_distance = distance;
+          }
+        }
+        indices |= std::uint32_t(best) << (2 * i);
+      }
+    }
+
+    writeLittleEndian(out, colour0, 2);
+    writeLittleEndian(out + 2, colour1, 2);
+    writeLittleEndian(out + 4, indices, 4);
+  }
+
+  // Alpha endpoints at the block's extremes, in the eight value mode, and the nearest value per texel
+  static void compressAlphaBlock(std::array<std::uint8_t, 64> const &block, std::uint8_t *out)
+  {
+    int alpha0 = 0;
+    int alpha1 = 255;
+    for (int i=0; i<16; ++i)
+    {
+      alpha0 = std::max<int>(alpha0, block[i * 4 + 3]);
+      alpha1 = std::min<int>(alpha1, block[i * 4 + 3]);
+    }
+
+    std::uint64_t indices = 0;
+    if (alpha0 != alpha1)
+    {
+      int palette[8] = { alpha0, alpha1 };
+      for (int i=1; i<7; ++i)
+      {
+        palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+      }
+
+      for (int i=0; i<16; ++i)
+      {
+        int best = 0;
+        for (int candidate=1; candidate<8; ++candidate)
+        {
+          if (std::abs(block[i * 4 + 3] - palette[candidate]) < std::abs(block[i * 4 + 3] - palette[best]))
+          {
+            best = candidate;
+          }
+        }
+        indices |= std::uint64_t(best) << (3 * i);
+      }
+    }
+
+    out[0] = static_cast<std::uint8_t>(alpha0);
+    out[1] = static_cast<std::uint8_t>(alpha1);
+    writeLittleEndian(out + 2, indices, 6);
+  }
+
+  static std::vector<std::uint8_t> compressBlocks(Image const &image, bool alpha)
+  {
+    size_t const block_size = alpha ? 16 : 8;
+    std::uint32_t const blocks_x = (image.width + 3) / 4;
+    std::uint32_t const blocks_y = (image.height + 3) / 4;
+    std::vector<std::uint8_t> blocks(size_t(blocks_x) * blocks_y * block_size);
+
+    std::uint8_t *out = blocks.data();
+    for (std::uint32_t by=0; by<blocks_y; ++by)
+    {
+      for (std::uint32_t bx=0; bx<blocks_x; ++bx)
+      {
+        std::array<std::uint8_t, 64> const block = loadBlock(image, bx, by);
+        if (alpha)
+        {
+          compressAlphaBlock(block, out);
+          out += 8;
+        }
+        compressColourBlock(block, out);
+        out += 8;
+      }
+    }
+    return blocks;
+  }
+
+  std::vector<std::uint8_t> compressBC1(Image const &image)
+  {
+    return compressBlocks(image, false);
+  }
+
+  std::vector<std::uint8_t> compressBC3(Image const &image)
+  {
+    return compressBlocks(image, true);
+  }
+}
@@ -0,0 +1,26 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <cstdint>
+#include <vector>
+
+namespace Assets
+{
+  // Tightly packed 8-bit RGBA texels, rows top to bottom
+  struct Image
+  {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::vector<std::uint8_t> texels;
+  };
+
+  // The next mip level down, averaging each 2x2 footprint. sRGB colour is averaged as linear light.
+  Image downsample(Image const &image, bool srgb);
+
+  // Blocks of 4x4 texels, left to right and top to bottom, with partial blocks at the edges padded by
+  // repeating the last row and column. BC1 drops alpha; BC3 keeps it at full 8-bit interpolation.
+  std::vector<std::uint8_t> compressBC1(Image const &image);
+  std::vector<std::uint8_t> compressBC3(Image const &image);
+}
+
+#endif // TEXTURE_COMPRESSION_H